@@ -63,6 +63,10 @@ else:macx {
 macx: DEFINES += ACTION_MODIFIER_NAME_SHORT=\\\"Cmd\\\" ACTION_MODIFIER_NAME=\\\"Command\\\"
 else: DEFINES += ACTION_MODIFIER_NAME_SHORT=\\\"Ctrl\\\" ACTION_MODIFIER_NAME=\\\"Control\\\"
 
+# Checking VAC invariants after each edit, e.g., qmake CONFIG+=vac_check_invariants
+vac_check_invariants: DEFINES += VPAINT_CHECK_INVARIANTS
+vac_check_all_invariants: DEFINES += VPAINT_CHECK_ALL_INVARIANTS
+
 # Debug symbols
 unix:!macx:CONFIG(debug, debug|release): QMAKE_CXXFLAGS += -gdwarf-2
 
@@ -165,7 +169,10 @@ HEADERS += ../VAC/MainWindow.h \
     ../VAC/VectorAnimationComplex/EdgeSample.h \
     ../VAC/VectorAnimationComplex/Algorithms.h \
     ../VAC/VectorAnimationComplex/SmartKeyEdgeSet.h \
+    ../VAC/VectorAnimationComplex/PointIndex.h \
+    ../VAC/VectorAnimationComplex/SpatialIndex.h \
     ../VAC/OpenGL.h \
+    ../VAC/VectorAnimationComplex/TriangleBatch.h \
     ../VAC/VectorAnimationComplex/Triangles.h \
     ../VAC/SelectionInfoWidget.h \
     ../VAC/VectorAnimationComplex/Cycle.h \
@@ -180,6 +187,11 @@ HEADERS += ../VAC/MainWindow.h \
     ../VAC/ObjectPropertiesWidget.h \
     ../VAC/AnimatedCycleWidget.h \
     ../VAC/VectorAnimationComplex/CellObserver.h \
+    ../VAC/VectorAnimationComplex/CellTable.h \
+    ../VAC/VectorAnimationComplex/CellBitSet.h \
+    ../VAC/VectorAnimationComplex/SmallCellSet.h \
+    ../VAC/VectorAnimationComplex/CellAllocator.h \
+    ../VAC/VectorAnimationComplex/NodeArena.h \
     ../VAC/Color.h \
     ../VAC/DevSettings.h \
     ../VAC/Settings.h \
@@ -202,6 +214,7 @@ HEADERS += ../VAC/MainWindow.h \
     ../VAC/ViewWidget.h \
     ../VAC/Background/Background.h \
     ../VAC/Background/BackgroundData.h \
+    ../VAC/Background/BackgroundImageCache.h \
     ../VAC/Background/BackgroundRenderer.h \
     ../VAC/Background/BackgroundWidget.h \
     ../VAC/Background/BackgroundUrlValidator.h \
@@ -218,6 +231,7 @@ HEADERS += ../VAC/MainWindow.h \
     ../VAC/SvgParser.h \
     ../VAC/SvgImportDialog.h \
     ../VAC/SvgImportParams.h \
+    ../VAC/RasterVideoWriter.h \
     Application.h \
     UpdateCheckDialog.h \
     UpdateCheck.h
@@ -263,6 +277,9 @@ SOURCES += main.cpp \
     ../VAC/VectorAnimationComplex/Cycle.cpp \
     ../VAC/VectorAnimationComplex/Algorithms.cpp \
     ../VAC/VectorAnimationComplex/SmartKeyEdgeSet.cpp \
+    ../VAC/VectorAnimationComplex/PointIndex.cpp \
+    ../VAC/VectorAnimationComplex/SpatialIndex.cpp \
+    ../VAC/VectorAnimationComplex/TriangleBatch.cpp \
     ../VAC/VectorAnimationComplex/Triangles.cpp \
     ../VAC/SelectionInfoWidget.cpp \
     ../VAC/VectorAnimationComplex/Path.cpp \
@@ -276,6 +293,10 @@ SOURCES += main.cpp \
     ../VAC/ObjectPropertiesWidget.cpp \
     ../VAC/AnimatedCycleWidget.cpp \
     ../VAC/VectorAnimationComplex/CellObserver.cpp \
+    ../VAC/VectorAnimationComplex/CellTable.cpp \
+    ../VAC/VectorAnimationComplex/CellBitSet.cpp \
+    ../VAC/VectorAnimationComplex/CellAllocator.cpp \
+    ../VAC/VectorAnimationComplex/NodeArena.cpp \
     ../VAC/Color.cpp \
     ../VAC/DevSettings.cpp \
     ../VAC/Settings.cpp \
@@ -298,6 +319,7 @@ SOURCES += main.cpp \
     ../VAC/ViewWidget.cpp \
     ../VAC/Background/Background.cpp \
     ../VAC/Background/BackgroundData.cpp \
+    ../VAC/Background/BackgroundImageCache.cpp \
     ../VAC/Background/BackgroundRenderer.cpp \
     ../VAC/Background/BackgroundWidget.cpp \
     ../VAC/Background/BackgroundUrlValidator.cpp \
@@ -314,6 +336,7 @@ SOURCES += main.cpp \
     ../VAC/SvgParser.cpp \
     ../VAC/SvgImportDialog.cpp \
     ../VAC/SvgImportParams.cpp \
+    ../VAC/RasterVideoWriter.cpp \
     Application.cpp \
     UpdateCheckDialog.cpp \
     UpdateCheck.cpp
@@ -0,0 +1,138 @@
+// Copyright (C) 2012-2023 The VPaint Developers.
+// See the COPYRIGHT file at the top-level directory of this distribution
+// and at https://github.com/dalboris/vpaint/blob/master/COPYRIGHT
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Tests that cells with huge IDs, e.g. read from a corrupted file, are
+// supported without allocating memory proportional to their ID.
+
+#include <VAC/VectorAnimationComplex/CellBitSet.h>
+#include <VAC/VectorAnimationComplex/CellTable.h>
+#include <VAC/VectorAnimationComplex/KeyVertex.h>
+#include <VAC/VectorAnimationComplex/VAC.h>
+#include <VAC/XmlStreamReader.h>
+
+#include <QBuffer>
+#include <QtTest>
+
+#include <climits>
+
+using namespace VectorAnimationComplex;
+
+namespace
+{
+
+const int hugeId = INT_MAX - 1;
+
+// Cells of the table are never dereferenced, so any non-null address works
+Cell * fakeCell(int i)
+{
+    return reinterpret_cast<Cell *>(quintptr(16 * (i + 1)));
+}
+
+QList<int> ids(const CellBitSet & set)
+{
+    QList<int> res;
+    set.forEach([&](int id) { res << id; });
+    return res;
+}
+
+}
+
+class CellIdsTest: public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void cellTable()
+    {
+        CellTable table;
+        table.insert(0, fakeCell(0));
+        table.insert(hugeId, fakeCell(hugeId));
+        table.insert(2, fakeCell(2));
+        QCOMPARE(table.size(), 3);
+        QCOMPARE(table.value(hugeId), fakeCell(hugeId));
+        QCOMPARE(table.value(1), static_cast<Cell *>(0));
+        QCOMPARE(table.last(), fakeCell(hugeId));
+
+        QList<Cell *> cells;
+        for(Cell * cell: table)
+            cells << cell;
+        QCOMPARE(cells, QList<Cell *>() << fakeCell(0) << fakeCell(2) << fakeCell(hugeId));
+
+        table.remove(hugeId);
+        QCOMPARE(table.size(), 2);
+        QVERIFY(!table.contains(hugeId));
+        QCOMPARE(table.last(), fakeCell(2));
+    }
+
+    void cellBitSet()
+    {
+        CellBitSet a;
+        a.insert(1);
+        a.insert(hugeId);
+        QCOMPARE(a.count(), 2);
+        QVERIFY(a.contains(hugeId));
+        QCOMPARE(ids(a), QList<int>() << 1 << hugeId);
+
+        CellBitSet b;
+        b.insert(2);
+        b.insert(hugeId);
+        QCOMPARE(a.intersectionCount(b), 1);
+
+        CellBitSet c = a;
+        c.unite(b);
+        QCOMPARE(ids(c), QList<int>() << 1 << 2 << hugeId);
+        c = a;
+        c.intersect(b);
+        QCOMPARE(ids(c), QList<int>() << hugeId);
+        c = a;
+        c.subtract(b);
+        QCOMPARE(ids(c), QList<int>() << 1);
+        c = a;
+        c.toggle(b);
+        QCOMPARE(ids(c), QList<int>() << 1 << 2);
+        QCOMPARE(c.first(), 1);
+
+        QVERIFY(a.remove(hugeId));
+        QCOMPARE(a.count(), 1);
+    }
+
+    void loadCellWithHugeId()
+    {
+        QByteArray data = QString(
+            "<layer>"
+            "<vertex id=\"0\" position=\"0 0\"/>"
+            "<vertex id=\"%1\" position=\"10 0\"/>"
+            "</layer>").arg(hugeId).toUtf8();
+        QBuffer buffer(&data);
+        buffer.open(QIODevice::ReadOnly);
+        XmlStreamReader xml(&buffer);
+        QVERIFY(xml.readNextStartElement());
+
+        VAC vac;
+        vac.read(xml);
+        QCOMPARE(vac.cells().size(), 2);
+        Cell * cell = vac.getCell(hugeId);
+        QVERIFY(cell && cell->toKeyVertex());
+        QCOMPARE(cell->id(), hugeId);
+
+        vac.invertSelection();
+        QCOMPARE(vac.selectedCells().size(), 2);
+        QVERIFY(vac.selectedCells().contains(cell));
+    }
+};
+
+QTEST_GUILESS_MAIN(CellIdsTest)
+#include "CellIdsTest.moc"
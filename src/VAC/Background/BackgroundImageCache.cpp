@@ -0,0 +1,351 @@
+// Copyright (C) 2012-2023 The VPaint Developers.
+// See the COPYRIGHT file at the top-level directory of this distribution
+// and at https://github.com/dalboris/vpaint/blob/master/COPYRIGHT
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "BackgroundImageCache.h"
+
+#include <QFileInfo>
+#include <QImageReader>
+#include <QRunnable>
+#include <QSemaphore>
+
+#include <algorithm> // max
+
+namespace
+{
+
+// Default memory budget for decoded images
+const qint64 defaultMaxBytes = 512 * 1024 * 1024;
+
+// Decoding is mostly I/O and zlib/libjpeg bound, and the render thread also
+// needs some CPU, so we keep the number of workers low.
+const int maxDecodingThreads = 2;
+
+int costInKiB(const QImage & image)
+{
+    qint64 bytes = static_cast<qint64>(image.bytesPerLine()) * image.height();
+    return static_cast<int>((bytes + 1023) / 1024);
+}
+
+QSize levelSize(const QSize & originalSize, int level)
+{
+    return QSize(std::max(1, originalSize.width() >> level),
+                 std::max(1, originalSize.height() >> level));
+}
+
+// Reads the given image file at the given mipmap level, and prepares it for
+// texture upload. This is called from worker threads, therefore must not
+// access any shared state.
+QImage decodeImage(const QString & filePath, int level, QSize & originalSize)
+{
+    originalSize = QSize();
+    QFileInfo fileInfo(filePath);
+    if (fileInfo.exists() && fileInfo.isFile())
+    {
+        // Ask the reader to decode at reduced size if we know the size
+        // before decoding, which is the case for most formats. Some formats
+        // can then skip most of the work (e.g., JPEG via scaled IDCT).
+        QImageReader reader(filePath);
+        originalSize = reader.size();
+        if (level > 0 && originalSize.isValid())
+        {
+            reader.setScaledSize(levelSize(originalSize, level));
+        }
+
+        QImage img = reader.read();
+        if (!img.isNull())
+        {
+            // Fallback for formats that don't report their size upfront
+            if (!originalSize.isValid())
+            {
+                originalSize = img.size();
+                if (level > 0)
+                {
+                    img = img.scaled(levelSize(originalSize, level),
+                                     Qt::IgnoreAspectRatio, Qt::SmoothTransformation);
+                }
+            }
+            return img.convertToFormat(QImage::Format_RGBA8888).mirrored();
+        }
+    }
+    return QImage();
+}
+
+}
+
+struct BackgroundImageDecode
+{
+    enum Status { Queued, Running, Cancelled };
+    QAtomicInt status;
+    QRunnable * task;   // Only valid while status is Queued
+    QSemaphore done;    // Released once image and originalSize are set
+    QImage image;
+    QSize originalSize;
+
+    BackgroundImageDecode() : status(Queued), task(0) {}
+};
+
+namespace
+{
+
+class DecodeTask: public QRunnable
+{
+public:
+    DecodeTask(BackgroundImageCache * cache, const BackgroundImageKey & key,
+               int generation, const QString & filePath,
+               const QSharedPointer<BackgroundImageDecode> & decode) :
+        cache_(cache), key_(key), generation_(generation), filePath_(filePath), decode_(decode)
+    {
+    }
+
+    void run() override
+    {
+        // Do nothing if waitForImage() decoded it in the meantime
+        if (!decode_->status.testAndSetAcquire(BackgroundImageDecode::Queued,
+                                               BackgroundImageDecode::Running))
+        {
+            return;
+        }
+
+        QSize originalSize;
+        QImage img = decodeImage(filePath_, key_.level, originalSize);
+        decode_->image = img;
+        decode_->originalSize = originalSize;
+        decode_->done.release();
+
+        // Note: the cache waits for all tasks to finish before being
+        // destroyed, so cache_ is still valid here. Queued invocations
+        // not yet delivered are discarded when the cache is destroyed.
+        QMetaObject::invokeMethod(cache_, "onImageDecoded_", Qt::QueuedConnection,
+                                  Q_ARG(int, key_.frame),
+                                  Q_ARG(int, key_.level),
+                                  Q_ARG(int, generation_),
+                                  Q_ARG(QImage, img),
+                                  Q_ARG(QSize, originalSize));
+    }
+
+private:
+    BackgroundImageCache * cache_;
+    BackgroundImageKey key_;
+    int generation_;
+    QString filePath_;
+    QSharedPointer<BackgroundImageDecode> decode_;
+};
+
+}
+
+BackgroundImageCache::BackgroundImageCache(QObject * parent) :
+    QObject(parent),
+    images_(static_cast<int>(defaultMaxBytes / 1024)),
+    generation_(0),
+    hasLast_(false)
+{
+    threadPool_.setMaxThreadCount(maxDecodingThreads);
+}
+
+BackgroundImageCache::~BackgroundImageCache()
+{
+    threadPool_.clear();
+    threadPool_.waitForDone();
+}
+
+qint64 BackgroundImageCache::maxBytes() const
+{
+    return static_cast<qint64>(images_.maxCost()) * 1024;
+}
+
+void BackgroundImageCache::setMaxBytes(qint64 maxBytes)
+{
+    images_.setMaxCost(static_cast<int>(maxBytes / 1024));
+}
+
+qint64 BackgroundImageCache::bytes() const
+{
+    return static_cast<qint64>(images_.totalCost()) * 1024;
+}
+
+bool BackgroundImageCache::image(const BackgroundImageKey & key, const QString & filePath, QImage & image)
+{
+    if (QImage * cached = images_.object(key))
+    {
+        ++statistics_.hits;
+        image = *cached;
+        return true;
+    }
+    else if (hasLast_ && lastKey_ == key)
+    {
+        ++statistics_.hits;
+        image = lastImage_;
+        return true;
+    }
+    else
+    {
+        ++statistics_.misses;
+        schedule_(key, filePath);
+        return false;
+    }
+}
+
+QImage BackgroundImageCache::waitForImage(const BackgroundImageKey & key, const QString & filePath)
+{
+    if (contains(key))
+    {
+        QImage res;
+        image(key, filePath, res);
+        return res;
+    }
+    ++statistics_.misses;
+
+    // If the image is scheduled, either cancel its decoding if it hasn't
+    // started yet, since other tasks may be queued before it, or wait for
+    // it. The pending entry is removed so that its queued result, if any,
+    // is ignored by onImageDecoded_().
+    QImage res;
+    QSize originalSize;
+    bool decoded = false;
+    QSharedPointer<BackgroundImageDecode> decode = pending_.take(key);
+    if (decode)
+    {
+        if (decode->status.testAndSetAcquire(BackgroundImageDecode::Queued,
+                                             BackgroundImageDecode::Cancelled))
+        {
+            // Note: a worker may have started the task in the meantime, in
+            // which case it returns immediately and deletes itself, and
+            // tryTake() fails without dereferencing it. No other task can be
+            // allocated at its address meanwhile, since tasks are only
+            // created on this thread.
+            if (threadPool_.tryTake(decode->task))
+            {
+                delete decode->task;
+            }
+        }
+        else
+        {
+            decode->done.acquire();
+            res = decode->image;
+            originalSize = decode->originalSize;
+            decoded = true;
+        }
+    }
+
+    // Otherwise, decode here
+    if (!decoded)
+    {
+        res = decodeImage(filePath, key.level, originalSize);
+    }
+
+    ++statistics_.decodes;
+    if (originalSize.isValid())
+    {
+        originalSizes_[key.frame] = originalSize;
+    }
+    insert_(key, res);
+    return res;
+}
+
+void BackgroundImageCache::prefetch(const BackgroundImageKey & key, const QString & filePath)
+{
+    if (!contains(key))
+    {
+        schedule_(key, filePath);
+    }
+}
+
+bool BackgroundImageCache::contains(const BackgroundImageKey & key) const
+{
+    return images_.contains(key) || (hasLast_ && lastKey_ == key);
+}
+
+QSize BackgroundImageCache::originalSize(int frame) const
+{
+    return originalSizes_.value(frame);
+}
+
+void BackgroundImageCache::clear()
+{
+    // Remove tasks not started yet. Results of running tasks are ignored
+    // thanks to the generation number.
+    threadPool_.clear();
+    ++generation_;
+    pending_.clear();
+    images_.clear();
+    originalSizes_.clear();
+    lastImage_ = QImage();
+    hasLast_ = false;
+}
+
+const BackgroundImageCache::Statistics & BackgroundImageCache::statistics() const
+{
+    return statistics_;
+}
+
+void BackgroundImageCache::resetStatistics()
+{
+    statistics_ = Statistics();
+}
+
+void BackgroundImageCache::schedule_(const BackgroundImageKey & key, const QString & filePath)
+{
+    if (!pending_.contains(key))
+    {
+        QSharedPointer<BackgroundImageDecode> decode(new BackgroundImageDecode());
+        DecodeTask * task = new DecodeTask(this, key, generation_, filePath, decode);
+        decode->task = task;
+        pending_.insert(key, decode);
+        threadPool_.start(task);
+    }
+}
+
+void BackgroundImageCache::insert_(const BackgroundImageKey & key, const QImage & image)
+{
+    // Note: QCache takes ownership of the QImage (which is implicitly shared,
+    // so this doesn't copy pixel data), and may evict least recently used
+    // images, or even refuse this one if it is larger than the budget.
+    int countBefore = images_.count() + (images_.contains(key) ? 0 : 1);
+    images_.insert(key, new QImage(image), costInKiB(image));
+    statistics_.evictions += countBefore - images_.count();
+
+    // Always keep the last decoded image, so that it is available even if
+    // it alone exceeds the budget. Otherwise, clients would request it
+    // again and again.
+    lastKey_ = key;
+    lastImage_ = image;
+    hasLast_ = true;
+}
+
+void BackgroundImageCache::onImageDecoded_(
+        int frame, int level, int generation, QImage image, QSize originalSize)
+{
+    if (generation != generation_)
+    {
+        // Obsolete result: the cache was cleared since this task was started
+        return;
+    }
+
+    BackgroundImageKey key(frame, level);
+    if (!pending_.contains(key))
+    {
+        // Already inserted by waitForImage()
+        return;
+    }
+    pending_.remove(key);
+    ++statistics_.decodes;
+    if (originalSize.isValid())
+    {
+        originalSizes_[frame] = originalSize;
+    }
+    insert_(key, image);
+    emit imageReady(frame, level);
+}
@@ -0,0 +1,172 @@
+// Copyright (C) 2012-2023 The VPaint Developers.
+// See the COPYRIGHT file at the top-level directory of this distribution
+// and at https://github.com/dalboris/vpaint/blob/master/COPYRIGHT
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef BACKGROUND_IMAGE_CACHE_H
+#define BACKGROUND_IMAGE_CACHE_H
+
+#include <QObject>
+#include <QCache>
+#include <QHash>
+#include <QImage>
+#include <QPair>
+#include <QSharedPointer>
+#include <QSize>
+#include <QString>
+#include <QThreadPool>
+
+// Identifies a decoded background image: the reference frame of the image
+// (see Background::referenceFrame()), and its mipmap level. Level L means
+// that the image is decoded at 1/2^L of its original resolution.
+//
+struct BackgroundImageKey
+{
+    int frame;
+    int level;
+
+    BackgroundImageKey(int frame = 0, int level = 0) : frame(frame), level(level) {}
+
+    bool operator==(const BackgroundImageKey & other) const {
+        return frame == other.frame && level == other.level;
+    }
+
+    bool operator!=(const BackgroundImageKey & other) const {
+        return !(*this == other);
+    }
+
+    bool operator<(const BackgroundImageKey & other) const {
+        return frame < other.frame || (frame == other.frame && level < other.level);
+    }
+};
+
+inline uint qHash(const BackgroundImageKey & key, uint seed = 0)
+{
+    return qHash(qMakePair(key.frame, key.level), seed);
+}
+
+// State of a scheduled decode, shared with the worker thread decoding it.
+// Defined in BackgroundImageCache.cpp.
+//
+struct BackgroundImageDecode;
+
+// Decodes background images on worker threads and keeps the most recently
+// used ones in memory, up to a given budget in bytes.
+//
+// Images are identified by a BackgroundImageKey, so that frames sharing the
+// same image share the same cache entry, and so that each image can be
+// decoded at several resolutions. Reduced resolutions are decoded directly
+// at the requested size when the image format supports it (e.g., JPEG), so
+// they are faster to decode than the full resolution.
+//
+// Cached images are converted to RGBA8888 and flipped vertically, that is,
+// they are ready to be uploaded as OpenGL textures without further
+// processing on the render thread.
+//
+// This class is not thread-safe: all its methods must be called from the
+// thread it lives in. Only the decoding itself happens on worker threads.
+//
+class BackgroundImageCache: public QObject
+{
+    Q_OBJECT
+
+public:
+    struct Statistics
+    {
+        qint64 hits = 0;      // Requested image was already decoded
+        qint64 misses = 0;    // Requested image was not decoded yet
+        qint64 decodes = 0;   // Number of images decoded (async or not)
+        qint64 evictions = 0; // Number of images evicted to honor the budget
+    };
+
+    BackgroundImageCache(QObject * parent = 0);
+
+    // Cancels pending decodes and waits for running ones to finish.
+    //
+    ~BackgroundImageCache();
+
+    // Maximum memory used by decoded images, in bytes.
+    //
+    qint64 maxBytes() const;
+    void setMaxBytes(qint64 maxBytes);
+
+    // Memory currently used by decoded images, in bytes.
+    //
+    qint64 bytes() const;
+
+    // If the image for the given key is already decoded, sets `image` to
+    // it and returns true. Otherwise, schedules its decoding from the given
+    // file on a worker thread, and returns false. The signal imageReady()
+    // is emitted once the image is available.
+    //
+    // Note that `image` may be a null QImage when there is no image to draw
+    // for this key, e.g., because the file doesn't exist.
+    //
+    bool image(const BackgroundImageKey & key, const QString & filePath, QImage & image);
+
+    // Same as image(key, filePath, image), but decodes the image on the
+    // calling thread if it is not already decoded. This is useful when the
+    // image is needed right now, e.g., for exporting. If the image is
+    // already scheduled, its decoding is cancelled if not started yet, or
+    // waited for otherwise, so that it is never decoded twice.
+    //
+    QImage waitForImage(const BackgroundImageKey & key, const QString & filePath);
+
+    // Schedules the decoding of the image for the given key, unless it is
+    // already decoded or being decoded. This doesn't count as a hit or miss.
+    //
+    void prefetch(const BackgroundImageKey & key, const QString & filePath);
+
+    // Returns whether the image for the given key is already decoded.
+    //
+    bool contains(const BackgroundImageKey & key) const;
+
+    // Returns the original size of the image of the given reference frame,
+    // or an invalid size if no level of this image was decoded yet.
+    //
+    QSize originalSize(int frame) const;
+
+    // Cancels pending decodes and removes all decoded images.
+    //
+    void clear();
+
+    // Returns hit/miss statistics since creation or last resetStatistics().
+    //
+    const Statistics & statistics() const;
+    void resetStatistics();
+
+signals:
+    void imageReady(int frame, int level);
+
+private slots:
+    void onImageDecoded_(int frame, int level, int generation, QImage image, QSize originalSize);
+
+private:
+    QThreadPool threadPool_;
+    QCache<BackgroundImageKey, QImage> images_; // costs are in KiB
+    QHash<BackgroundImageKey, QSharedPointer<BackgroundImageDecode> > pending_;
+    QHash<int, QSize> originalSizes_;
+    int generation_;
+    Statistics statistics_;
+
+    // Last decoded image, kept even if it doesn't fit the budget
+    BackgroundImageKey lastKey_;
+    QImage lastImage_;
+    bool hasLast_;
+
+    void schedule_(const BackgroundImageKey & key, const QString & filePath);
+    void insert_(const BackgroundImageKey & key, const QImage & image);
+};
+
+#endif // BACKGROUND_IMAGE_CACHE_H
@@ -17,19 +17,82 @@
 #include "BackgroundRenderer.h"
 
 #include "Background.h"
+#include "BackgroundImageCache.h"
 
 #include <QOpenGLContext>
 #include <QOpenGLTexture>
 
+#include <algorithm> // min
+#include <cmath>
+
+namespace
+{
+
+// Default memory budget for textures
+const qint64 defaultMaxTextureBytes = 512 * 1024 * 1024;
+
+// Maximum number of frames decoded ahead of the drawn frame
+const int maxPrefetchedFrames = 8;
+
+// Maximum mipmap level, i.e., images are never decoded smaller than 1/64 of
+// their original size
+const int maxMipmapLevel = 6;
+
+qint64 textureBytes(QOpenGLTexture * texture)
+{
+    // RGBA8 plus a full mipmap chain, which adds one third
+    qint64 bytes = 4 * static_cast<qint64>(texture->width()) * texture->height();
+    return bytes + bytes / 3;
+}
+
+}
+
 BackgroundRenderer::BackgroundRenderer(
         Background * background,
         QObject * parent) :
     QObject(parent),
     background_(background),
-    isCacheDirty_(false)
+    isCacheDirty_(false),
+    isBlocking_(false),
+    imageCache_(new BackgroundImageCache(this)),
+    lastFrame_(0),
+    playDirection_(1),
+    textureBytes_(0),
+    maxTextureBytes_(defaultMaxTextureBytes)
 {
     connect(background_, SIGNAL(cacheCleared()), this, SLOT(setDirty_()));
     connect(background_, SIGNAL(destroyed()), this, SLOT(onBackgroundDestroyed_()));
+    connect(imageCache_, SIGNAL(imageReady(int,int)), this, SIGNAL(imageReady()));
+}
+
+bool BackgroundRenderer::isBlocking() const
+{
+    return isBlocking_;
+}
+
+void BackgroundRenderer::setBlocking(bool blocking)
+{
+    isBlocking_ = blocking;
+}
+
+qint64 BackgroundRenderer::maxTextureBytes() const
+{
+    return maxTextureBytes_;
+}
+
+void BackgroundRenderer::setMaxTextureBytes(qint64 maxBytes)
+{
+    maxTextureBytes_ = maxBytes;
+}
+
+const BackgroundRenderer::TextureStatistics & BackgroundRenderer::textureStatistics() const
+{
+    return textureStatistics_;
+}
+
+BackgroundImageCache * BackgroundRenderer::imageCache() const
+{
+    return imageCache_;
 }
 
 void BackgroundRenderer::cleanup()
@@ -56,6 +119,8 @@ void BackgroundRenderer::cleanup()
 
     // Clear map
     textures_.clear();
+    texturesLru_.clear();
+    textureBytes_ = 0;
 
     // Clear isCacheDirty_ flag
     isCacheDirty_ = false;
@@ -63,6 +128,9 @@ void BackgroundRenderer::cleanup()
 
 void BackgroundRenderer::setDirty_()
 {
+    // Decoded images can be released right away, unlike textures which
+    // require a current OpenGL context
+    imageCache_->clear();
     isCacheDirty_ = true;
 }
 
@@ -78,35 +146,181 @@ void BackgroundRenderer::onBackgroundDestroyed_()
     emit backgroundDestroyed(b);
 }
 
-QOpenGLTexture * BackgroundRenderer::texture_(int frame)
+int BackgroundRenderer::mipmapLevel(int referenceFrame, double displayedWidth, double displayedHeight) const
+{
+    // Always use full resolution in blocking mode (i.e., for export), as
+    // there is no interactivity to preserve.
+    if (isBlocking_)
+    {
+        return 0;
+    }
+
+    // Get original size of image. If not known yet, use the size of the
+    // last drawn image, since image sequences typically have the same size
+    // for all frames.
+    QSize size = imageCache_->originalSize(referenceFrame);
+    if (!size.isValid())
+    {
+        size = imageCache_->originalSize(lastKey_.frame);
+    }
+    if (!size.isValid() || !(displayedWidth > 0) || !(displayedHeight > 0))
+    {
+        return 0;
+    }
+
+    // Find largest level such that the downscaled image is still larger
+    // than the displayed size in both directions
+    double ratio = std::min(size.width() / displayedWidth,
+                            size.height() / displayedHeight);
+    int level = 0;
+    while (level < maxMipmapLevel && ratio >= 2.0)
+    {
+        ratio *= 0.5;
+        ++level;
+    }
+    return level;
+}
+
+QOpenGLTexture * BackgroundRenderer::texture_(int frame, int level)
 {
     // Avoid allocating several textures for frames sharing the same image.
     // If users haven't set a background image at all, this sets frame to 0.
-    frame = background_->referenceFrame(frame);
+    int referenceFrame = background_->referenceFrame(frame);
+    BackgroundImageKey key(referenceFrame, level);
 
-    // Load texture to GPU if not done already
-    if (!textures_.contains(frame))
+    // Return cached texture if already loaded to GPU. Note that the cached
+    // value may be nullptr, see below.
+    auto it = textures_.find(key);
+    if (it != textures_.end())
     {
-        // Get QImage
-        QImage img = background_->image(frame);
+        ++textureStatistics_.hits;
+        texturesLru_.removeOne(key);
+        texturesLru_.append(key);
+        lastKey_ = key;
+        return it.value();
+    }
+    ++textureStatistics_.misses;
 
-        if (img.isNull())
+    // Get decoded image
+    QImage img;
+    QString filePath = background_->resolvedImageFilePath(referenceFrame);
+    if (isBlocking_)
+    {
+        img = imageCache_->waitForImage(key, filePath);
+    }
+    else if (!imageCache_->image(key, filePath, img))
+    {
+        // The image is being decoded. In the meantime, draw something else
+        // rather than flickering.
+        return fallbackTexture_(referenceFrame);
+    }
+
+    // Load texture to GPU. Note: images in cache are already mirrored.
+    //
+    // If the image is null, we set nullptr as cached value, so we won't try
+    // to re-read the file later. This includes the rare cases when the image
+    // couldn't be read, but also includes the very common case where no
+    // background image is set.
+    //
+    QOpenGLTexture * texture = nullptr;
+    if (!img.isNull())
+    {
+        texture = new QOpenGLTexture(img);
+        textureBytes_ += textureBytes(texture);
+    }
+    textures_[key] = texture;
+    texturesLru_.append(key);
+    lastKey_ = key;
+
+    // Honor memory budget
+    evictTextures_(key);
+
+    return texture;
+}
+
+QOpenGLTexture * BackgroundRenderer::fallbackTexture_(int referenceFrame)
+{
+    // Prefer the same image at another resolution, typically while zooming
+    auto it = textures_.lowerBound(BackgroundImageKey(referenceFrame, 0));
+    for (; it != textures_.end() && it.key().frame == referenceFrame; ++it)
+    {
+        if (it.value())
         {
-            // Set nullptr as cached value, so we won't try to re-read the file later.
-            // This includes the rare cases when the image couldn't be read, but
-            // also includes the very common case where no background image is
-            // set.
-            textures_[frame] = nullptr;
+            return it.value();
         }
-        else
+    }
+
+    // Otherwise, keep showing the previously drawn image, if any
+    auto last = textures_.find(lastKey_);
+    return (last != textures_.end()) ? last.value() : nullptr;
+}
+
+void BackgroundRenderer::evictTextures_(const BackgroundImageKey & keptKey)
+{
+    // Note: this is only called from draw(), so we have a current valid
+    // OpenGL context
+    int numCandidates = texturesLru_.size();
+    while (textureBytes_ > maxTextureBytes_ && numCandidates > 0)
+    {
+        BackgroundImageKey key = texturesLru_.takeFirst();
+        --numCandidates;
+        if (key == keptKey)
         {
-            // Load texture to GPU.
-            textures_[frame] = new QOpenGLTexture(img.mirrored());
+            texturesLru_.append(key);
+            continue;
+        }
+
+        QOpenGLTexture * texture = textures_.take(key);
+        if (texture)
+        {
+            textureBytes_ -= textureBytes(texture);
+            texture->destroy();
+            delete texture;
+            ++textureStatistics_.evictions;
         }
     }
+}
 
-    // Returned cached texture
-    return textures_[frame];
+void BackgroundRenderer::prefetch_(int frame, int level)
+{
+    // Guess play direction from the sequence of drawn frames
+    if (frame > lastFrame_)
+    {
+        playDirection_ = 1;
+    }
+    else if (frame < lastFrame_)
+    {
+        playDirection_ = -1;
+    }
+    lastFrame_ = frame;
+
+    // Don't prefetch more than what fits in half the image budget, so that
+    // prefetched images don't evict each other before being drawn.
+    int numPrefetchedFrames = maxPrefetchedFrames;
+    int referenceFrame = background_->referenceFrame(frame);
+    auto it = textures_.find(BackgroundImageKey(referenceFrame, level));
+    if (it != textures_.end() && it.value())
+    {
+        qint64 imageBytes = textureBytes(it.value());
+        qint64 maxImages = imageCache_->maxBytes() / (2 * imageBytes);
+        numPrefetchedFrames = static_cast<int>(
+            std::min(static_cast<qint64>(numPrefetchedFrames), maxImages));
+    }
+
+    // Schedule decoding of upcoming frames in play direction, at the
+    // resolution currently drawn
+    int previousReferenceFrame = referenceFrame;
+    for (int i = 1; i <= numPrefetchedFrames; ++i)
+    {
+        int f = frame + i * playDirection_;
+        BackgroundImageKey key(background_->referenceFrame(f), level);
+        if (key.frame == previousReferenceFrame || textures_.contains(key))
+        {
+            continue;
+        }
+        previousReferenceFrame = key.frame;
+        imageCache_->prefetch(key, background_->resolvedImageFilePath(f));
+    }
 }
 
 namespace
@@ -248,7 +462,9 @@ void BackgroundRenderer::draw(int frame, bool showCanvas,
                               double canvasWidth, double canvasHeight,
 
                               double xSceneMin, double xSceneMax,
-                              double ySceneMin, double ySceneMax)
+                              double ySceneMin, double ySceneMax,
+
+                              double zoom)
 {
     if (!background_) {
         return;
@@ -318,8 +534,17 @@ void BackgroundRenderer::draw(int frame, bool showCanvas,
 
     // ----- Draw background image -----
 
-    // Get texture
-    QOpenGLTexture * texture = texture_(frame);
+    // Get resolution at which to draw the image
+    Eigen::Vector2d displayedSize = zoom * background_->computedSize(Eigen::Vector2d(wc, hc));
+    int level = mipmapLevel(background_->referenceFrame(frame),
+                            std::abs(displayedSize[0]), std::abs(displayedSize[1]));
+
+    // Get texture, and start decoding upcoming frames
+    QOpenGLTexture * texture = texture_(frame, level);
+    if (!isBlocking_)
+    {
+        prefetch_(frame, level);
+    }
 
     // Draw image if non-zero
     if (texture)
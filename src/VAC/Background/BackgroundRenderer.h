@@ -18,8 +18,11 @@
 #define BACKGROUND_RENDERER_H
 
 #include <QObject>
+#include <QList>
 #include <QMap>
 
+#include "BackgroundImageCache.h"
+
 class Background;
 class QOpenGLContext;
 class QOpenGLTexture;
@@ -48,6 +51,11 @@ public:
     // at all, since showCanvas = false would paint the whole window with the
     // background color, which doesn't make sense.
     //
+    // The zoom (number of pixels per scene unit) is used to select the
+    // resolution at which the background image is decoded: when the image
+    // is displayed smaller than its original size, a downscaled version is
+    // decoded and uploaded instead, see mipmapLevel().
+    //
     // XXX We should probably pass a pointer to a canvas object in the
     // constructor, so we don't have to pass that many parameters. (but the
     // 'Canvas' class is not even implemented yet)
@@ -58,11 +66,57 @@ public:
               double canvasWidth, double canvasHeight,
 
               double xSceneMin, double xSceneMax,
-              double ySceneMin, double ySceneMax);
+              double ySceneMin, double ySceneMax,
+
+              double zoom = 1.0);
+
+    // Returns the mipmap level to use for drawing the image of the given
+    // reference frame at the given size in pixels, that is, the largest L
+    // such that the image downscaled by 2^L is still at least as large as
+    // the displayed size. Returns 0 if the original size of the image is
+    // not known yet, or in blocking mode.
+    //
+    int mipmapLevel(int referenceFrame, double displayedWidth, double displayedHeight) const;
+
+    // By default, images are decoded asynchronously: if the image for the
+    // drawn frame is not decoded yet, draw() doesn't wait for it and draws
+    // the most recently drawn image instead (if still in cache), then
+    // imageReady() is emitted when the image becomes available.
+    //
+    // Set blocking = true to make draw() wait for the image instead. This is
+    // typically useful when rendering to an image for exporting.
+    //
+    bool isBlocking() const;
+    void setBlocking(bool blocking);
+
+    // Memory budget for textures, in bytes. Least recently drawn textures
+    // are destroyed (on the next call to draw()) to honor the budget.
+    //
+    qint64 maxTextureBytes() const;
+    void setMaxTextureBytes(qint64 maxBytes);
+
+    // Hit/miss statistics about textures. Statistics about decoded images
+    // are available via imageCache().
+    //
+    struct TextureStatistics
+    {
+        qint64 hits = 0;
+        qint64 misses = 0;
+        qint64 evictions = 0;
+    };
+    const TextureStatistics & textureStatistics() const;
+
+    // Cache of decoded images used by this renderer.
+    //
+    BackgroundImageCache * imageCache() const;
 
 signals:
     void backgroundDestroyed(Background * background);
 
+    // Emitted when an image that was not yet decoded when draw() was called
+    // becomes available. Clients should redraw.
+    void imageReady();
+
 private slots:
     void setDirty_();
     void clearCache_();
@@ -72,9 +126,24 @@ private:
     Background * background_;
 
     bool isCacheDirty_;
+    bool isBlocking_;
+
+    // Decoded images
+    BackgroundImageCache * imageCache_;
+    void prefetch_(int frame, int level);
+    int lastFrame_;
+    int playDirection_; // +1 forward, -1 backward
 
-    QOpenGLTexture * texture_(int frame);
-    QMap<int, QOpenGLTexture *> textures_;
+    // Textures, with least recently used at the front of texturesLru_
+    QOpenGLTexture * texture_(int frame, int level);
+    QOpenGLTexture * fallbackTexture_(int referenceFrame);
+    QMap<BackgroundImageKey, QOpenGLTexture *> textures_;
+    QList<BackgroundImageKey> texturesLru_;
+    BackgroundImageKey lastKey_;
+    qint64 textureBytes_;
+    qint64 maxTextureBytes_;
+    TextureStatistics textureStatistics_;
+    void evictTextures_(const BackgroundImageKey & keptKey);
 };
 
 #endif // BACKGROUND_RENDERER_H
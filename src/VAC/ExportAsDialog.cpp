@@ -18,6 +18,7 @@
 
 #include "FilePath.h"
 #include "Global.h"
+#include "RasterVideoWriter.h"
 #include "Scene.h"
 
 #include <algorithm> // max
@@ -93,7 +94,8 @@ ExportAsDialog::ExportAsDialog(Scene * scene) :
     filenameLineEdit_ = new QLineEdit();
     QString filenameTip = tr(
         "Specify output file path(s), relative to current VPaint file.\n"
-        "The character `*`, if any, will be replaced by the frame number.");
+        "The character `*`, if any, will be replaced by the frame number.\n"
+        "For video formats, `-` writes the video to the standard output.");
     QString browseTip = tr(
         "Browse to select a file path where to export.");
     filenameLineEdit_->setToolTip(filenameTip);
@@ -256,6 +258,12 @@ QString ExportAsDialog::filePath() const {
 
 FrameRangeType ExportAsDialog::frameRangeType() const
 {
+    // Videos always contain all frames
+    const ExportFileTypeInfo* info = this->fileTypeInfo();
+    if (info && info->category() == ExportFileTypeCategory::RasterVideo) {
+        return FrameRangeType::ImageSequenceAll;
+    }
+
     if (singleImage_->isChecked()) {
         return FrameRangeType::SingleImage;
     }
@@ -377,6 +385,7 @@ void ExportAsDialog::onFileTypeChanged_()
 
     const ExportFileTypeInfo* info = this->fileTypeInfo();
     if (info) {
+        bool isVideo = false;
         switch (info->category()) {
         case ExportFileTypeCategory::RasterImage:
             vectorSettingsBox_->hide();
@@ -386,7 +395,16 @@ void ExportAsDialog::onFileTypeChanged_()
             rasterSettingsBox_->hide();
             vectorSettingsBox_->show();
             break;
+        case ExportFileTypeCategory::RasterVideo:
+            vectorSettingsBox_->hide();
+            rasterSettingsBox_->show();
+            isVideo = true;
+            break;
         }
+
+        // The frame range of a video is always all frames
+        singleImage_->setEnabled(!isVideo);
+        imageSequenceAll_->setEnabled(!isVideo);
     }
 }
 
@@ -723,7 +741,14 @@ void ExportAsDialog::updateFilename_(bool isManualEdit)
     // Determine whether the new export filename is an explicit filename that
     // shouldn't be changed even after doing a "Save As".
     //
-    QString defaultFilePath = getDefaultFilePath(documentName, targetExtension, isSingleImage);
+    // Videos are written to a single file, regardless of the frame range
+    //
+    const ExportFileTypeInfo* targetFileTypeInfo = this->fileTypeInfo(targetTypeIndex);
+    bool isVideo = targetFileTypeInfo &&
+        targetFileTypeInfo->category() == ExportFileTypeCategory::RasterVideo;
+    bool isSingleFile = isSingleImage || isVideo;
+
+    QString defaultFilePath = getDefaultFilePath(documentName, targetExtension, isSingleFile);
     if (isManualEdit) {
         if (filePathText.isEmpty() || defaultFilePath == filePathText) {
             hasExplicitExportFilename_ = false;
@@ -749,25 +774,32 @@ void ExportAsDialog::updateFilename_(bool isManualEdit)
     // image" mode if they explicitly edit it while already being in "single
     // image" mode.
     //
-    FilePath path(filePathText);
-    QString stem = path.stem();
-    if (isSingleImage) {
-        if (!isManualEdit) {
-            stem.replace('*', "");
-        }
+    // Videos written to the standard output ("-") are kept as is.
+    //
+    if (isVideo && RasterVideoWriter::isStdoutPath(filePathText)) {
+        filenameLineEdit_->setText(filePathText);
     }
-    else { // image sequence
-        if (!stem.contains('*')) {
-            stem.append('*');
+    else {
+        FilePath path(filePathText);
+        QString stem = path.stem();
+        if (isSingleFile) {
+            if (!isManualEdit || isVideo) {
+                stem.replace('*', "");
+            }
         }
-    }
-    path.replaceStem(stem);
+        else { // image sequence
+            if (!stem.contains('*')) {
+                stem.append('*');
+            }
+        }
+        path.replaceStem(stem);
 
-    // Update extension
-    path.replaceExtension(targetExtension);
+        // Update extension
+        path.replaceExtension(targetExtension);
 
-    // Update file path.
-    filenameLineEdit_->setText(path.toString());
+        // Update file path.
+        filenameLineEdit_->setText(path.toString());
+    }
 
     // Update combo box if needed. We do this last to ensure the path is
     // already updated in case we re-enter this function due to signals/slots.
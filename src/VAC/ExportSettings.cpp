@@ -23,6 +23,8 @@ std::vector<ExportFileTypeInfo> createFileTypes() {
     using C = ExportFileTypeCategory;
     types.emplace_back("svg", "SVG Image", C::VectorImage);
     types.emplace_back("png", "PNG Image", C::RasterImage);
+    types.emplace_back("y4m", "YUV4MPEG2 Video", C::RasterVideo);
+    types.emplace_back("rgba", "Raw RGBA Video", C::RasterVideo);
     return types;
 }
 
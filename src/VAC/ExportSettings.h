@@ -25,8 +25,8 @@
 ///
 enum class ExportFileTypeCategory {
     RasterImage,
-    VectorImage
-    // RasterVideo
+    VectorImage,
+    RasterVideo
     // VectorVideo
 };
 
@@ -24,6 +24,8 @@
 
 #include "OpenGL.h"
 
+#include <cmath>
+
 /*
 void GLUtils::UnitCircleZ()
 {
@@ -240,3 +242,52 @@ void GLUtils::drawArrow(const Eigen::Vector2d & p, const Eigen::Vector2d & u)
     }
     glEnd();
 }
+
+const std::vector<Eigen::Vector2d> & GLUtils::unitCircle()
+{
+    static const std::vector<Eigen::Vector2d> points = []() {
+        const int n = 50;
+        std::vector<Eigen::Vector2d> res;
+        res.reserve(n);
+        for(int i=0; i<n; ++i)
+        {
+            double theta = 2 * (double) i * 3.14159 / (double) n ;
+            res.push_back(Eigen::Vector2d(std::cos(theta), std::sin(theta)));
+        }
+        return res;
+    }();
+    return points;
+}
+
+namespace
+{
+
+void drawCirclePoints(GLenum mode, const Eigen::Vector2d & center, double radius)
+{
+    const std::vector<Eigen::Vector2d> & circle = GLUtils::unitCircle();
+    std::vector<float> vertices;
+    vertices.reserve(2 * circle.size());
+    for(const Eigen::Vector2d & u: circle)
+    {
+        vertices.push_back(static_cast<float>(center[0] + radius * u[0]));
+        vertices.push_back(static_cast<float>(center[1] + radius * u[1]));
+    }
+
+    glEnableClientState(GL_VERTEX_ARRAY);
+    glVertexPointer(2, GL_FLOAT, 0, vertices.data());
+    glDrawArrays(mode, 0, static_cast<GLsizei>(circle.size()));
+    glDisableClientState(GL_VERTEX_ARRAY);
+}
+
+}
+
+void GLUtils::drawDisk(const Eigen::Vector2d & center, double radius)
+{
+    // The polygon is convex, so a fan is equivalent to GL_POLYGON
+    drawCirclePoints(GL_TRIANGLE_FAN, center, radius);
+}
+
+void GLUtils::drawCircle(const Eigen::Vector2d & center, double radius)
+{
+    drawCirclePoints(GL_LINE_LOOP, center, radius);
+}
@@ -22,6 +22,8 @@
 
 #include <Eigen/Core>
 
+#include <vector>
+
 class QOpenGLTexture;
 
 class GLUtils
@@ -56,6 +58,15 @@ public:
                    double x4, double y4, double z4);
 
     static void drawArrow(const Eigen::Vector2d & p, const Eigen::Vector2d & u);
+
+    /// Draws a disk or a circle with the current color, approximated by a
+    /// polygon with as many vertices as unitCircle(). Vertices are sent in
+    /// one draw call rather than one glVertex call each.
+    static void drawDisk(const Eigen::Vector2d & center, double radius);
+    static void drawCircle(const Eigen::Vector2d & center, double radius);
+
+    /// Returns evenly spaced points on the unit circle, counterclockwise.
+    static const std::vector<Eigen::Vector2d> & unitCircle();
     
 private:
     // drawing text
@@ -29,6 +29,7 @@
 #include "EditCanvasSizeDialog.h"
 #include "ExportAsDialog.h"
 #include "FilePath.h"
+#include "RasterVideoWriter.h"
 #include "AboutDialog.h"
 #include "SelectionInfoWidget.h"
 #include "Background/BackgroundWidget.h"
@@ -1108,14 +1109,21 @@ bool MainWindow::doExport()
         return false;
     }
 
+    // Videos are written to a single file (or to stdout) rather than one
+    // file per frame
+    bool isVideo = typeInfo->category() == ExportFileTypeCategory::RasterVideo;
+    bool isStdout = isVideo && RasterVideoWriter::isStdoutPath(exportAsDialog_->filePath());
+
     // Convert relative file path to absolute file path and add '*' whenever required
     QDir documentDir = global()->documentDir();
-    QString baseFilePath = documentDir.absoluteFilePath(exportAsDialog_->filePath());
+    QString baseFilePath = isStdout ?
+        exportAsDialog_->filePath() :
+        documentDir.absoluteFilePath(exportAsDialog_->filePath());
 
     // Add '*' to the stem of the file path whenever required (image sequence)
     FilePath wilcardedFilePath(baseFilePath);
     FrameRangeType frameRangeType = exportAsDialog_->frameRangeType();
-    if (frameRangeType != FrameRangeType::SingleImage) {
+    if (frameRangeType != FrameRangeType::SingleImage && !isVideo) {
         QString stem = wilcardedFilePath.stem();
         if (!stem.contains('*')) {
             stem.append('*');
@@ -1128,7 +1136,7 @@ bool MainWindow::doExport()
     QString prefix = wilcardedFilePathString;
     QString suffix = "";
     QString stem = wilcardedFilePath.stem();
-    bool hasWildcard = stem.contains('*');
+    bool hasWildcard = stem.contains('*') && !isVideo;
     if (hasWildcard) {
         int j = wilcardedFilePathString.lastIndexOf('*');
         prefix = wilcardedFilePathString.left(j);
@@ -1170,12 +1178,14 @@ bool MainWindow::doExport()
     if (files.isEmpty()) {
         return true;
     }
-    QFileInfo fileInfo(files.first().path);
-    QDir parentDir = fileInfo.dir();
-    if (!parentDir.exists()) {
-        bool success = parentDir.mkpath(".");
-        if (!success) {
-            return false;
+    if (!isStdout) {
+        QFileInfo fileInfo(files.first().path);
+        QDir parentDir = fileInfo.dir();
+        if (!parentDir.exists()) {
+            bool success = parentDir.mkpath(".");
+            if (!success) {
+                return false;
+            }
         }
     }
 
@@ -1183,6 +1193,10 @@ bool MainWindow::doExport()
         RasterExportSettings settings = exportAsDialog_->rasterSettings();
         return doExportRasterImages(*typeInfo, settings, files);
     }
+    else if (typeInfo->category() == ExportFileTypeCategory::RasterVideo) {
+        RasterExportSettings settings = exportAsDialog_->rasterSettings();
+        return doExportRasterVideo(*typeInfo, settings, files);
+    }
     else {
         VectorExportSettings settings = exportAsDialog_->vectorSettings();
         return doExportVectorImages(*typeInfo, settings, files);
@@ -1192,7 +1206,8 @@ bool MainWindow::doExport()
 bool MainWindow::doExportRasterImages(
     const ExportFileTypeInfo & /*typeInfo*/,
     const RasterExportSettings & settings,
-    const QVector<ExportFileInfo> & files)
+    const QVector<ExportFileInfo> & files,
+    RasterVideoWriter * videoWriter)
 {
     // Compute how many renders we will need to do
     int numFrames = files.size();
@@ -1278,8 +1293,13 @@ bool MainWindow::doExportRasterImages(
             }
         }
 
-        // Save image to disk
-        success = res.save(files[i].path);
+        // Save image to disk, or append it to the video stream
+        if (videoWriter) {
+            success = videoWriter->writeFrame(res);
+        }
+        else {
+            success = res.save(files[i].path);
+        }
         if (!success) {
             break;
         }
@@ -1291,6 +1311,28 @@ bool MainWindow::doExportRasterImages(
     return success;
 }
 
+bool MainWindow::doExportRasterVideo(
+    const ExportFileTypeInfo & typeInfo,
+    const RasterExportSettings & settings,
+    const QVector<ExportFileInfo> & files)
+{
+    RasterVideoFormat format;
+    QString extension = QString(typeInfo.extension().data());
+    if (!RasterVideoWriter::formatFromExtension(extension, format)) {
+        return false;
+    }
+
+    // All frames share the same file path, see doExport()
+    RasterVideoWriter writer(format, settings.width(), settings.height(), timeline()->fps());
+    if (!writer.open(files.first().path)) {
+        return false;
+    }
+
+    bool success = doExportRasterImages(typeInfo, settings, files, &writer);
+    writer.close();
+    return success;
+}
+
 bool MainWindow::doExportVectorImages(
     const ExportFileTypeInfo & /*typeInfo*/,
     const VectorExportSettings & settings,
@@ -1667,6 +1709,11 @@ void MainWindow::createActions()
     actionHardDelete->setShortcutContext(Qt::ApplicationShortcut);
     connect(actionHardDelete, SIGNAL(triggered()), scene_, SLOT(deleteSelectedCells()));
 
+    // Simplify All
+    actionSimplifyAll = new QAction(tr("Simplify All"), this);
+    actionSimplifyAll->setStatusTip(tr("Remove all vertices that are only joining two edges, in the whole layer."));
+    connect(actionSimplifyAll, SIGNAL(triggered()), scene_, SLOT(simplifyAll()));
+
     // Hard Delete
     actionTest = new QAction(tr("Test"), this);
     actionTest->setStatusTip(tr("For development tests: quick and dirty function."));
@@ -2138,6 +2185,7 @@ void MainWindow::createMenus()
     menuEdit->addSeparator();
     menuEdit->addAction(actionSmartDelete);
     menuEdit->addAction(actionHardDelete);
+    menuEdit->addAction(actionSimplifyAll);
     //menuEdit->addAction(actionTest);
     menuBar()->addMenu(menuEdit);
 
@@ -45,6 +45,7 @@ class AboutDialog;
 class BackgroundWidget;
 class LayersWidget;
 class View3DSettingsWidget;
+class RasterVideoWriter;
 
 namespace VectorAnimationComplex
 {
@@ -199,7 +200,11 @@ private:
     };
     bool doExportRasterImages(const ExportFileTypeInfo & typeInfo,
                               const RasterExportSettings & settings,
-                              const QVector<ExportFileInfo> & files);
+                              const QVector<ExportFileInfo> & files,
+                              RasterVideoWriter * videoWriter = nullptr);
+    bool doExportRasterVideo(const ExportFileTypeInfo & typeInfo,
+                             const RasterExportSettings & settings,
+                             const QVector<ExportFileInfo> & files);
     bool doExportVectorImages(const ExportFileTypeInfo & typeInfo,
                               const VectorExportSettings & settings,
                               const QVector<ExportFileInfo> & files);
@@ -248,6 +253,7 @@ private:
       QAction * actionPaste;
       QAction * actionSmartDelete;
       QAction * actionHardDelete;
+      QAction * actionSimplifyAll;
       QAction * actionTest;
     // VIEW
     QMenu * menuView;
@@ -0,0 +1,216 @@
+// Copyright (C) 2012-2023 The VPaint Developers.
+// See the COPYRIGHT file at the top-level directory of this distribution
+// and at https://github.com/dalboris/vpaint/blob/master/COPYRIGHT
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "RasterVideoWriter.h"
+
+#include <QImage>
+
+#include <algorithm> // min
+#include <cstdio>
+
+#ifdef Q_OS_WIN
+#  include <fcntl.h>
+#  include <io.h>
+#endif
+
+namespace {
+
+// Composites a non-premultiplied RGBA pixel over black, which is what
+// encoders do anyway when discarding the alpha channel.
+inline void premultiplied(const uchar * p, int & r, int & g, int & b)
+{
+    int a = p[3];
+    r = (p[0] * a + 127) / 255;
+    g = (p[1] * a + 127) / 255;
+    b = (p[2] * a + 127) / 255;
+}
+
+// BT.601 studio-range conversion, in fixed-point arithmetic. The constant
+// offsets are folded into the numerator so that it is never negative
+// before the shift.
+inline uchar toY(int r, int g, int b)
+{
+    return static_cast<uchar>((66 * r + 129 * g + 25 * b + 128 + (16 << 8)) >> 8);
+}
+
+inline uchar toCb(int r, int g, int b)
+{
+    return static_cast<uchar>((-38 * r - 74 * g + 112 * b + 128 + (128 << 8)) >> 8);
+}
+
+inline uchar toCr(int r, int g, int b)
+{
+    return static_cast<uchar>((112 * r - 94 * g - 18 * b + 128 + (128 << 8)) >> 8);
+}
+
+} // namespace
+
+RasterVideoWriter::RasterVideoWriter(RasterVideoFormat format, int width, int height, int fps) :
+    format_(format),
+    width_(width),
+    height_(height),
+    fps_(fps > 0 ? fps : 24)
+{
+}
+
+RasterVideoWriter::~RasterVideoWriter()
+{
+    close();
+}
+
+bool RasterVideoWriter::formatFromExtension(const QString & extension, RasterVideoFormat & format)
+{
+    if (extension == "y4m") {
+        format = RasterVideoFormat::Y4M;
+        return true;
+    }
+    else if (extension == "rgba") {
+        format = RasterVideoFormat::RawRGBA;
+        return true;
+    }
+    else {
+        return false;
+    }
+}
+
+bool RasterVideoWriter::open(const QString & filePath)
+{
+    close();
+    headerWritten_ = false;
+
+    if (isStdoutPath(filePath)) {
+#ifdef Q_OS_WIN
+        // Prevent "\n" from being converted to "\r\n" in the binary stream
+        _setmode(_fileno(stdout), _O_BINARY);
+#endif
+        return file_.open(stdout, QIODevice::WriteOnly | QIODevice::Unbuffered);
+    }
+    else {
+        file_.setFileName(filePath);
+        return file_.open(QIODevice::WriteOnly | QIODevice::Truncate);
+    }
+}
+
+bool RasterVideoWriter::writeFrame(const QImage & image)
+{
+    if (!file_.isOpen() || image.width() != width_ || image.height() != height_) {
+        return false;
+    }
+
+    QImage rgba = image.convertToFormat(QImage::Format_RGBA8888);
+    switch (format_) {
+    case RasterVideoFormat::Y4M:
+        return writeY4MFrame_(rgba);
+    case RasterVideoFormat::RawRGBA:
+        return writeRawRGBAFrame_(rgba);
+    }
+    return false;
+}
+
+void RasterVideoWriter::close()
+{
+    if (file_.isOpen()) {
+        file_.flush();
+        file_.close();
+    }
+}
+
+bool RasterVideoWriter::writeY4MHeader_()
+{
+    // Square pixels, progressive, JPEG/MPEG-1 chroma siting
+    QByteArray header = QString("YUV4MPEG2 W%1 H%2 F%3:1 Ip A1:1 C420jpeg\n")
+                            .arg(width_).arg(height_).arg(fps_).toLatin1();
+    headerWritten_ = file_.write(header) == header.size();
+    return headerWritten_;
+}
+
+bool RasterVideoWriter::writeY4MFrame_(const QImage & image)
+{
+    if (!headerWritten_ && !writeY4MHeader_()) {
+        return false;
+    }
+
+    // Plane sizes. Chroma planes are subsampled by two in both directions,
+    // rounding up for odd sizes.
+    const int w = width_;
+    const int h = height_;
+    const int cw = (w + 1) / 2;
+    const int ch = (h + 1) / 2;
+    const size_t ySize = static_cast<size_t>(w) * h;
+    const size_t cSize = static_cast<size_t>(cw) * ch;
+    frameBuffer_.resize(ySize + 2 * cSize);
+    uchar * yPlane  = reinterpret_cast<uchar*>(frameBuffer_.data());
+    uchar * cbPlane = yPlane + ySize;
+    uchar * crPlane = cbPlane + cSize;
+
+    // Luma, one sample per pixel
+    for (int y = 0; y < h; ++y) {
+        const uchar * row = image.constScanLine(y);
+        uchar * yRow = yPlane + static_cast<size_t>(y) * w;
+        for (int x = 0; x < w; ++x) {
+            int r, g, b;
+            premultiplied(row + 4 * x, r, g, b);
+            yRow[x] = toY(r, g, b);
+        }
+    }
+
+    // Chroma, one sample per 2x2 block, computed from the average color
+    for (int cy = 0; cy < ch; ++cy) {
+        int y0 = 2 * cy;
+        int y1 = std::min(y0 + 1, h - 1);
+        const uchar * row0 = image.constScanLine(y0);
+        const uchar * row1 = image.constScanLine(y1);
+        for (int cx = 0; cx < cw; ++cx) {
+            int x0 = 2 * cx;
+            int x1 = std::min(x0 + 1, w - 1);
+            int r = 0, g = 0, b = 0;
+            const uchar * block[4] = {row0 + 4 * x0, row0 + 4 * x1,
+                                      row1 + 4 * x0, row1 + 4 * x1};
+            for (const uchar * p : block) {
+                int pr, pg, pb;
+                premultiplied(p, pr, pg, pb);
+                r += pr;
+                g += pg;
+                b += pb;
+            }
+            r = (r + 2) / 4;
+            g = (g + 2) / 4;
+            b = (b + 2) / 4;
+            size_t k = static_cast<size_t>(cy) * cw + cx;
+            cbPlane[k] = toCb(r, g, b);
+            crPlane[k] = toCr(r, g, b);
+        }
+    }
+
+    static const char frameHeader[] = "FRAME\n";
+    const qint64 frameHeaderSize = sizeof(frameHeader) - 1;
+    const qint64 frameSize = static_cast<qint64>(frameBuffer_.size());
+    return file_.write(frameHeader, frameHeaderSize) == frameHeaderSize &&
+           file_.write(frameBuffer_.data(), frameSize) == frameSize;
+}
+
+bool RasterVideoWriter::writeRawRGBAFrame_(const QImage & image)
+{
+    // Write row by row since scan lines may be padded
+    const qint64 rowSize = 4 * static_cast<qint64>(width_);
+    for (int y = 0; y < height_; ++y) {
+        const char * row = reinterpret_cast<const char*>(image.constScanLine(y));
+        if (file_.write(row, rowSize) != rowSize) {
+            return false;
+        }
+    }
+    return true;
+}
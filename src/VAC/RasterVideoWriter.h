@@ -0,0 +1,118 @@
+// Copyright (C) 2012-2023 The VPaint Developers.
+// See the COPYRIGHT file at the top-level directory of this distribution
+// and at https://github.com/dalboris/vpaint/blob/master/COPYRIGHT
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef RASTER_VIDEO_WRITER_H
+#define RASTER_VIDEO_WRITER_H
+
+#include <QFile>
+#include <QString>
+
+#include <vector>
+
+class QImage;
+
+/// \enum RasterVideoFormat
+/// \brief Specifies the uncompressed stream format written by a
+/// `RasterVideoWriter`.
+///
+enum class RasterVideoFormat {
+    /// YUV4MPEG2 stream (4:2:0, BT.601), readable by most video encoders
+    /// (e.g., `ffmpeg -i -`, `x264 --demuxer y4m`).
+    Y4M,
+
+    /// Headerless sequence of non-premultiplied RGBA8888 frames, in
+    /// top-to-bottom row order. The receiving encoder must be told the
+    /// frame size and frame rate explicitly.
+    RawRGBA
+};
+
+/// \class RasterVideoWriter
+/// \brief Streams rendered frames as uncompressed video to a file or stdout.
+///
+/// This avoids the cost of encoding and decoding one PNG per frame when the
+/// output is meant to be piped into an external video encoder anyway.
+///
+/// \code
+/// RasterVideoWriter writer(RasterVideoFormat::Y4M, 1920, 1080, 24);
+/// if (writer.open("-")) { // "-" means stdout
+///     for (...) {
+///         writer.writeFrame(image);
+///     }
+///     writer.close();
+/// }
+/// \endcode
+///
+class RasterVideoWriter
+{
+public:
+    /// Creates a `RasterVideoWriter` for frames of the given size.
+    ///
+    RasterVideoWriter(RasterVideoFormat format, int width, int height, int fps);
+
+    /// Closes the output if still open.
+    ///
+    ~RasterVideoWriter();
+
+    /// Returns the format of the stream written by this writer.
+    ///
+    RasterVideoFormat format() const {
+        return format_;
+    }
+
+    /// Returns the format matching the given file extension (without the
+    /// leading dot). Returns false if the extension is not a supported raster
+    /// video format.
+    ///
+    static bool formatFromExtension(const QString & extension, RasterVideoFormat & format);
+
+    /// Returns whether the given file path designates the standard output.
+    ///
+    static bool isStdoutPath(const QString & filePath) {
+        return filePath == "-";
+    }
+
+    /// Opens the given file for writing, truncating it if it already exists.
+    /// If `filePath` is "-", frames are written to the standard output.
+    /// Returns whether the output was successfully opened.
+    ///
+    bool open(const QString & filePath);
+
+    /// Appends the given image as a new frame. The image is converted to
+    /// RGBA8888 if needed, and must have the size given at construction.
+    ///
+    bool writeFrame(const QImage & image);
+
+    /// Flushes and closes the output.
+    ///
+    void close();
+
+private:
+    RasterVideoFormat format_;
+    int width_;
+    int height_;
+    int fps_;
+    QFile file_;
+    bool headerWritten_ = false;
+
+    // Reused between frames to avoid per-frame allocations
+    std::vector<char> frameBuffer_;
+
+    bool writeY4MHeader_();
+    bool writeY4MFrame_(const QImage & image);
+    bool writeRawRGBAFrame_(const QImage & image);
+};
+
+#endif // RASTER_VIDEO_WRITER_H
@@ -744,6 +744,15 @@ void Scene::smartDelete()
     }
 }
 
+void Scene::simplifyAll()
+{
+    Layer * layer = activeLayer();
+    if(layer)
+    {
+        layer->vac()->simplifyAll();
+    }
+}
+
 int Scene::numLayers() const
 {
     return layers_.size();
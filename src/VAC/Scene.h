@@ -143,6 +143,7 @@ public slots:
     void test();
     void deleteSelectedCells();
     void smartDelete();
+    void simplifyAll();
     void cut(VectorAnimationComplex::VAC* & clipboard);
     void copy(VectorAnimationComplex::VAC* & clipboard);
     void paste(VectorAnimationComplex::VAC* & clipboard);
@@ -44,10 +44,23 @@ void SelectionInfoWidget::updateInfo()
     VAC * vac = global()->mainWindow()->scene()->activeVAC();
     if(vac)
     {
-        foreach(Cell * c, vac->selectedCells())
+        // Listing the IDs of large selections would be both slow and
+        // unreadable, so we only show how many cells of each type there are
+        const int maxListedCells = 100;
+        if(vac->numSelectedCells() <= maxListedCells)
         {
-            text += QString::number(c->id());
-            text += " ";
+            vac->selectedIds().forEach([&text](int id) {
+                text += QString::number(id);
+                text += " ";
+            });
+        }
+        else
+        {
+            text = QString("%1 cells (%2 vertices, %3 edges, %4 faces)")
+                    .arg(vac->numSelectedCells())
+                    .arg(vac->numSelectedCells(VAC::VertexTypes))
+                    .arg(vac->numSelectedCells(VAC::EdgeTypes))
+                    .arg(vac->numSelectedCells(VAC::FaceTypes));
         }
     }
 
@@ -31,6 +31,7 @@ void Settings::readFromDisk(QSettings & settings)
     dontNotifyConversion_ = settings.value("general-dontnotifyconversion", false).toBool();
     checkVersion_ = Version(settings.value("general-checkversion", qApp->applicationVersion()).toString());
     svgImportVertexMode_ = toSvgImportVertexMode(settings.value("svgimport-vertexmode", toString(defaultSvgImportVertexMode)).toString());
+    svgImportIntersectionMode_ = toSvgImportIntersectionMode(settings.value("svgimport-intersectionmode", toString(defaultSvgImportIntersectionMode)).toString());
 }
 
 void Settings::writeToDisk(QSettings & settings)
@@ -41,6 +42,7 @@ void Settings::writeToDisk(QSettings & settings)
     settings.setValue("general-dontnotifyconversion", dontNotifyConversion_);
     settings.setValue("general-checkversion", checkVersion_.toString());
     settings.setValue("svgimport-vertexmode", toString(svgImportVertexMode_));
+    settings.setValue("svgimport-intersectionmode", toString(svgImportIntersectionMode_));
 }
 
 // Edge width
@@ -65,3 +67,6 @@ void Settings::setCheckVersion(Version value) { checkVersion_ = value; }
 // Import preferences
 SvgImportVertexMode Settings::svgImportVertexMode() const { return svgImportVertexMode_; }
 void Settings::setSvgImportVertexMode(SvgImportVertexMode value) { svgImportVertexMode_ = value; }
+
+SvgImportIntersectionMode Settings::svgImportIntersectionMode() const { return svgImportIntersectionMode_; }
+void Settings::setSvgImportIntersectionMode(SvgImportIntersectionMode value) { svgImportIntersectionMode_ = value; }
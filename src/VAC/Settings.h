@@ -55,6 +55,9 @@ public:
     SvgImportVertexMode svgImportVertexMode() const;
     void setSvgImportVertexMode(SvgImportVertexMode value);
 
+    SvgImportIntersectionMode svgImportIntersectionMode() const;
+    void setSvgImportIntersectionMode(SvgImportIntersectionMode value);
+
 private:
     double edgeWidth_;
     bool showAboutDialogAtStartup_;
@@ -62,6 +65,7 @@ private:
     bool dontNotifyConversion_;
     Version checkVersion_;
     SvgImportVertexMode svgImportVertexMode_;
+    SvgImportIntersectionMode svgImportIntersectionMode_;
 };
 
 #endif
@@ -69,6 +69,20 @@ SvgImportDialog::SvgImportDialog(QWidget * parent) :
     vertexModeButtons->button(static_cast<int>(vertexMode))->setChecked(true);
     connect(vertexModeButtons, SIGNAL(buttonToggled(int, bool)), this, SLOT(vertexModeButtonToggled(int, bool)));
 
+    // Intersection Mode
+    QLabel * intersectionModeLabel = new QLabel(tr("<b>Intersect paths?</b>"));
+    std::vector<std::pair<SvgImportIntersectionMode, QString>> intersectionModes = {
+        {SvgImportIntersectionMode::None,      tr("No, keep paths independent")},
+        {SvgImportIntersectionMode::PlanarMap, tr("Yes, split paths at their intersections (planar map)")}
+    };
+    QButtonGroup * intersectionModeButtons = new QButtonGroup(this);
+    for (auto& p : intersectionModes) {
+        intersectionModeButtons->addButton(new QRadioButton(p.second), static_cast<int>(p.first));
+    }
+    SvgImportIntersectionMode intersectionMode = global()->settings().svgImportIntersectionMode();
+    intersectionModeButtons->button(static_cast<int>(intersectionMode))->setChecked(true);
+    connect(intersectionModeButtons, SIGNAL(buttonToggled(int, bool)), this, SLOT(intersectionModeButtonToggled(int, bool)));
+
     // Dialog button box
     QDialogButtonBox * buttonBox = new QDialogButtonBox(QDialogButtonBox::Ok);
     connect(buttonBox, SIGNAL(accepted()), this, SLOT(accept()));
@@ -83,6 +97,11 @@ SvgImportDialog::SvgImportDialog(QWidget * parent) :
         layout->addWidget(button);
     }
     layout->addSpacing(15);
+    layout->addWidget(intersectionModeLabel);
+    for (auto* button : intersectionModeButtons->buttons()) {
+        layout->addWidget(button);
+    }
+    layout->addSpacing(15);
     layout->addStretch();
     layout->addWidget(buttonBox);
     setLayout(layout);
@@ -92,6 +111,7 @@ SvgImportParams SvgImportDialog::params()
 {
     SvgImportParams res;
     res.vertexMode = global()->settings().svgImportVertexMode();
+    res.intersectionMode = global()->settings().svgImportIntersectionMode();
     return res;
 }
 
@@ -102,3 +122,11 @@ void SvgImportDialog::vertexModeButtonToggled(int id, bool checked)
         global()->settings().setSvgImportVertexMode(v);
     }
 }
+
+void SvgImportDialog::intersectionModeButtonToggled(int id, bool checked)
+{
+    if (checked) {
+        auto v = static_cast<SvgImportIntersectionMode>(id);
+        global()->settings().setSvgImportIntersectionMode(v);
+    }
+}
@@ -32,6 +32,7 @@ public:
 
 private slots:
     void vertexModeButtonToggled(int id, bool checked);
+    void intersectionModeButtonToggled(int id, bool checked);
 
 };
 
@@ -44,8 +44,38 @@ inline QString toString(SvgImportVertexMode m) {
     return QString();
 }
 
+enum class SvgImportIntersectionMode {
+    None,
+    PlanarMap
+};
+
+constexpr auto defaultSvgImportIntersectionMode = SvgImportIntersectionMode::None;
+
+inline SvgImportIntersectionMode toSvgImportIntersectionMode(const QString& s) {
+    if (s == "none")           return SvgImportIntersectionMode::None;
+    else if (s == "planarmap") return SvgImportIntersectionMode::PlanarMap;
+    else return defaultSvgImportIntersectionMode;
+}
+
+inline QString toString(SvgImportIntersectionMode m) {
+    switch (m) {
+    case SvgImportIntersectionMode::None:      return "none";
+    case SvgImportIntersectionMode::PlanarMap: return "planarmap";
+    }
+    return QString();
+}
+
 struct SvgImportParams {
     SvgImportVertexMode vertexMode;
+
+    // Whether imported paths are split at their intersections, so that they
+    // share vertices, as if they had been drawn in planar map mode.
+    SvgImportIntersectionMode intersectionMode = defaultSvgImportIntersectionMode;
+
+    // Maximum distance, in scene coordinates, between the imported curves,
+    // arcs, and their polyline approximation. Imported edges are resampled
+    // anyway, so curves are never sampled more finely than needed for that.
+    double flatteningTolerance = 0.1;
 };
 
 #endif // SVGIMPORTPARAMS_H
@@ -16,8 +16,11 @@
 
 #include "SvgParser.h"
 
+#include <algorithm>
 #include <cmath>
 #include <deque>
+#include <limits>
+#include <memory>
 #include <regex>
 #include <sstream>
 #include <stack>
@@ -28,9 +31,11 @@
 #include <QDebug>
 #include <QMessageBox>
 #include <QRegExp>
+#include <QRunnable>
 #include <QStack>
 #include <QString>
 #include <QStringRef>
+#include <QThreadPool>
 #include <QVector>
 #include <QtGlobal>
 #include <QtMath>
@@ -53,6 +58,7 @@ using VectorAnimationComplex::Cycle;
 using VectorAnimationComplex::EdgeGeometry;
 using VectorAnimationComplex::EdgeSample;
 using VectorAnimationComplex::KeyEdge;
+using VectorAnimationComplex::KeyEdgeList;
 using VectorAnimationComplex::KeyFace;
 using VectorAnimationComplex::KeyHalfedge;
 using VectorAnimationComplex::KeyVertex;
@@ -852,20 +858,87 @@ std::vector<SvgPathCommand> parsePathData(
     return cmds;
 }
 
-// Populates the given `samples` with 12 new samples, tracing the line segment
+// Returns the largest factor by which the given transform may stretch
+// distances, that is, the largest singular value of its linear part.
+//
+double maxScale(const Transform& t)
+{
+    double a = t(0,0), b = t(0,1), c = t(1,0), d = t(1,1);
+    double sumSquares = a*a + b*b + c*c + d*d;
+    double det = a*d - b*c;
+    double disc = std::sqrt(std::max(0.0, sumSquares*sumSquares - 4*det*det));
+    return std::sqrt(0.5 * (sumSquares + disc));
+}
+
+// Determines how many samples are generated when flattening path segments.
+// All distances are in local coordinates, that is, the coordinates of the
+// path data before applying the CTM.
+//
+struct Flattening {
+    // Maximum distance between a curve and its polyline approximation
+    double tolerance;
+
+    // Samples closer than this from the previous sample are discarded when
+    // edges are resampled (see SculptCurve::Curve::resample()), so there is
+    // no point generating them.
+    double minSpacing;
+
+    Flattening(const Transform& ctm, const SvgImportParams& params) {
+        // Imported edges use the default sampling rate of LinearSpline
+        double ds = SculptCurve::Curve<EdgeSample>().ds();
+        double scale = maxScale(ctm);
+        if (scale > 1e-12) {
+            tolerance = params.flatteningTolerance / scale;
+            minSpacing = 0.5 * ds / scale;
+        }
+        else {
+            // Degenerate transform: everything collapses to a point
+            tolerance = minSpacing = std::numeric_limits<double>::infinity();
+        }
+    }
+
+    // Returns the number of segments to use for flattening a curve, given
+    // the number of segments `n` required by the tolerance, and an upper
+    // bound of the length of the curve.
+    //
+    int numSegments(double n, double length) const {
+        const double maxSegments = 1024;
+        n = std::min(n, std::floor(length / minSpacing));
+        n = std::min(n, maxSegments);
+        return (n > 1) ? static_cast<int>(std::ceil(n)) : 1;
+    }
+};
+
+// Returns the number of segments to use for flattening a polynomial curve
+// with uniform parameter steps, given the maximum norm M of its second
+// derivative. This is based on the chord error bound M*h^2/8 over a
+// parameter interval of size h.
+//
+double numSegmentsFromSecondDerivative(double M, double tolerance)
+{
+    return std::sqrt(M / (8 * tolerance));
+}
+
+// Populates the given `samples` with new samples, tracing the line segment
 // [p, q]. The new samples are not spaced uniformly, but instead they follow a
 // geometric progression to avoid overshooting artifacts at the extremeties
 // (i.e., samples are closer from each other at the ends of the line segments,
 // so that corners stay sharp).
 //
+// The progression starts at the minimum spacing of the given `flattening`,
+// since closer samples would be removed by resampling anyway. In particular,
+// short segments only get a sample at q.
+//
 // WARNING: Be careful not to pass p or q as references to EdgeSamples within
 // the `samples` vector (e.g., DO NOT do something like:
 // addLineSamples(samples, samples.back(), q)), since the `samples` vector is
 // populated, which may invalidate previous references.
 //
-void addLineSamples(EdgeSamples& samples, const EdgeSample& p, const EdgeSample& q)
+void addLineSamples(EdgeSamples& samples, const EdgeSample& p, const EdgeSample& q,
+                    const Flattening& flattening)
 {
-    // We double the space each time up to u = 0.5 (then use symmetric values):
+    // We double the space each time up to u = 0.5 (then use symmetric values).
+    // For long segments, this gives:
     //   u0 = 0
     //   u1 = 0.01
     //   u2 = u1 + 2*(u1-u0) = 0.03
@@ -876,22 +949,49 @@ void addLineSamples(EdgeSamples& samples, const EdgeSample& p, const EdgeSample&
     // without overshooting, but the lowest the factor, the less artifact you
     // get.
     //
-    static const std::vector<double> u_ = {
-        0.01, 0.03, 0.07, 0.15, 0.31, 0.5, 0.69, 0.85, 0.93, 0.97, 0.99, 1.0 };
-
-    for (double u : u_) {
-        samples.push_back(p.lerp(u, q));
+    double length = p.distanceTo(q);
+    if (length > 2 * flattening.minSpacing) {
+        const int maxSteps = 8;
+        double u[maxSteps];
+        int n = 0;
+        double h = std::max(0.01, flattening.minSpacing / length);
+        for (double t = h; t < 0.5 && n < maxSteps; h *= 2, t += h) {
+            u[n++] = t;
+        }
+        for (int i = 0; i < n; ++i) {
+            samples.push_back(p.lerp(u[i], q));
+        }
+        samples.push_back(p.lerp(0.5, q));
+        for (int i = n-1; i >= 0; --i) {
+            samples.push_back(p.lerp(1 - u[i], q));
+        }
     }
+    samples.push_back(q);
 }
 
-// This function populates the given VAC at the given time with new vertices
-// and edges based on samples, nodes, pa, ctm, and closed.
+// A flattened subpath, ready to be inserted into a VAC: where to create
+// vertices, and the geometry of the edges between them, in scene coordinates.
+//
+// If there are no vertices, there is exactly one edge, which is closed.
+// Otherwise, edges[i] goes from vertices[i] to vertices[(i+1) % n], and there
+// are n edges if the subpath is closed, n-1 otherwise.
+//
+struct SvgSubpath {
+    EdgeSamples vertices;
+    std::vector<std::unique_ptr<LinearSpline>> edges;
+    bool closed;
+};
+
+using SvgSubpaths = std::vector<SvgSubpath>;
+
+// This function appends to `subpaths` a new subpath based on samples, nodes,
+// pa, ctm, and closed. It doesn't access any VAC, so it can safely be called
+// from worker threads. This is where edge geometries are created (and
+// therefore resampled), which is the most expensive part of the import.
 //
 // If samples.size() == 1, this function does nothing, which makes it correctly
 // handle the first subpath and consecutive M or Z commands.
 //
-// If pa.fill.hasColor, this function also appends a new cycle to cycles.
-//
 // At the end of its processing, this function updates samples and nodes to
 // make them ready for the next subpath, if any.
 //
@@ -905,13 +1005,12 @@ void addLineSamples(EdgeSamples& samples, const EdgeSample& p, const EdgeSample&
 //   nodes   := [0]
 //
 void finishSubpath(
-        VAC* vac,
-        Time time,
         EdgeSamples& samples,
         std::vector<size_t>& nodes,
-        QList<Cycle>& cycles,
+        SvgSubpaths& subpaths,
         const SvgPresentationAttributes& pa,
         const Transform& ctm,
+        const Flattening& flattening,
         const SvgImportParams& params,
         bool closed = false)
 {
@@ -949,7 +1048,7 @@ void finishSubpath(
         // elements are added to samples which may invalidate references.
         EdgeSample p = samples.back();
         EdgeSample q = samples.front();
-        addLineSamples(samples, p, q);
+        addLineSamples(samples, p, q, flattening);
         nodes.push_back(samples.size() - 1);
     }
 
@@ -996,14 +1095,18 @@ void finishSubpath(
         samples[j] = applyTransform(ctm, samples[j]);
     }
 
-    // Create vertices
-    std::vector<KeyVertex*> vertices;
-    vertices.reserve(nodes.size());
+    // Create subpath
+    subpaths.push_back(SvgSubpath());
+    SvgSubpath& subpath = subpaths.back();
+    subpath.closed = closed;
+
+    // Vertex positions
+    subpath.vertices.reserve(nodes.size());
     for (size_t j : nodes) {
-        vertices.push_back(vac->newKeyVertex(time, samples[j]));
+        subpath.vertices.push_back(samples[j]);
     }
 
-    // Create edges
+    // Edge geometries
     //
     // #3: O [*][*]                    => 2 vertices, 1 open edge
     // #4: C [*]                       => 1 vertex,   1 open edge
@@ -1012,26 +1115,20 @@ void finishSubpath(
     // #7: C  *  *  *  *  * [*] *      => 1 vertex,   1 open edge
     // #8: C  *  *  *  *  *  *  *      => 0 vertices, 1 closed edge
     //
-    QList<KeyHalfedge> halfedges;
-    EdgeSamples edgeSamples;
     if (nodes.empty()) {
-        // Create closed edge
+        // Closed edge
         samples.push_back(samples.front());
-        LinearSpline* geometry = new LinearSpline(samples, true);
-        KeyEdge* edge = vac->newKeyEdge(time, geometry);
-        edge->setColor(pa.stroke.color);
-        halfedges.push_back(KeyHalfedge(edge, true));
+        subpath.edges.emplace_back(new LinearSpline(samples, true));
     }
     else {
-        // Create open edges
+        // Open edges
+        EdgeSamples edgeSamples;
         size_t numSamples = samples.size();
-        size_t numVertices = vertices.size(); // == nodes.size()
+        size_t numVertices = nodes.size();
         size_t numEdges = closed ? numVertices : numVertices - 1;
         for (size_t i = 0; i < numEdges; ++i) {
             size_t i1 = i;
             size_t i2 = (i+1) % numVertices;
-            KeyVertex* v1 = vertices[i1];
-            KeyVertex* v2 = vertices[i2];
             size_t j1 = nodes[i1];
             size_t j2 = nodes[i2];
             if (j2 <= j1) {
@@ -1044,8 +1141,54 @@ void finishSubpath(
             for (size_t j = j1; j <= j2; ++j) {
                 edgeSamples.push_back(samples[j % numSamples]);
             }
-            LinearSpline* geometry = new LinearSpline(edgeSamples);
-            KeyEdge* edge = vac->newKeyEdge(time, v1, v2, geometry);
+            subpath.edges.emplace_back(new LinearSpline(edgeSamples));
+        }
+    }
+
+    // Prepare samples and nodes for next subpath (if any)
+    samples.clear();
+    nodes.clear();
+    samples.push_back(lastSample);
+    nodes.push_back(0);
+}
+
+// This function populates the given VAC at the given time with new vertices
+// and edges based on the given subpath, taking ownership of its geometries.
+//
+// If pa.fill.hasColor, this function also appends a new cycle to cycles.
+//
+// If `edges` is not null, the created edges are appended to it.
+//
+void insertSubpath(
+        VAC* vac,
+        Time time,
+        SvgSubpath& subpath,
+        QList<Cycle>& cycles,
+        const SvgPresentationAttributes& pa,
+        KeyEdgeList* edges)
+{
+    // Create vertices
+    std::vector<KeyVertex*> vertices;
+    vertices.reserve(subpath.vertices.size());
+    for (const EdgeSample& sample : subpath.vertices) {
+        vertices.push_back(vac->newKeyVertex(time, sample));
+    }
+
+    // Create edges
+    QList<KeyHalfedge> halfedges;
+    if (vertices.empty()) {
+        // Create closed edge
+        KeyEdge* edge = vac->newKeyEdge(time, subpath.edges.front().release());
+        edge->setColor(pa.stroke.color);
+        halfedges.push_back(KeyHalfedge(edge, true));
+    }
+    else {
+        // Create open edges
+        size_t numVertices = vertices.size();
+        for (size_t i = 0; i < subpath.edges.size(); ++i) {
+            KeyVertex* v1 = vertices[i];
+            KeyVertex* v2 = vertices[(i+1) % numVertices];
+            KeyEdge* edge = vac->newKeyEdge(time, v1, v2, subpath.edges[i].release());
             edge->setColor(pa.stroke.color);
             halfedges.push_back(KeyHalfedge(edge, true));
         }
@@ -1067,11 +1210,12 @@ void finishSubpath(
         cycles.push_back(Cycle(halfedges));
     }
 
-    // Prepare samples and nodes for next subpath (if any)
-    samples.clear();
-    nodes.clear();
-    samples.push_back(lastSample);
-    nodes.push_back(0);
+    // Output created edges
+    if (edges) {
+        for (const KeyHalfedge& h : halfedges) {
+            edges->append(h.edge);
+        }
+    }
 }
 
 // Returns the angle between two vectors
@@ -1085,18 +1229,22 @@ double angle(const Eigen::Vector2d& a, const Eigen::Vector2d& b)
     return atan2(det, dot);
 }
 
-// Creates new vertices, edges, and faces from the given path data commands.
+// Flattens the given path data commands into subpaths, in scene coordinates.
+// This doesn't access any VAC, so it can safely be called from worker threads.
 //
-void importPathData(
-        const std::vector<SvgPathCommand>& cmds, VAC* vac, Time time,
-        SvgPresentationAttributes &pa, const Transform& ctm,
+SvgSubpaths flattenPathData(
+        const std::vector<SvgPathCommand>& cmds,
+        const SvgPresentationAttributes& pa, const Transform& ctm,
         const SvgImportParams& params)
 {
     // Edge width, in local coordinates
     double width = pa.strokeWidth;
 
-    // Previous subpaths (or empty list if no face is to be created)
-    QList<Cycle> cycles;
+    // Number of samples per segment
+    Flattening flattening(ctm, params);
+
+    // Output subpaths
+    SvgSubpaths subpaths;
 
     // Previous samples of current subpath.
     // Invariant: samples.size() > 0:
@@ -1142,7 +1290,7 @@ void importPathData(
             if ( cmd.type == SvgPathCommandType::ClosePath ||
                 (cmd.type == SvgPathCommandType::MoveTo && k == 0)) {
                 bool close = (cmd.type == SvgPathCommandType::ClosePath);
-                finishSubpath(vac, time, samples, nodes, cycles, pa, ctm, params, close);
+                finishSubpath(samples, nodes, subpaths, pa, ctm, flattening, params, close);
                 if (cmd.type == SvgPathCommandType::MoveTo) {
                     if (cmd.relative) {
                         samples[0].translate(args[0], args[1]);
@@ -1170,7 +1318,7 @@ void importPathData(
                     else if (cmd.type == SvgPathCommandType::VLineTo) q.setY(args[0]);
                     else /* LineTo, possibly implicit via MoveTo */   q.setPos(args[0], args[1]);
                 }
-                addLineSamples(samples, p, q);
+                addLineSamples(samples, p, q, flattening);
                 nodes.push_back(samples.size() - 1);
             }
 
@@ -1204,8 +1352,12 @@ void importPathData(
                     s += p;
                 }
                 lastControlPoint = r;
-                // Add 8 samples. Will be resampled anyway later.
-                int nsamples = 8;
+                // Add as many samples as required by the tolerance. Will be
+                // resampled anyway later.
+                double M = 6 * std::max((p - 2*q + r).norm(), (q - 2*r + s).norm());
+                double length = (q - p).norm() + (r - q).norm() + (s - r).norm();
+                int nsamples = flattening.numSegments(
+                    numSegmentsFromSecondDerivative(M, flattening.tolerance), length);
                 double du = 1.0 / static_cast<double>(nsamples);
                 for (int j = 1; j <= nsamples; ++j) {
                     double u = j * du;
@@ -1245,8 +1397,12 @@ void importPathData(
                     r += p;
                 }
                 lastControlPoint = q;
-                // Add 8 samples. Will be resampled anyway later.
-                int nsamples = 8;
+                // Add as many samples as required by the tolerance. Will be
+                // resampled anyway later.
+                double M = 2 * (p - 2*q + r).norm();
+                double length = (q - p).norm() + (r - q).norm();
+                int nsamples = flattening.numSegments(
+                    numSegmentsFromSecondDerivative(M, flattening.tolerance), length);
                 double du = 1.0 / static_cast<double>(nsamples);
                 for (int j = 1; j <= nsamples; ++j) {
                     double u = j * du;
@@ -1275,7 +1431,7 @@ void importPathData(
                 if (rx < eps || ry < eps) {
                     EdgeSample p_ = samples.back();
                     EdgeSample q_(q[0], q[1], width);
-                    addLineSamples(samples, p_, q_);
+                    addLineSamples(samples, p_, q_, flattening);
                 }
                 else {
                     // Correction of out-of-range radii
@@ -1315,8 +1471,12 @@ void importPathData(
                     else if (fs == true && Dtheta < 0) {
                         Dtheta += 2 * M_PI;
                     }
-                    // Add 12 samples per quarter-circle.
-                    int nsamples = 1 + static_cast<int>(std::floor(24 * std::abs(Dtheta) / M_PI));
+                    // Add as many samples as required by the tolerance, using
+                    // the sagitta R*(1-cos(dtheta/2)) of the largest radius.
+                    double R = std::max(rx, ry);
+                    double maxDtheta = 2 * std::acos(std::max(-1.0, 1 - flattening.tolerance / R));
+                    int nsamples = flattening.numSegments(
+                        std::abs(Dtheta) / maxDtheta, R * std::abs(Dtheta));
                     double dtheta = Dtheta / static_cast<double>(nsamples);
                     for (int j = 1; j <= nsamples; ++j) {
                         double theta = theta1 + j * dtheta;
@@ -1330,7 +1490,26 @@ void importPathData(
             previousCommandType = cmd.type;
         }
     }
-    finishSubpath(vac, time, samples, nodes, cycles, pa, ctm, params);
+    finishSubpath(samples, nodes, subpaths, pa, ctm, flattening, params);
+
+    return subpaths;
+}
+
+// Creates new vertices, edges, and faces from the given flattened subpaths.
+// If `edges` is not null, the created edges are appended to it.
+//
+void insertPathData(
+        SvgSubpaths& subpaths, VAC* vac, Time time,
+        const SvgPresentationAttributes& pa,
+        KeyEdgeList* edges = nullptr)
+{
+    // Previous subpaths (or empty list if no face is to be created)
+    QList<Cycle> cycles;
+
+    // Create vertices and edges
+    for (SvgSubpath& subpath : subpaths) {
+        insertSubpath(vac, time, subpath, cycles, pa, edges);
+    }
 
     // Create face from cycles
     if (!cycles.empty()) {
@@ -1339,6 +1518,188 @@ void importPathData(
     }
 }
 
+// A path to import: its path data, either as a string to parse or as already
+// parsed commands (for basic shapes), its style, and its CTM. Once processed,
+// it also holds the resulting subpaths and the path data error, if any.
+//
+struct SvgPathJob {
+    EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+
+    // Input
+    QString d;
+    std::vector<SvgPathCommand> cmds;
+    SvgPresentationAttributes pa;
+    Transform ctm;
+
+    // Output
+    SvgSubpaths subpaths;
+    std::string error;
+
+    // Parses (if needed) and flattens the path data.
+    void process(const SvgImportParams& params) {
+        if (!d.isEmpty()) {
+            cmds = parsePathData(d.toStdString(), &error);
+        }
+        subpaths = flattenPathData(cmds, pa, ctm, params);
+    }
+};
+
+class SvgPathTask: public QRunnable
+{
+public:
+    SvgPathTask(SvgPathJob* job, const SvgImportParams& params) :
+        job_(job), params_(params)
+    {
+    }
+
+    void run() override
+    {
+        job_->process(params_);
+    }
+
+private:
+    SvgPathJob* job_;
+    SvgImportParams params_;
+};
+
+// Imports paths in three stages:
+//
+// 1. The XML reader adds paths, in document order, via addPath().
+//
+// 2. Paths are parsed and flattened on worker threads, by batches. This
+//    happens while the XML reader keeps reading the next batch.
+//
+// 3. Once a batch is processed, its paths are inserted into the VAC, in
+//    document order, so that the result is the same as importing paths one
+//    by one, including the z-ordering of the created cells.
+//
+// As per our error handling policy, a path with invalid path data is imported
+// up to its first error, and subsequent paths are ignored.
+//
+// In SvgImportIntersectionMode::PlanarMap, all imported edges are then split
+// at their intersections in one batch, see VAC::makePlanarMap().
+//
+class SvgPathImporter
+{
+public:
+    SvgPathImporter(VAC* vac, Time time, const SvgImportParams& params) :
+        vac_(vac), time_(time), params_(params), hasError_(false)
+    {
+    }
+
+    // Waits for worker threads, without inserting remaining paths. Call
+    // finish() beforehand to insert them.
+    //
+    ~SvgPathImporter()
+    {
+        threadPool_.waitForDone();
+    }
+
+    // Adds a path whose path data is to be parsed from `d`.
+    //
+    void addPath(const QString& d, const SvgPresentationAttributes& pa, const Transform& ctm)
+    {
+        std::unique_ptr<SvgPathJob> job(new SvgPathJob());
+        job->d = d;
+        job->pa = pa;
+        job->ctm = ctm;
+        add_(std::move(job));
+    }
+
+    // Adds a path whose path data is already parsed.
+    //
+    void addPath(std::vector<SvgPathCommand>&& cmds,
+                 const SvgPresentationAttributes& pa, const Transform& ctm)
+    {
+        std::unique_ptr<SvgPathJob> job(new SvgPathJob());
+        job->cmds = std::move(cmds);
+        job->pa = pa;
+        job->ctm = ctm;
+        add_(std::move(job));
+    }
+
+    // Returns whether a path data error was found so far, in which case
+    // subsequently added paths are ignored.
+    //
+    bool hasError() const
+    {
+        return hasError_;
+    }
+
+    // Processes and inserts all paths added so far.
+    //
+    void finish()
+    {
+        flush_();
+        threadPool_.waitForDone();
+        insertProcessed_();
+        if (params_.intersectionMode == SvgImportIntersectionMode::PlanarMap) {
+            vac_->makePlanarMap(importedEdges_);
+            importedEdges_.clear();
+        }
+    }
+
+private:
+    using Jobs = std::vector<std::unique_ptr<SvgPathJob>>;
+
+    VAC* vac_;
+    Time time_;
+    SvgImportParams params_;
+    QThreadPool threadPool_;
+    Jobs pending_;    // Added, not processed yet
+    Jobs processing_; // Being processed by worker threads
+    bool hasError_;
+    KeyEdgeList importedEdges_; // Only in PlanarMap mode
+
+    // Large enough to amortize the synchronization, small enough to bound
+    // memory usage and keep the insertion stage busy.
+    static const size_t batchSize = 256;
+
+    void add_(std::unique_ptr<SvgPathJob>&& job)
+    {
+        if (hasError_) {
+            return;
+        }
+        pending_.push_back(std::move(job));
+        if (pending_.size() >= batchSize) {
+            flush_();
+        }
+    }
+
+    // Waits for the batch being processed and inserts it, then starts
+    // processing the pending batch.
+    //
+    void flush_()
+    {
+        threadPool_.waitForDone();
+        insertProcessed_();
+        processing_.swap(pending_);
+        if (!hasError_) {
+            for (std::unique_ptr<SvgPathJob>& job : processing_) {
+                threadPool_.start(new SvgPathTask(job.get(), params_));
+            }
+        }
+    }
+
+    void insertProcessed_()
+    {
+        for (std::unique_ptr<SvgPathJob>& job : processing_) {
+            if (hasError_) {
+                break;
+            }
+            if (!job->error.empty()) {
+                // TODO: Show errors to users as a message box rather than printing to console.
+                qDebug() << "ERROR:" << QString::fromStdString(job->error);
+                hasError_ = true;
+            }
+            // Import path data (up to, but not including, first invalid command)
+            bool isPlanarMap = (params_.intersectionMode == SvgImportIntersectionMode::PlanarMap);
+            insertPathData(job->subpaths, vac_, time_, job->pa, isPlanarMap ? &importedEdges_ : nullptr);
+        }
+        processing_.clear();
+    }
+};
+
 // Parses color from string, will probably be moved to a class like CSSColor
 // This implements the most of the W3 specifications
 // found at https://www.w3.org/TR/SVG11/types.html#DataTypeColor
@@ -1532,33 +1893,23 @@ SvgPaint parsePaint(QString s)
     }
 }
 
-bool readPath(const QXmlStreamAttributes& attrs, VAC* vac, Time t,
-              SvgPresentationAttributes &pa, const Transform& ctm,
-              const SvgImportParams& params)
+bool readPath(const QXmlStreamAttributes& attrs, SvgPathImporter& importer,
+              const SvgPresentationAttributes& pa, const Transform& ctm)
 {
     // Don't render if no path data provided
     if(!attrs.hasAttribute("d")) return true;
 
-    // Parse path data.
-    // TODO: Show errors to users as a message box rather than printing to console.
-    std::string error;
-    QString d = attrs.value("d").toString();
-    std::vector<SvgPathCommand> cmds = parsePathData(d.toStdString(), &error);
-    if (!error.empty()) {
-        qDebug() << "ERROR:" << QString::fromStdString(error);
-    }
-
-    // Import path data (up to, but not including, first invalid command)
-    importPathData(cmds, vac, t, pa, ctm, params);
-    return error.empty();
+    // Path data is parsed later, on a worker thread. Errors are reported
+    // by the importer, which then ignores subsequent paths.
+    importer.addPath(attrs.value("d").toString(), pa, ctm);
+    return true;
 }
 
 // Reads a <rect> object
 // https://www.w3.org/TR/SVG11/shapes.html#RectElement
 // @return true on success, false on failure
-bool readRect(const QXmlStreamAttributes& attrs, VAC* vac, Time t,
-              SvgPresentationAttributes &pa, const Transform& ctm,
-              const SvgImportParams& params)
+bool readRect(const QXmlStreamAttributes& attrs, SvgPathImporter& importer,
+              const SvgPresentationAttributes& pa, const Transform& ctm)
 {
     bool okay = true;
 
@@ -1639,13 +1990,12 @@ bool readRect(const QXmlStreamAttributes& attrs, VAC* vac, Time t,
             {SvgPathCommandType::ClosePath, false, {}}
         };
     }
-    importPathData(cmds, vac, t, pa, ctm, params);
+    importer.addPath(std::move(cmds), pa, ctm);
     return true;
 }
 
-bool readCircle(const QXmlStreamAttributes& attrs, VAC* vac, Time t,
-                SvgPresentationAttributes &pa, const Transform& ctm,
-                const SvgImportParams& params)
+bool readCircle(const QXmlStreamAttributes& attrs, SvgPathImporter& importer,
+                const SvgPresentationAttributes& pa, const Transform& ctm)
 {
     bool okay = true;
 
@@ -1681,13 +2031,12 @@ bool readCircle(const QXmlStreamAttributes& attrs, VAC* vac, Time t,
         {SvgPathCommandType::ArcTo,     false, {r, r, 0, 0, 1, cx+r, cy}},
         {SvgPathCommandType::ClosePath, false, {}}
     };
-    importPathData(cmds, vac, t, pa, ctm, params);
+    importer.addPath(std::move(cmds), pa, ctm);
     return true;
 }
 
-bool readEllipse(const QXmlStreamAttributes& attrs, VAC* vac, Time t,
-                 SvgPresentationAttributes &pa, const Transform& ctm,
-                 const SvgImportParams& params)
+bool readEllipse(const QXmlStreamAttributes& attrs, SvgPathImporter& importer,
+                 const SvgPresentationAttributes& pa, const Transform& ctm)
 {
     bool okay = true;
 
@@ -1728,13 +2077,12 @@ bool readEllipse(const QXmlStreamAttributes& attrs, VAC* vac, Time t,
         {SvgPathCommandType::ArcTo,     false, {rx, ry, 0, 0, 1, cx+rx, cy}},
         {SvgPathCommandType::ClosePath, false, {}}
     };
-    importPathData(cmds, vac, t, pa, ctm, params);
+    importer.addPath(std::move(cmds), pa, ctm);
     return true;
 }
 
-bool readLine(const QXmlStreamAttributes& attrs, VAC* vac, Time t,
-              SvgPresentationAttributes &pa, const Transform& ctm,
-              const SvgImportParams& params)
+bool readLine(const QXmlStreamAttributes& attrs, SvgPathImporter& importer,
+              const SvgPresentationAttributes& pa, const Transform& ctm)
 {
     bool okay = true;
 
@@ -1759,14 +2107,13 @@ bool readLine(const QXmlStreamAttributes& attrs, VAC* vac, Time t,
         {SvgPathCommandType::MoveTo, false, {x1, y1}},
         {SvgPathCommandType::LineTo, false, {x2, y2}}
     };
-    importPathData(cmds, vac, t, pa, ctm, params);
+    importer.addPath(std::move(cmds), pa, ctm);
     return true;
 }
 
 bool readPolylineOrPolygon(
-        const QXmlStreamAttributes& attrs, VAC* vac, Time t,
-        SvgPresentationAttributes &pa, const Transform& ctm,
-        const SvgImportParams& params,
+        const QXmlStreamAttributes& attrs, SvgPathImporter& importer,
+        const SvgPresentationAttributes& pa, const Transform& ctm,
         bool isPolygon)
 {
     // Don't render if no points provided
@@ -1820,26 +2167,24 @@ bool readPolylineOrPolygon(
         if (isPolygon) {
             cmds.push_back({SvgPathCommandType::ClosePath, false, {}});
         }
-        importPathData(cmds, vac, t, pa, ctm, params);
+        importer.addPath(std::move(cmds), pa, ctm);
     }
     return 2 * numPoints == numCoords;
 }
 
-bool readPolyline(const QXmlStreamAttributes& attrs, VAC* vac, Time t,
-                  SvgPresentationAttributes &pa, const Transform& ctm,
-                  const SvgImportParams& params)
+bool readPolyline(const QXmlStreamAttributes& attrs, SvgPathImporter& importer,
+                  const SvgPresentationAttributes& pa, const Transform& ctm)
 {
     bool isPolygon = false;
-    return readPolylineOrPolygon(attrs, vac, t, pa, ctm, params, isPolygon);
+    return readPolylineOrPolygon(attrs, importer, pa, ctm, isPolygon);
 
 }
 
-bool readPolygon(const QXmlStreamAttributes& attrs, VAC* vac, Time t,
-                 SvgPresentationAttributes &pa, const Transform& ctm,
-                 const SvgImportParams& params)
+bool readPolygon(const QXmlStreamAttributes& attrs, SvgPathImporter& importer,
+                 const SvgPresentationAttributes& pa, const Transform& ctm)
 {
     bool isPolygon = true;
-    return readPolylineOrPolygon(attrs, vac, t, pa, ctm, params, isPolygon);
+    return readPolylineOrPolygon(attrs, importer, pa, ctm, isPolygon);
 }
 
 // Basic CSS style-attribute parsing. This is not fully compliant (e.g.,
@@ -1938,9 +2283,14 @@ void SvgParser::readSvg(XmlStreamReader & xml, const SvgImportParams& params)
     VAC* vac = global()->scene()->activeVAC();
     Time t = global()->activeTime();
 
+    // Paths are parsed and flattened on worker threads while we keep reading
+    // the XML, then inserted into the VAC in document order.
+    SvgPathImporter importer(vac, t, params);
+
     // Iterate over all XML tokens, including the <svg> start element
-    // which may have style attributes or transforms
-    while (!xml.atEnd())
+    // which may have style attributes or transforms. Stop at the first
+    // erroneous element.
+    while (!xml.atEnd() && !importer.hasError())
     {
         // Process start elements
         if(xml.isStartElement())
@@ -2084,25 +2434,25 @@ void SvgParser::readSvg(XmlStreamReader & xml, const SvgImportParams& params)
             //  animation elements
             //
             else if(xml.name() == "path") {
-                if(!readPath(attrs, vac, t, pa, ctm, params)) return;
+                if(!readPath(attrs, importer, pa, ctm)) break;
             }
             else if(xml.name() == "rect") {
-                if(!readRect(attrs, vac, t, pa, ctm, params)) return;
+                if(!readRect(attrs, importer, pa, ctm)) break;
             }
             else if(xml.name() == "circle") {
-                if(!readCircle(attrs, vac, t, pa, ctm, params)) return;
+                if(!readCircle(attrs, importer, pa, ctm)) break;
             }
             else if(xml.name() == "ellipse") {
-                if(!readEllipse(attrs, vac, t, pa, ctm, params)) return;
+                if(!readEllipse(attrs, importer, pa, ctm)) break;
             }
             else if(xml.name() == "line") {
-                if(!readLine(attrs, vac, t, pa, ctm, params)) return;
+                if(!readLine(attrs, importer, pa, ctm)) break;
             }
             else if(xml.name() == "polyline") {
-                if(!readPolyline(attrs, vac, t, pa, ctm, params)) return;
+                if(!readPolyline(attrs, importer, pa, ctm)) break;
             }
             else if(xml.name() == "polygon") {
-                if(!readPolygon(attrs, vac, t, pa, ctm, params)) return;
+                if(!readPolygon(attrs, importer, pa, ctm)) break;
             }
 
             // TEXT-FONT ELEMENTS: text, font, font-face, altGlyphDef
@@ -2251,6 +2601,9 @@ void SvgParser::readSvg(XmlStreamReader & xml, const SvgImportParams& params)
 
         xml.readNext();
     }
+
+    // Insert remaining paths
+    importer.finish();
 }
 
 SvgPresentationAttributes::SvgPresentationAttributes() :
@@ -17,9 +17,9 @@
 #include "Algorithms.h"
 #include "Cell.h"
 #include "KeyEdge.h"
+#include "KeyVertex.h"
 
-#include <QStack>
-#include <QMap>
+#include <QVector>
 
 namespace VectorAnimationComplex
 {
@@ -27,153 +27,160 @@ namespace VectorAnimationComplex
 namespace Algorithms
 {
 
-CellSet connected(const CellSet & cells)
-{
-    CellSet res = cells;
-    CellSet addedCells = cells;
+quint64 CellMarker::lastEpoch_ = 0;
 
-    // while some cells have been added
-    while(addedCells.size() != 0)
-    {
-        CellSet newAddedCells;
-        foreach(Cell * c, addedCells)
-        {
-            CellSet neighbourhood = c->neighbourhood();
-            foreach(Cell * d, neighbourhood)
-            {
-                if(!res.contains(d))
-                {
-                    res << d;
-                    newAddedCells << d;
-                }
-            }
-        }
-        addedCells = newAddedCells;
-    }
+namespace
+{
 
-    return res;
+// Appends to `res` the cells of `cells` not marked yet, and marks them
+template<class CellContainer>
+void appendUnmarked(const CellContainer & cells, CellMarker & marker, CellList & res)
+{
+    for(Cell * c: cells)
+        if(marker.mark(c))
+            res << c;
 }
 
+// Note: boundary() and star() are not used since they allocate the union
+// of the spatial and temporal boundary (resp. star)
+void appendBoundary(Cell * c, CellMarker & marker, CellList & res)
+{
+    appendUnmarked(c->spatialBoundary(), marker, res);
+    appendUnmarked(c->beforeCells(), marker, res);
+    appendUnmarked(c->afterCells(), marker, res);
+}
 
-CellSet closure(Cell * c)
+void appendStar(Cell * c, CellMarker & marker, CellList & res)
 {
-    CellSet res;
-    res << c;
-    foreach(Cell * b, c->boundary())
-        res << b;
-    return res;
+    appendUnmarked(c->spatialStarCells(), marker, res);
+    appendUnmarked(c->temporalStarBeforeCells(), marker, res);
+    appendUnmarked(c->temporalStarAfterCells(), marker, res);
 }
 
-CellSet closure(const CellSet & cells)
+CellSet toCellSet(const CellList & cells)
 {
     CellSet res;
+    res.reserve(cells.size());
     foreach(Cell * c, cells)
-    {
         res << c;
-        foreach(Cell * b, c->boundary())
-            res << b;
-    }
     return res;
 }
 
-CellSet fullstar(Cell * c)
+}
+
+void connected(const CellSet & cells, CellList & res)
 {
-    CellSet res;
-    res << c;
-    foreach(Cell * b, c->star())
-        res << b;
-    return res;
+    CellMarker marker;
+    int begin = res.size();
+    appendUnmarked(cells, marker, res);
+
+    // Breadth-first traversal, using `res` as queue
+    for(int i=begin; i<res.size(); ++i)
+    {
+        Cell * c = res[i];
+        appendBoundary(c, marker, res);
+        appendStar(c, marker, res);
+    }
 }
 
-CellSet fullstar(const CellSet & cells)
+void closure(const CellSet & cells, CellList & res)
 {
-    CellSet res;
+    // Note: the boundary of a cell is already closed
+    CellMarker marker;
     foreach(Cell * c, cells)
     {
-        res << c;
-        foreach(Cell * b, c->star())
-            res << b;
+        if(marker.mark(c))
+            res << c;
+        appendBoundary(c, marker, res);
     }
-    return res;
 }
 
-// decompose `cells` in a list of connected, mutually disconnected, cells
-QList<KeyEdgeSet> connectedComponents(const KeyEdgeSet & cells)
+void fullstar(const CellSet & cells, CellList & res)
 {
-    // ---- Detect connected components ----
-
-    // Initialize data structure for algorithm
+    // Note: the star of a cell is already "closed" (upward)
+    CellMarker marker;
+    foreach(Cell * c, cells)
+    {
+        if(marker.mark(c))
+            res << c;
+        appendStar(c, marker, res);
+    }
+}
 
-    QMap<KeyEdge *, bool> isMarked;
-    foreach(KeyEdge * edge, cells)
-        isMarked[edge] = false;
+CellSet connected(const CellSet & cells)
+{
+    CellList res;
+    connected(cells, res);
+    return toCellSet(res);
+}
 
-    QMap<KeyEdge *, int> component;
-    foreach(KeyEdge * edge, cells)
-        component[edge] = -1;
+CellSet closure(Cell * c)
+{
+    CellSet cells;
+    cells << c;
+    return closure(cells);
+}
 
-    int numComponents = 0;
+CellSet closure(const CellSet & cells)
+{
+    CellList res;
+    closure(cells, res);
+    return toCellSet(res);
+}
 
+CellSet fullstar(Cell * c)
+{
+    CellSet cells;
+    cells << c;
+    return fullstar(cells);
+}
 
-    // Execute algorithm
+CellSet fullstar(const CellSet & cells)
+{
+    CellList res;
+    fullstar(cells, res);
+    return toCellSet(res);
+}
 
+// decompose `cells` in a list of connected, mutually disconnected, cells
+QList<KeyEdgeSet> connectedComponents(const KeyEdgeSet & cells)
+{
+    // Depth-first traversal of each component. Two edges are incident if
+    // one is in the spatial star of a vertex of the other (see areIncident()).
+    CellMarker marker;
+    QList<KeyEdgeSet> res;
+    QVector<KeyEdge *> stack;
     foreach(KeyEdge * edge, cells)
     {
         // if has already been assigned a connected component, do nothing
-        if(!isMarked[edge])
-        {
-            // create a new connected component
-            numComponents++;
-
-            // create the stack of unvisited but marked edges to visit
-            QStack<KeyEdge *> stack;
+        if(!marker.mark(edge))
+            continue;
 
-            // add the first edge of connected component as marked
-            isMarked[edge] = true;
-            stack.push(edge);
-
-            // While there are edges to visit
-            while(!stack.isEmpty())
+        // create a new connected component
+        res << KeyEdgeSet();
+        KeyEdgeSet & component = res.last();
+        stack << edge;
+        while(!stack.isEmpty())
+        {
+            KeyEdge * edgeToVisit = stack.last();
+            stack.removeLast();
+            component << edgeToVisit;
+            if(edgeToVisit->isClosed())
+                continue;
+
+            KeyVertex * vertices[2] = {edgeToVisit->startVertex(), edgeToVisit->endVertex()};
+            for(KeyVertex * v: vertices)
             {
-                // get unvisited edge
-                KeyEdge * edgeToVisit = stack.pop();
-
-                // Note: edgeToVisit is already marked.
-
-                // visit edge:
-                //  1) assign it a connected component
-                //  2) find other edges to visit
-
-                // Assign connected component
-                component[edgeToVisit] = numComponents-1;
-
-                //  Find other edges to visit
-                foreach(KeyEdge * other, cells)
+                for(Cell * c: v->spatialStarCells())
                 {
-                    if(!isMarked[other]) // note: this exlude other == edgeToVisit
-                    {
-                        if(areIncident(edgeToVisit,other))
-                        {
-                            // mark other, insert it in stack
-                            isMarked[other] = true;
-                            stack.push(other);
-                        }
-                    }
+                    KeyEdge * other = c->toKeyEdge();
+                    if(other && cells.contains(other) && marker.mark(other))
+                        stack << other;
                 }
             }
         }
     }
 
-
-    // ---- Convert to output ----
-
-    QList<KeyEdgeSet> res;
-    for(int i=0; i<numComponents; ++i)
-        res << KeyEdgeSet();
-
-    foreach(KeyEdge * edge, cells)
-        res[component[edge]] << edge;
-
     return res;
 }
 
@@ -18,6 +18,7 @@
 #define ALGORITHMS_H
 
 #include "CellList.h"
+#include "Cell.h"
 
 namespace VectorAnimationComplex
 {
@@ -25,6 +26,49 @@ namespace VectorAnimationComplex
 namespace Algorithms
 {
 
+// Marks cells as visited during a traversal, without allocating: each marker
+// has a new epoch, and a cell is marked if it stores the epoch of the marker.
+// Creating a marker therefore unmarks all cells in constant time.
+//
+// Only one marker must be in use at any given time, since creating a new one
+// implicitly unmarks the cells marked by the previous one. Markers must only
+// be used from the main thread.
+//
+class CellMarker
+{
+public:
+    CellMarker() : epoch_(++lastEpoch_) {}
+
+    bool isMarked(const Cell * c) const { return c->markEpoch_ == epoch_; }
+
+    // Marks the cell and returns true, or returns false if already marked
+    bool mark(Cell * c)
+    {
+        if(c->markEpoch_ == epoch_)
+            return false;
+        c->markEpoch_ = epoch_;
+        return true;
+    }
+
+private:
+    quint64 epoch_;
+    static quint64 lastEpoch_;
+};
+
+// The following functions append to `res` the cells reached by the
+// traversal, without duplicates, and starting with the given cells. They
+// don't allocate anything except for growing `res`, which callers can reuse
+// across calls. Cells already in `res` are not taken into account.
+
+// appends all the cells topologically connected to `cells`
+void connected(const CellSet & cells, CellList & res);
+
+// appends the closure of the set of cells
+void closure(const CellSet & cells, CellList & res);
+
+// appends the full star (star union self) of the set of cells
+void fullstar(const CellSet & cells, CellList & res);
+
 // returns all the cells topologically connected to `cells` (super-set of cells)
 CellSet connected(const CellSet & cells);
 
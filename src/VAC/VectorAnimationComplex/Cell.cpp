@@ -25,6 +25,7 @@
 #include "../Global.h"
 
 #include "Cell.h"
+#include "CellAllocator.h"
 
 #include "VAC.h"
 
@@ -52,7 +53,7 @@ namespace VectorAnimationComplex
 {
 
 Cell::Cell(VAC * vac) :
-    vac_(vac), id_(-1),
+    vac_(vac), id_(-1), markEpoch_(0),
     isHovered_(0), isSelected_(0)
 {
     colorHighlighted_[0] = 1;
@@ -91,10 +92,27 @@ void Cell::destroy()
 {
     vac()->deleteCell(this);
 }
+void * Cell::operator new(std::size_t size)
+{
+    return CellAllocator::instance().allocate(size);
+}
+
+void Cell::operator delete(void * p, std::size_t size)
+{
+    CellAllocator::instance().deallocate(p, size);
+}
+
 void Cell::destroyStar()
 {
-    while(!star().isEmpty())
-        (*star().begin())->destroy();
+    while(!isStarEmpty())
+    {
+        CellRange cells = spatialStarCells();
+        if(cells.isEmpty())
+            cells = temporalStarBeforeCells();
+        if(cells.isEmpty())
+            cells = temporalStarAfterCells();
+        (*cells.begin())->destroy();
+    }
 }
 void Cell::informBoundaryImGettingDestroyed()
 {
@@ -164,6 +182,7 @@ Cell::Cell(Cell * other)
 {
     vac_ = other->vac_;
     id_ = other->id_;
+    markEpoch_ = 0;
     //isHighlighted_ = other->isHighlighted_;
     isHovered_ = 0;
     isSelected_ = other->isSelected_;
@@ -188,7 +207,7 @@ void Cell::remapPointers(VAC * newVAC)
     vac_ = newVAC;
 
     {
-        CellSet old = spatialStar_;
+        auto old = spatialStar_;
         spatialStar_.clear();
         auto it = old.begin();
         auto itEnd = old.end();
@@ -196,7 +215,7 @@ void Cell::remapPointers(VAC * newVAC)
             spatialStar_ << newVAC->getCell((*it)->id());
     }
     {
-        CellSet old = temporalStarBefore_;
+        auto old = temporalStarBefore_;
         temporalStarBefore_.clear();
         auto it = old.begin();
         auto itEnd = old.end();
@@ -204,7 +223,7 @@ void Cell::remapPointers(VAC * newVAC)
             temporalStarBefore_ << newVAC->getCell((*it)->id());
     }
     {
-        CellSet old = temporalStarAfter_;
+        auto old = temporalStarAfter_;
         temporalStarAfter_.clear();
         auto it = old.begin();
         auto itEnd = old.end();
@@ -285,44 +304,55 @@ bool Cell::isHighlighted() const
 
 
 
-void Cell::glColorTopology_()
+void Cell::drawColorTopology_(double * rgba)
 {
+    auto set = [rgba](double r, double g, double b, double a) {
+        rgba[0] = r; rgba[1] = g; rgba[2] = b; rgba[3] = a;
+    };
+
     if(isHighlighted())
-        glColor4dv(colorHighlighted_);
+        set(colorHighlighted_[0], colorHighlighted_[1], colorHighlighted_[2], colorHighlighted_[3]);
     else if(isSelected() && global()->toolMode() == Global::SELECT)
-        glColor4dv(colorSelected_);
+        set(colorSelected_[0], colorSelected_[1], colorSelected_[2], colorSelected_[3]);
     else
     {
         bool inbetweenOutlineDifferentColor = true;
         if(inbetweenOutlineDifferentColor)
         {
             if(toKeyVertex())
-                glColor4d(0,0.165,0.514,1);
+                set(0,0.165,0.514,1);
             else if(toKeyEdge())
-                glColor4d(0.18,0.60,0.90,1);
+                set(0.18,0.60,0.90,1);
             else if(toKeyFace())
-                glColor4d(0.75,0.90,1.00,1);
+                set(0.75,0.90,1.00,1);
             else if(toInbetweenVertex())
-                glColor4d(0.12,0.34,0,1);
+                set(0.12,0.34,0,1);
             else if(toInbetweenEdge())
-                glColor4d(0.47,0.72,0.40,1);
+                set(0.47,0.72,0.40,1);
             else if(toInbetweenFace())
-                glColor4d(0.94,1.00,0.91,1);
+                set(0.94,1.00,0.91,1);
             else // shouldn't happen
-                glColor4d(0,0,0,1);
+                set(0,0,0,1);
         }
         else
         {
             if(toVertexCell())
-                glColor4d(0,0.165,0.514,1);
+                set(0,0.165,0.514,1);
             else if(toEdgeCell())
-                glColor4d(0.18,0.60,0.90,1);
+                set(0.18,0.60,0.90,1);
             else // shouldn't happen
-                glColor4d(0,0,0,1);
+                set(0,0,0,1);
         }
     }
 }
 
+void Cell::glColorTopology_()
+{
+    double rgba[4];
+    drawColorTopology_(rgba);
+    glColor4dv(rgba);
+}
+
 QColor Cell::getColor(Time /*time*/, ViewSettings & /*viewSettings*/) const
 {
     QColor res;
@@ -333,24 +363,41 @@ QColor Cell::getColor(Time /*time*/, ViewSettings & /*viewSettings*/) const
     return res;
 }
 
-void Cell::glColor_(Time time, ViewSettings & viewSettings)
+void Cell::drawColor_(Time time, ViewSettings & viewSettings, double * rgba)
 {
-    if(global()->displayMode() == Global::ILLUSTRATION_OUTLINE && !toFaceCell())
+    // Note: in illustration + outline mode, selection and highlighting of
+    // non-face cells are shown by their outline only
+    const double * color = 0;
+    if(global()->displayMode() != Global::ILLUSTRATION_OUTLINE || toFaceCell())
     {
-        QColor c = getColor(time, viewSettings);
-        glColor4d(c.redF(), c.greenF(), c.blueF(), c.alphaF());
+        if(isHighlighted())
+            color = colorHighlighted_;
+        else if(isSelected() && global()->toolMode() == Global::SELECT)
+            color = colorSelected_;
+    }
+
+    if(color)
+    {
+        for(int i=0; i<4; ++i)
+            rgba[i] = color[i];
     }
-    else if(isHighlighted())
-        glColor4dv(colorHighlighted_);
-    else if(isSelected() && global()->toolMode() == Global::SELECT)
-        glColor4dv(colorSelected_);
     else
     {
         QColor c = getColor(time, viewSettings);
-        glColor4d(c.redF(), c.greenF(), c.blueF(), c.alphaF());
+        rgba[0] = c.redF();
+        rgba[1] = c.greenF();
+        rgba[2] = c.blueF();
+        rgba[3] = c.alphaF();
     }
 }
 
+void Cell::glColor_(Time time, ViewSettings & viewSettings)
+{
+    double rgba[4];
+    drawColor_(time, viewSettings, rgba);
+    glColor4dv(rgba);
+}
+
 void Cell::glColor3D_()
 {
     if(global()->displayMode() == Global::ILLUSTRATION_OUTLINE && !toFaceCell())
@@ -385,6 +432,22 @@ void Cell::drawRaw(Time time, ViewSettings & /*viewSettings*/)
     triangles(time).draw();
 }
 
+void Cell::drawBatched(Time time, ViewSettings & viewSettings, TriangleBatch & batch)
+{
+    if (!exists(time))
+        return;
+
+    double rgba[4];
+    drawColor_(time, viewSettings, rgba);
+    batch.setColor(rgba);
+    drawRawBatched(time, viewSettings, batch);
+}
+
+void Cell::drawRawBatched(Time time, ViewSettings & /*viewSettings*/, TriangleBatch & batch)
+{
+    batch.append(triangles(time));
+}
+
 void Cell::drawPick(Time time, ViewSettings & viewSettings)
 {
     if (!isPickable(time))
@@ -421,6 +484,22 @@ void Cell::drawRawTopology(Time time, ViewSettings & /*viewSettings*/)
     triangles(time).draw();
 }
 
+void Cell::drawTopologyBatched(Time time, ViewSettings & viewSettings, TriangleBatch & batch)
+{
+    if (!exists(time))
+        return;
+
+    double rgba[4];
+    drawColorTopology_(rgba);
+    batch.setColor(rgba);
+    drawRawTopologyBatched(time, viewSettings, batch);
+}
+
+void Cell::drawRawTopologyBatched(Time time, ViewSettings & /*viewSettings*/, TriangleBatch & batch)
+{
+    batch.append(triangles(time));
+}
+
 void Cell::drawPickTopology(Time time, ViewSettings & viewSettings)
 {
     if (!isPickable(time))
@@ -499,14 +578,19 @@ KeyCellSet Cell::afterCells() const { return KeyCellSet(); }
 // -------------- Star --------------
 CellSet Cell::star() const
 {
-    CellSet res = this->spatialStar();
-    CellSet other = this->temporalStar();
-    res.unite(other);
+    CellSet res;
+    res.reserve(spatialStar_.size() + temporalStarBefore_.size() + temporalStarAfter_.size());
+    for(Cell * c: spatialStar_)
+        res << c;
+    for(Cell * c: temporalStarBefore_)
+        res << c;
+    for(Cell * c: temporalStarAfter_)
+        res << c;
     return res;
 }
 CellSet Cell::spatialStar() const
 {
-    return spatialStar_;
+    return spatialStar_.toCellSet();
 }
 CellSet Cell::spatialStar(Time t) const
 {
@@ -521,17 +605,27 @@ CellSet Cell::spatialStar(Time t) const
 }
 CellSet Cell::temporalStar() const
 {
-    CellSet res = this->temporalStarBefore();
-    res.unite(this->temporalStarAfter());
+    CellSet res;
+    res.reserve(temporalStarBefore_.size() + temporalStarAfter_.size());
+    for(Cell * c: temporalStarBefore_)
+        res << c;
+    for(Cell * c: temporalStarAfter_)
+        res << c;
     return res;
 }
 CellSet Cell::temporalStarBefore() const
 {
-    return temporalStarBefore_;
+    return temporalStarBefore_.toCellSet();
 }
 CellSet Cell::temporalStarAfter() const
 {
-    return temporalStarAfter_;
+    return temporalStarAfter_.toCellSet();
+}
+bool Cell::isStarEmpty() const
+{
+    return spatialStar_.isEmpty() &&
+           temporalStarBefore_.isEmpty() &&
+           temporalStarAfter_.isEmpty();
 }
 
 // ---------- Neighbourhood ---------
@@ -609,27 +703,47 @@ void Cell::removeMeFromStarOf_(Cell * c)
 void Cell::addMeToSpatialStarOf_(Cell * c)
 {
     c->spatialStar_ << this;
+    processBoundaryChanged_(c);
 }
 void Cell::addMeToTemporalStarBeforeOf_(Cell *c)
 {
     c->temporalStarBefore_ << this;
+    processBoundaryChanged_(c);
 }
 void Cell::addMeToTemporalStarAfterOf_(Cell *c)
 {
     c->temporalStarAfter_ << this;
-
+    processBoundaryChanged_(c);
 }
 void Cell::removeMeFromSpatialStarOf_(Cell * c)
 {
     c->spatialStar_.remove(this);
+    processBoundaryChanged_(c);
+    if(vac_)
+        vac_->processStarChanged_(c);
 }
 void Cell::removeMeFromTemporalStarBeforeOf_(Cell *c)
 {
     c->temporalStarBefore_.remove(this);
+    processBoundaryChanged_(c);
+    if(vac_)
+        vac_->processStarChanged_(c);
 }
 void Cell::removeMeFromTemporalStarAfterOf_(Cell * c)
 {
     c->temporalStarAfter_.remove(this);
+    processBoundaryChanged_(c);
+    if(vac_)
+        vac_->processStarChanged_(c);
+}
+void Cell::processBoundaryChanged_(Cell * c)
+{
+    // Both this cell and c must be checked by VAC::checkModified()
+    if(vac_)
+    {
+        vac_->setModified_(this);
+        vac_->setModified_(c);
+    }
 }
 
 void Cell::save(QTextStream & out)
@@ -698,7 +812,7 @@ void Cell::read2ndPass()
 // Note: with this constructor, it is the VAC's responsibility
 // to insert it in its list of objects.
 Cell::Cell(VAC * vac, QTextStream & in) :
-    vac_(vac), id_(-1),
+    vac_(vac), id_(-1), markEpoch_(0),
     isHovered_(0), isSelected_(0)
 {
     Field field;
@@ -745,7 +859,7 @@ QString Cell::xmlType_() const
 }
 
 Cell::Cell(VAC * vac, XmlStreamReader & xml) :
-    vac_(vac), id_(-1),
+    vac_(vac), id_(-1), markEpoch_(0),
     isHovered_(0), isSelected_(0)
 {
     id_ = xml.attributes().value("id").toInt();
@@ -779,12 +893,32 @@ Cell::Cell(VAC * vac, XmlStreamReader & xml) :
 
 bool Cell::check() const
 {
-    // check incident cells share the same VAC
-
     // check that the cell belongs to its VAC
     if(!vac()->checkContains(this))
         return false;
 
+    // check that incident cells belong to the same VAC, and that the
+    // boundary knows that this cell is in its star
+    Cell * self = const_cast<Cell *>(this);
+    foreach(Cell * c, spatialBoundary())
+        if(!vac()->checkContains(c) || !c->spatialStar_.contains(self))
+            return false;
+    foreach(KeyCell * c, beforeCells())
+        if(!vac()->checkContains(c) || !c->temporalStarAfter_.contains(self))
+            return false;
+    foreach(KeyCell * c, afterCells())
+        if(!vac()->checkContains(c) || !c->temporalStarBefore_.contains(self))
+            return false;
+    for(Cell * c: spatialStar_)
+        if(!vac()->checkContains(c))
+            return false;
+    for(Cell * c: temporalStarBefore_)
+        if(!vac()->checkContains(c))
+            return false;
+    for(Cell * c: temporalStarAfter_)
+        if(!vac()->checkContains(c))
+            return false;
+
     // other type-specific checks
     return check_();
 }
@@ -840,9 +974,18 @@ bool Cell::intersects(Time t, const BoundingBox & bb) const
 
 void Cell::processGeometryChanged_()
 {
+    if(vac_)
+        vac_->setModified_(this);
+
+    // Within a transaction, the VAC does it once for all changed cells
+    if(vac_ && vac_->deferGeometryChanged_(this))
+        return;
+
     CellSet toClearCells = geometryDependentCells_();
     foreach(Cell * cell, toClearCells)
         cell->clearCachedGeometry_();
+    if(vac_)
+        vac_->processGeometryChanged_(toClearCells);
 }
 
 void Cell::clearCachedGeometry_()
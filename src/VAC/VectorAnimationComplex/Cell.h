@@ -103,11 +103,15 @@
 #include "../ViewSettings.h"
 #include "../View3DSettings.h"
 #include "CellList.h"
+#include "SmallCellSet.h"
 #include "Triangles.h"
+#include "TriangleBatch.h"
 #include "BoundingBox.h"
 #include <QString>
 #include <QRect>
 #include <QColor>
+
+#include <cstddef>
 class QTextStream;
 class XmlStreamWriter;
 class XmlStreamReader;
@@ -117,6 +121,7 @@ namespace VectorAnimationComplex
 
 class CellObserver;
 class KeyHalfedge;
+namespace Algorithms { class CellMarker; }
 
 // The abstract base class Cell
 class Cell
@@ -153,6 +158,10 @@ protected:
     void destroyStar();
     void informBoundaryImGettingDestroyed();
 
+    // Memory of cells is managed by CellAllocator
+    static void * operator new(std::size_t size);
+    static void operator delete(void * p, std::size_t size);
+
     // Cloning (caution: it is the caller's responsibility to
     //                   insert it in the appropriate vac)
     Cell(Cell * other);
@@ -168,6 +177,10 @@ private:
     VAC * vac_;
     int id_;
 
+    // Epoch of the last Algorithms::CellMarker which marked this cell
+    friend class Algorithms::CellMarker;
+    quint64 markEpoch_;
+
     // Observers
     QSet<CellObserver*> observers_;
 
@@ -227,6 +240,11 @@ public:
     CellSet temporalStar() const;
     CellSet temporalStarBefore() const;
     CellSet temporalStarAfter() const;
+    // Same as above, but without copying the star into a new set
+    CellRange spatialStarCells() const { return spatialStar_.range(); }
+    CellRange temporalStarBeforeCells() const { return temporalStarBefore_.range(); }
+    CellRange temporalStarAfterCells() const { return temporalStarAfter_.range(); }
+    bool isStarEmpty() const;
     // ---------- Neighbourhood ---------
     CellSet neighbourhood() const;
     CellSet spatialNeighbourhood() const;
@@ -256,6 +274,7 @@ protected:
     void addMeToTemporalStarAfterOf_(Cell *c);
     void removeMeFromTemporalStarBeforeOf_(Cell *c);
     void removeMeFromTemporalStarAfterOf_(Cell *c);
+    void processBoundaryChanged_(Cell * c); // c is in the boundary of this cell
 
 private:
     // Trusting operators
@@ -273,12 +292,14 @@ private:
     //       (Otherwise, if implemented as a method, it would be necessary
     //        to visit all the cells in the VAC to check those whose boundary
     //        contains this cell)
-    CellSet spatialStar_;
-    CellSet temporalStarBefore_; // We know they are animated cells, but not enforced to be consistent
-    CellSet temporalStarAfter_;  // with spatial star (in which case we know they are either edges of faces)
-                                 // This emphasizes the idea that we do not store any semantics for the star,
-                                 // only for the boundary, and that the star is only stored to inform all of them
-                                 // consistently when a change happened to the boundary
+    //       Most cells have a small star, and most of the time an empty
+    //       temporal star, hence the inline capacities.
+    SmallCellSet<4> spatialStar_;
+    SmallCellSet<1> temporalStarBefore_; // We know they are animated cells, but not enforced to be consistent
+    SmallCellSet<1> temporalStarAfter_;  // with spatial star (in which case we know they are either edges of faces)
+                                         // This emphasizes the idea that we do not store any semantics for the star,
+                                         // only for the boundary, and that the star is only stored to inform all of them
+                                         // consistently when a change happened to the boundary
 
 
 //###################################################################
@@ -311,6 +332,16 @@ public:
     virtual void drawRawTopology(Time time, ViewSettings & viewSettings);
     void drawPickTopology(Time time, ViewSettings & viewSettings);
 
+    // Batched drawing: same as draw() and drawTopology(), but the triangles
+    // are appended to the given batch instead of being drawn immediately,
+    // which is much faster when drawing many cells (see VAC::draw()).
+    // Subclasses reimplementing drawRaw() or drawRawTopology() should
+    // reimplement their batched counterpart accordingly.
+    void drawBatched(Time time, ViewSettings & viewSettings, TriangleBatch & batch);
+    virtual void drawRawBatched(Time time, ViewSettings & viewSettings, TriangleBatch & batch);
+    void drawTopologyBatched(Time time, ViewSettings & viewSettings, TriangleBatch & batch);
+    virtual void drawRawTopologyBatched(Time time, ViewSettings & viewSettings, TriangleBatch & batch);
+
     virtual void draw3D(View3DSettings & viewSettings);
     virtual void drawRaw3D(View3DSettings & viewSettings);
     virtual void drawPick3D(View3DSettings & viewSettings);
@@ -333,6 +364,11 @@ protected:
     virtual QColor getColor(Time time, ViewSettings & viewSettings) const;
     virtual void glColor_(Time time, ViewSettings & viewSettings);
     virtual void glColorTopology_();
+
+    // Compute the color that glColor_() and glColorTopology_() pass to
+    // glColor, as RGBA values in [0, 1]. Used for batched drawing.
+    void drawColor_(Time time, ViewSettings & viewSettings, double * rgba);
+    void drawColorTopology_(double * rgba);
     virtual void glColor3D_();
     double colorHighlighted_[4];
     double colorSelected_[4];
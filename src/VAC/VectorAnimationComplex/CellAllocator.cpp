@@ -0,0 +1,226 @@
+// Copyright (C) 2012-2023 The VPaint Developers.
+// See the COPYRIGHT file at the top-level directory of this distribution
+// and at https://github.com/dalboris/vpaint/blob/master/COPYRIGHT
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "CellAllocator.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <functional>
+#include <new>
+
+namespace VectorAnimationComplex
+{
+
+namespace
+{
+
+// Large blocks are allocated with this many extra bytes, and the address
+// preceding the aligned start of the block stores the address returned by
+// the system.
+const std::size_t largeHeaderSize = 32 + sizeof(char *);
+
+std::size_t roundUp(std::size_t size, std::size_t alignment)
+{
+    return (size + alignment - 1) / alignment * alignment;
+}
+
+char * alignUp(char * p, std::size_t alignment)
+{
+    std::uintptr_t address = reinterpret_cast<std::uintptr_t>(p);
+    return reinterpret_cast<char *>(roundUp(address, alignment));
+}
+
+}
+
+bool CellAllocator::Chunk::isFull() const
+{
+    return !freeBlocks && static_cast<std::size_t>(end - current) < blockSize;
+}
+
+CellAllocator & CellAllocator::instance()
+{
+    // Never destroyed, so that cells can safely be deleted at exit
+    static CellAllocator * allocator = new CellAllocator();
+    return *allocator;
+}
+
+CellAllocator::CellAllocator() :
+    numAllocatedBlocks_(0)
+{
+    for(Chunk * & chunk: availableChunks_)
+        chunk = 0;
+}
+
+void * CellAllocator::allocate(std::size_t size)
+{
+    ++statistics_.allocations;
+    ++numAllocatedBlocks_;
+
+    size = roundUp(size, alignment);
+    if(size > maxBlockSize)
+        return allocateLarge_(size);
+
+    Chunk * chunk = availableChunks_[size / alignment];
+    if(!chunk)
+        chunk = createChunk_(size);
+
+    // Reuse a freed block if any, otherwise take it from the unused part
+    void * res;
+    if(chunk->freeBlocks)
+    {
+        res = chunk->freeBlocks;
+        chunk->freeBlocks = chunk->freeBlocks->next;
+    }
+    else
+    {
+        res = chunk->current;
+        chunk->current += size;
+    }
+    ++chunk->numAllocatedBlocks;
+
+    if(chunk->isFull())
+        makeUnavailable_(chunk);
+
+    return res;
+}
+
+void CellAllocator::deallocate(void * p, std::size_t size)
+{
+    if(!p)
+        return;
+
+    ++statistics_.deallocations;
+    --numAllocatedBlocks_;
+
+    size = roundUp(size, alignment);
+    if(size > maxBlockSize)
+    {
+        deallocateLarge_(static_cast<char *>(p));
+        return;
+    }
+
+    Chunk * chunk = findChunk_(p);
+    FreeBlock * block = static_cast<FreeBlock *>(p);
+    block->next = chunk->freeBlocks;
+    chunk->freeBlocks = block;
+    --chunk->numAllocatedBlocks;
+
+    if(!chunk->isAvailable)
+    {
+        makeAvailable_(chunk);
+    }
+    else if(chunk->numAllocatedBlocks == 0)
+    {
+        // Keep this chunk if it is the only one with free blocks of this
+        // size, otherwise give it back to the system
+        if(chunk->previous || chunk->next)
+            destroyChunk_(chunk);
+    }
+}
+
+void CellAllocator::releaseUnusedMemory()
+{
+    QVector<Chunk *> unusedChunks;
+    for(Chunk * chunk: chunks_)
+        if(chunk->numAllocatedBlocks == 0)
+            unusedChunks << chunk;
+
+    for(Chunk * chunk: unusedChunks)
+        destroyChunk_(chunk);
+}
+
+CellAllocator::Chunk * CellAllocator::createChunk_(std::size_t blockSize)
+{
+    ++statistics_.chunkAllocations;
+
+    char * memory = static_cast<char *>(::operator new(chunkSize + alignment));
+    Chunk * chunk = reinterpret_cast<Chunk *>(alignUp(memory, alignment));
+    chunk->memory = memory;
+    chunk->blockSize = blockSize;
+    chunk->numAllocatedBlocks = 0;
+    chunk->freeBlocks = 0;
+    chunk->current = reinterpret_cast<char *>(chunk) + roundUp(sizeof(Chunk), alignment);
+    chunk->end = reinterpret_cast<char *>(chunk) + chunkSize;
+    chunk->previous = 0;
+    chunk->next = 0;
+    chunk->isAvailable = false;
+
+    chunks_.insert(std::upper_bound(chunks_.begin(), chunks_.end(), chunk, std::less<Chunk *>()), chunk);
+    makeAvailable_(chunk);
+
+    return chunk;
+}
+
+void CellAllocator::destroyChunk_(Chunk * chunk)
+{
+    ++statistics_.chunkDeallocations;
+
+    if(chunk->isAvailable)
+        makeUnavailable_(chunk);
+    chunks_.erase(std::lower_bound(chunks_.begin(), chunks_.end(), chunk, std::less<Chunk *>()));
+    ::operator delete(chunk->memory);
+}
+
+CellAllocator::Chunk * CellAllocator::findChunk_(void * p) const
+{
+    // The chunk of p is the last chunk starting before p
+    Chunk * key = static_cast<Chunk *>(p);
+    QVector<Chunk *>::const_iterator it = std::upper_bound(chunks_.begin(), chunks_.end(), key, std::less<Chunk *>());
+    Q_ASSERT(it != chunks_.begin());
+    return *(it - 1);
+}
+
+void CellAllocator::makeAvailable_(Chunk * chunk)
+{
+    Chunk * & head = availableChunks_[chunk->blockSize / alignment];
+    chunk->previous = 0;
+    chunk->next = head;
+    if(head)
+        head->previous = chunk;
+    head = chunk;
+    chunk->isAvailable = true;
+}
+
+void CellAllocator::makeUnavailable_(Chunk * chunk)
+{
+    Chunk * & head = availableChunks_[chunk->blockSize / alignment];
+    if(chunk->previous)
+        chunk->previous->next = chunk->next;
+    else
+        head = chunk->next;
+    if(chunk->next)
+        chunk->next->previous = chunk->previous;
+    chunk->previous = 0;
+    chunk->next = 0;
+    chunk->isAvailable = false;
+}
+
+char * CellAllocator::allocateLarge_(std::size_t size)
+{
+    ++statistics_.chunkAllocations;
+    char * p = static_cast<char *>(::operator new(size + largeHeaderSize));
+    char * res = alignUp(p + sizeof(char *), alignment);
+    reinterpret_cast<char **>(res)[-1] = p;
+    return res;
+}
+
+void CellAllocator::deallocateLarge_(char * p)
+{
+    ++statistics_.chunkDeallocations;
+    ::operator delete(reinterpret_cast<char **>(p)[-1]);
+}
+
+}
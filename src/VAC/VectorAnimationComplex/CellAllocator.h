@@ -0,0 +1,130 @@
+// Copyright (C) 2012-2023 The VPaint Developers.
+// See the COPYRIGHT file at the top-level directory of this distribution
+// and at https://github.com/dalboris/vpaint/blob/master/COPYRIGHT
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef VAC_CELL_ALLOCATOR_H
+#define VAC_CELL_ALLOCATOR_H
+
+#include <QtGlobal>
+#include <QVector>
+
+#include <cstddef>
+
+namespace VectorAnimationComplex
+{
+
+// Allocates the memory of all cells (see Cell::operator new). Documents
+// contain many small cells, which are created and destroyed all at once
+// when loading, importing, or cloning a VAC (e.g., for undo). Instead of
+// allocating them one by one, we allocate memory by chunks. Each chunk only
+// contains blocks of a given size, and keeps its own list of freed blocks,
+// so that each cell type reuses the memory of deleted cells of the same type.
+//
+// Each chunk also counts its allocated blocks, so that it can be released to
+// the system as soon as all its blocks are deallocated, regardless of cells
+// still alive in other chunks (e.g., owned by undo or clipboard VACs). One
+// empty chunk per size is kept to avoid allocating and releasing a chunk
+// over and over, which releaseUnusedMemory() also releases.
+//
+// The returned memory is aligned for any Eigen type, therefore cells don't
+// need EIGEN_MAKE_ALIGNED_OPERATOR_NEW.
+//
+// This class is not thread-safe: cells must only be created and destroyed
+// from the main thread.
+//
+class CellAllocator
+{
+public:
+    struct Statistics
+    {
+        qint64 allocations = 0;        // Number of calls to allocate()
+        qint64 deallocations = 0;      // Number of calls to deallocate()
+        qint64 chunkAllocations = 0;   // Number of allocations from the system
+        qint64 chunkDeallocations = 0; // Number of deallocations to the system
+    };
+
+    static CellAllocator & instance();
+
+    void * allocate(std::size_t size);
+    void deallocate(void * p, std::size_t size);
+
+    // Returns the number of allocated blocks not deallocated yet.
+    //
+    int numAllocatedBlocks() const { return numAllocatedBlocks_; }
+
+    // Releases to the system all chunks with no allocated block.
+    //
+    void releaseUnusedMemory();
+
+    // Returns allocation statistics since creation or last resetStatistics().
+    // Comparing allocations to chunkAllocations shows how many allocations
+    // from the system were avoided.
+    //
+    const Statistics & statistics() const { return statistics_; }
+    void resetStatistics() { statistics_ = Statistics(); }
+
+private:
+    CellAllocator();
+    Q_DISABLE_COPY(CellAllocator)
+
+    // Block sizes are multiples of alignment. Larger blocks, if any, are
+    // directly allocated from the system.
+    static const std::size_t alignment = 32;
+    static const std::size_t maxBlockSize = 2048;
+    static const std::size_t chunkSize = 64 * 1024;
+
+    struct FreeBlock
+    {
+        FreeBlock * next;
+    };
+
+    // Header at the start of each chunk, followed by its blocks
+    struct Chunk
+    {
+        char * memory;           // Address returned by the system
+        std::size_t blockSize;
+        int numAllocatedBlocks;
+        FreeBlock * freeBlocks;  // Deallocated blocks of this chunk
+        char * current;          // Start of the never allocated part
+        char * end;              // End of the chunk
+        Chunk * previous;        // Siblings in the list of available chunks
+        Chunk * next;            // of the same block size
+        bool isAvailable;
+
+        bool isFull() const;
+    };
+
+    // Chunks with at least one free block, indexed by size / alignment
+    Chunk * availableChunks_[maxBlockSize / alignment + 1];
+
+    // All chunks, sorted by address, to find the chunk of a block
+    QVector<Chunk *> chunks_;
+
+    int numAllocatedBlocks_;
+    Statistics statistics_;
+
+    Chunk * createChunk_(std::size_t blockSize);
+    void destroyChunk_(Chunk * chunk);
+    Chunk * findChunk_(void * p) const;
+    void makeAvailable_(Chunk * chunk);
+    void makeUnavailable_(Chunk * chunk);
+
+    char * allocateLarge_(std::size_t size);
+    void deallocateLarge_(char * p);
+};
+
+}
+
+#endif // VAC_CELL_ALLOCATOR_H
@@ -0,0 +1,298 @@
+// Copyright (C) 2012-2023 The VPaint Developers.
+// See the COPYRIGHT file at the top-level directory of this distribution
+// and at https://github.com/dalboris/vpaint/blob/master/COPYRIGHT
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "CellBitSet.h"
+
+#include <algorithm>
+#include <iterator>
+
+namespace VectorAnimationComplex
+{
+
+namespace
+{
+// IDs below this bound are always given a bit. Above it, they are only given
+// a bit if at least one in maxSparsity bits would be used. Same as CellTable.
+const int minDenseIds = 1 << 20;
+const int maxSparsity = 8;
+}
+
+CellBitSet::CellBitSet() :
+    words_(),
+    sparse_(),
+    count_(0)
+{
+}
+
+bool CellBitSet::containsSparse_(int id) const
+{
+    return std::binary_search(sparse_.begin(), sparse_.end(), id);
+}
+
+bool CellBitSet::containsWord_(int id) const
+{
+    return (id >> 6) < words_.size() && (words_[id >> 6] & (quint64(1) << (id & 63)));
+}
+
+void CellBitSet::setWord_(int id, bool value)
+{
+    if(value)
+        words_[id >> 6] |= quint64(1) << (id & 63);
+    else
+        words_[id >> 6] &= ~(quint64(1) << (id & 63));
+}
+
+void CellBitSet::moveSparseToWords_()
+{
+    const qint64 end = 64LL * words_.size();
+    int k = 0;
+    while(k < sparse_.size() && sparse_[k] < end)
+        setWord_(sparse_[k++], true);
+    if(k > 0)
+        sparse_.remove(0, k);
+}
+
+bool CellBitSet::insert(int id)
+{
+    if(id < 0 || contains(id))
+        return false;
+
+    int i = id >> 6;
+    if(i < words_.size())
+    {
+        setWord_(id, true);
+    }
+    else if(id < qMax<qint64>(minDenseIds, maxSparsity * (count_ + 1LL)))
+    {
+        words_.resize(i + 1); // new words are zero
+        setWord_(id, true);
+        moveSparseToWords_();
+    }
+    else
+    {
+        sparse_.insert(std::lower_bound(sparse_.begin(), sparse_.end(), id), id);
+    }
+    ++count_;
+    return true;
+}
+
+bool CellBitSet::remove(int id)
+{
+    if(!contains(id))
+        return false;
+
+    if((id >> 6) < words_.size())
+        setWord_(id, false);
+    else
+        sparse_.erase(std::lower_bound(sparse_.begin(), sparse_.end(), id));
+    --count_;
+    return true;
+}
+
+void CellBitSet::clear()
+{
+    words_.clear();
+    sparse_.clear();
+    count_ = 0;
+}
+
+CellBitSet & CellBitSet::unite(const CellBitSet & other)
+{
+    const int n = other.words_.size();
+    if(n > words_.size())
+    {
+        words_.resize(n);
+        moveSparseToWords_();
+    }
+    quint64 * w = words_.data();
+    const quint64 * o = other.words_.constData();
+    for(int i=0; i<n; ++i)
+        w[i] |= o[i];
+
+    // Sparse IDs of other: either covered by our words, or merged with ours
+    if(!other.sparse_.isEmpty())
+    {
+        QVector<int> sparse;
+        for(int id: other.sparse_)
+        {
+            if((id >> 6) < words_.size())
+                setWord_(id, true);
+            else
+                sparse << id;
+        }
+        QVector<int> merged;
+        merged.reserve(sparse_.size() + sparse.size());
+        std::set_union(sparse_.begin(), sparse_.end(), sparse.begin(), sparse.end(),
+                       std::back_inserter(merged));
+        sparse_.swap(merged);
+    }
+    updateCount_();
+    return *this;
+}
+
+CellBitSet & CellBitSet::intersect(const CellBitSet & other)
+{
+    // IDs in our words but in the sparse IDs of other. They are beyond the
+    // words of other, so remain sparse once our words are truncated below.
+    QVector<int> sparse;
+    for(int id: other.sparse_)
+        if(containsWord_(id))
+            sparse << id;
+    for(int id: sparse_)
+        if(other.contains(id))
+            sparse << id;
+    sparse_.swap(sparse);
+
+    const int n = std::min(words_.size(), other.words_.size());
+    words_.resize(n);
+    quint64 * w = words_.data();
+    const quint64 * o = other.words_.constData();
+    for(int i=0; i<n; ++i)
+        w[i] &= o[i];
+    updateCount_();
+    return *this;
+}
+
+CellBitSet & CellBitSet::subtract(const CellBitSet & other)
+{
+    const int n = std::min(words_.size(), other.words_.size());
+    quint64 * w = words_.data();
+    const quint64 * o = other.words_.constData();
+    for(int i=0; i<n; ++i)
+        w[i] &= ~o[i];
+
+    for(int id: other.sparse_)
+        if(containsWord_(id))
+            setWord_(id, false);
+    if(!sparse_.isEmpty())
+    {
+        QVector<int> sparse;
+        for(int id: sparse_)
+            if(!other.contains(id))
+                sparse << id;
+        sparse_.swap(sparse);
+    }
+    updateCount_();
+    return *this;
+}
+
+CellBitSet & CellBitSet::toggle(const CellBitSet & other)
+{
+    const int n = other.words_.size();
+    if(n > words_.size())
+    {
+        words_.resize(n);
+        moveSparseToWords_();
+    }
+    quint64 * w = words_.data();
+    const quint64 * o = other.words_.constData();
+    for(int i=0; i<n; ++i)
+        w[i] ^= o[i];
+
+    // Sparse IDs of other: either covered by our words, or toggled in ours
+    if(!other.sparse_.isEmpty())
+    {
+        QVector<int> sparse;
+        for(int id: other.sparse_)
+        {
+            if((id >> 6) < words_.size())
+                setWord_(id, !containsWord_(id));
+            else
+                sparse << id;
+        }
+        QVector<int> merged;
+        merged.reserve(sparse_.size() + sparse.size());
+        std::set_symmetric_difference(sparse_.begin(), sparse_.end(), sparse.begin(), sparse.end(),
+                                      std::back_inserter(merged));
+        sparse_.swap(merged);
+    }
+    updateCount_();
+    return *this;
+}
+
+int CellBitSet::intersectionCount(const CellBitSet & other) const
+{
+    const int n = std::min(words_.size(), other.words_.size());
+    const quint64 * w = words_.constData();
+    const quint64 * o = other.words_.constData();
+    int res = 0;
+    for(int i=0; i<n; ++i)
+        res += qPopulationCount(w[i] & o[i]);
+
+    // IDs that are sparse in at least one of the sets
+    for(int id: sparse_)
+        if(other.contains(id))
+            ++res;
+    for(int id: other.sparse_)
+        if(containsWord_(id))
+            ++res;
+    return res;
+}
+
+int CellBitSet::first() const
+{
+    const int n = words_.size();
+    for(int i=0; i<n; ++i)
+    {
+        if(words_[i])
+            return (i << 6) + static_cast<int>(qCountTrailingZeroBits(words_[i]));
+    }
+    return sparse_.isEmpty() ? -1 : sparse_.first();
+}
+
+bool CellBitSet::operator==(const CellBitSet & other) const
+{
+    if(count_ != other.count_)
+        return false;
+
+    // The same ID may be a bit in one set and sparse in the other, in which
+    // case we compare ID by ID. Since both sets have the same number of IDs,
+    // they are equal if all IDs of one are in the other.
+    if(!sparse_.isEmpty() || !other.sparse_.isEmpty())
+    {
+        bool res = true;
+        forEach([&](int id) { res = res && other.contains(id); });
+        return res;
+    }
+
+    // Trailing zero words don't matter
+    const int n = std::min(words_.size(), other.words_.size());
+    for(int i=0; i<n; ++i)
+    {
+        if(words_[i] != other.words_[i])
+            return false;
+    }
+    return true;
+}
+
+void CellBitSet::updateCount_()
+{
+    // Release trailing zero words, so that iterating and combining sets
+    // doesn't get slower over time as cells are deleted
+    int n = words_.size();
+    while(n > 0 && !words_[n-1])
+        --n;
+    if(n < words_.size())
+        words_.resize(n);
+
+    const quint64 * w = words_.constData();
+    int res = sparse_.size();
+    for(int i=0; i<n; ++i)
+        res += qPopulationCount(w[i]);
+    count_ = res;
+}
+
+}
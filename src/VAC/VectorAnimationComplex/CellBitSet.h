@@ -0,0 +1,114 @@
+// Copyright (C) 2012-2023 The VPaint Developers.
+// See the COPYRIGHT file at the top-level directory of this distribution
+// and at https://github.com/dalboris/vpaint/blob/master/COPYRIGHT
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef CELL_BIT_SET_H
+#define CELL_BIT_SET_H
+
+#include <QVector>
+#include <QtAlgorithms>
+
+namespace VectorAnimationComplex
+{
+
+// A CellBitSet is a set of cell IDs, stored as one bit per ID. Since IDs
+// are allocated consecutively by the VAC (see CellTable), this is compact,
+// and allows to compute unions, intersections and differences of sets of
+// cells 64 IDs at a time.
+//
+// Like in CellTable, IDs that are much larger than the number of IDs in the
+// set (e.g., read from a corrupted file) are not given a bit, since this
+// would require a huge allocation. They are instead stored in a sorted
+// array, which always contains IDs greater than all bits.
+//
+// The number of IDs in the set is cached, so count() is constant-time.
+//
+class CellBitSet
+{
+public:
+    CellBitSet();
+
+    // Number of IDs in the set
+    int count() const { return count_; }
+    bool isEmpty() const { return count_ == 0; }
+
+    // Returns whether the given ID is in the set
+    bool contains(int id) const
+    {
+        if(id >= 0 && (id >> 6) < words_.size())
+            return words_[id >> 6] & (quint64(1) << (id & 63));
+        else
+            return !sparse_.isEmpty() && containsSparse_(id);
+    }
+
+    // Inserts or removes the given ID. Returns whether the set changed.
+    bool insert(int id);
+    bool remove(int id);
+
+    // Removes all IDs
+    void clear();
+
+    // Word-parallel set operations. toggle() computes the symmetric
+    // difference, that is, the IDs that are in exactly one of the two sets.
+    CellBitSet & unite(const CellBitSet & other);
+    CellBitSet & intersect(const CellBitSet & other);
+    CellBitSet & subtract(const CellBitSet & other);
+    CellBitSet & toggle(const CellBitSet & other);
+
+    // Number of IDs in both this set and the other
+    int intersectionCount(const CellBitSet & other) const;
+
+    // Returns the smallest ID in the set, or -1 if the set is empty
+    int first() const;
+
+    // Calls f(id) for all IDs in the set, in increasing order
+    template <typename F>
+    void forEach(F f) const
+    {
+        const int n = words_.size();
+        for(int i=0; i<n; ++i)
+        {
+            quint64 w = words_[i];
+            while(w)
+            {
+                f((i << 6) + static_cast<int>(qCountTrailingZeroBits(w)));
+                w &= w - 1; // clear lowest set bit
+            }
+        }
+        for(int id: sparse_)
+            f(id);
+    }
+
+    bool operator==(const CellBitSet & other) const;
+    bool operator!=(const CellBitSet & other) const { return !(*this == other); }
+
+private:
+    QVector<quint64> words_;
+    QVector<int> sparse_; // sorted, all at least 64 * words_.size()
+    int count_;
+
+    bool containsSparse_(int id) const;
+    bool containsWord_(int id) const;
+    void setWord_(int id, bool value);
+
+    // Moves to words the sparse IDs that they now cover, after words_ grew
+    void moveSparseToWords_();
+
+    void updateCount_();
+};
+
+}
+
+#endif // CELL_BIT_SET_H
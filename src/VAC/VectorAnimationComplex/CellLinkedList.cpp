@@ -100,9 +100,11 @@ void CellLinkedList::splice( CellLinkedList::Iterator pos, CellLinkedList & othe
 
 CellLinkedList::Iterator CellLinkedList::extractTo(CellLinkedList::Iterator pos, CellLinkedList & other)
 {
-    Cell * c = *pos;
-    other.append(c);
-    return erase(pos);
+    // Splice rather than copy, so that iterators to the moved cell remain valid
+    Iterator next = pos;
+    ++next;
+    other.list_.splice(other.list_.end(), list_, pos);
+    return next;
 }
 
 // Reverse methods
@@ -127,9 +129,11 @@ void CellLinkedList::splice(CellLinkedList::ReverseIterator pos, CellLinkedList
 
 CellLinkedList::ReverseIterator CellLinkedList::extractTo(CellLinkedList::ReverseIterator pos, CellLinkedList & other)
 {
-    Cell * c = *pos;
-    other.prepend(c);
-    return erase(pos);
+    Iterator it = (++pos).base();
+    Iterator next = it;
+    ++next;
+    other.list_.splice(other.list_.begin(), list_, it);
+    return ReverseIterator(next);
 }
 
 }
@@ -50,6 +50,7 @@ public:
     Iterator erase(Iterator pos);
     void splice(Iterator pos, CellLinkedList & other );
     Iterator extractTo(Iterator pos, CellLinkedList & other); // append *pos to other, then return erase(pos)
+                                                              // note: iterators to *pos remain valid
 
     // Same in reverse
     ReverseIterator insert(ReverseIterator pos, Cell * cell);
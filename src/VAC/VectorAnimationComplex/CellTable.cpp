@@ -0,0 +1,119 @@
+// Copyright (C) 2012-2023 The VPaint Developers.
+// See the COPYRIGHT file at the top-level directory of this distribution
+// and at https://github.com/dalboris/vpaint/blob/master/COPYRIGHT
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "CellTable.h"
+
+#include <climits>
+
+namespace VectorAnimationComplex
+{
+
+CellTable::CellTable() :
+    slots_(),
+    size_(0)
+{
+}
+
+namespace
+{
+// IDs below this bound are always given a slot. Above it, they are only given
+// a slot if at least one in maxSparsity slots would be used.
+const int minDenseIds = 1 << 20;
+const int maxSparsity = 8;
+}
+
+CellTable::const_iterator CellTable::begin() const
+{
+    Cell * const * data = slots_.constData();
+    return const_iterator(data, data + slots_.size(), sparse_.constBegin());
+}
+
+CellTable::const_iterator CellTable::end() const
+{
+    Cell * const * dataEnd = slots_.constData() + slots_.size();
+    return const_iterator(dataEnd, dataEnd, sparse_.constEnd());
+}
+
+void CellTable::insert(int id, Cell * cell)
+{
+    if(id < 0 || !cell)
+        return;
+
+    if(id >= slots_.size())
+    {
+        qint64 denseLimit = qMax<qint64>(minDenseIds, maxSparsity * (size_ + 1LL));
+        if(id < denseLimit)
+        {
+            growSlots_(id);
+        }
+        else
+        {
+            if(!sparse_.contains(id))
+                ++size_;
+            sparse_.insert(id, cell);
+            return;
+        }
+    }
+
+    if(!slots_[id])
+        ++size_;
+    slots_[id] = cell;
+}
+
+void CellTable::growSlots_(int id)
+{
+    // Grow geometrically, since IDs are usually inserted in increasing order
+    if(id >= slots_.capacity())
+        slots_.reserve(qMin<qint64>(2LL * id + 16, INT_MAX));
+    slots_.resize(id + 1); // new slots are null
+
+    // Keep all IDs of the sparse map greater than all slots
+    while(!sparse_.isEmpty() && sparse_.firstKey() <= id)
+    {
+        int sparseId = sparse_.firstKey();
+        slots_[sparseId] = sparse_.take(sparseId);
+    }
+}
+
+void CellTable::remove(int id)
+{
+    if(id >= slots_.size())
+    {
+        if(sparse_.remove(id))
+            --size_;
+    }
+    else if(id >= 0 && slots_[id])
+    {
+        slots_[id] = 0;
+        --size_;
+
+        // Release trailing empty slots
+        int n = slots_.size();
+        while(n > 0 && !slots_[n-1])
+            --n;
+        if(n < slots_.size())
+            slots_.resize(n);
+    }
+}
+
+void CellTable::clear()
+{
+    slots_.clear();
+    sparse_.clear();
+    size_ = 0;
+}
+
+}
@@ -0,0 +1,129 @@
+// Copyright (C) 2012-2023 The VPaint Developers.
+// See the COPYRIGHT file at the top-level directory of this distribution
+// and at https://github.com/dalboris/vpaint/blob/master/COPYRIGHT
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef CELL_TABLE_H
+#define CELL_TABLE_H
+
+#include <QVector>
+#include <QMap>
+
+namespace VectorAnimationComplex
+{
+
+class Cell;
+
+// A CellTable stores the cells of a VAC, accessible by ID. Cells are stored
+// in a dense array indexed by ID, which makes lookups constant-time, and
+// iteration a linear scan of contiguous memory, in increasing ID order.
+//
+// IDs are never reused by the VAC, and are usually small since they are
+// allocated consecutively. Slots of removed cells are left empty, and are
+// skipped during iteration.
+//
+// IDs that are much larger than the number of cells (e.g., read from a
+// corrupted file) are not given a slot, since this would require a huge
+// allocation. Such cells are instead stored in a sparse map, which always
+// contains IDs greater than all slots.
+//
+// The table is implicitly shared, so copying it is cheap until either copy
+// is modified. In particular, iterating over it with foreach() is safe even
+// if cells are inserted or removed during the iteration.
+//
+class CellTable
+{
+public:
+    CellTable();
+
+    // Iterates over the cells in increasing ID order
+    class const_iterator
+    {
+    public:
+        const_iterator() : p_(0), end_(0), it_() {}
+        Cell * operator*() const { return (p_ != end_) ? *p_ : it_.value(); }
+        const_iterator & operator++()
+        {
+            if(p_ != end_) { ++p_; skipEmptySlots_(); }
+            else           { ++it_; }
+            return *this;
+        }
+        bool operator==(const const_iterator & other) const { return p_ == other.p_ && it_ == other.it_; }
+        bool operator!=(const const_iterator & other) const { return !(*this == other); }
+
+    private:
+        friend class CellTable;
+        typedef QMap<int, Cell*>::const_iterator SparseIterator;
+        const_iterator(Cell * const * p, Cell * const * end, SparseIterator it) :
+            p_(p), end_(end), it_(it) { skipEmptySlots_(); }
+        void skipEmptySlots_() { while(p_ != end_ && !*p_) ++p_; }
+        Cell * const * p_;
+        Cell * const * end_;
+        SparseIterator it_;
+    };
+    typedef const_iterator ConstIterator;
+    const_iterator begin() const;
+    const_iterator end() const;
+
+    // Number of cells
+    int size() const { return size_; }
+    bool isEmpty() const { return size_ == 0; }
+
+    // Returns whether there is a cell with the given ID
+    bool contains(int id) const { return value(id) != 0; }
+
+    // Returns the cell with the given ID, or 0 if there is none
+    Cell * value(int id) const
+    {
+        if(id >= 0 && id < slots_.size())
+            return slots_[id];
+        else if(!sparse_.isEmpty())
+            return sparse_.value(id, 0);
+        else
+            return 0;
+    }
+
+    // Returns the cell with the highest ID, or 0 if the table is empty. This
+    // does not scan empty slots since trailing empty slots are always
+    // released.
+    Cell * last() const
+    {
+        if(!sparse_.isEmpty())
+            return sparse_.last();
+        else
+            return slots_.isEmpty() ? 0 : slots_.last();
+    }
+
+    // Inserts a cell, replacing the cell with the same ID if any
+    void insert(int id, Cell * cell);
+
+    // Removes the cell with the given ID, if any
+    void remove(int id);
+
+    // Removes all cells
+    void clear();
+
+private:
+    QVector<Cell*> slots_;
+    QMap<int, Cell*> sparse_;
+    int size_;
+
+    // Grows the slot array so that it contains the given ID, and moves to
+    // slots the cells of the sparse map whose ID is now covered
+    void growSlots_(int id);
+};
+
+}
+
+#endif // CELL_TABLE_H
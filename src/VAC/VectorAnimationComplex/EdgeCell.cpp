@@ -121,7 +121,7 @@ EdgeCellSet EdgeCell::incidentEdges() const
 {
     CellSet incidentCells;
     foreach(Cell * c, spatialBoundary())
-        foreach(Cell * d, c->spatialStar())
+        for(Cell * d: c->spatialStarCells())
             if(d != this)
             incidentCells << d;
     return incidentCells;
@@ -174,6 +174,19 @@ void EdgeCell::drawRawTopology(Time time, ViewSettings & viewSettings)
     }
 }
 
+void EdgeCell::drawRawTopologyBatched(Time time, ViewSettings & viewSettings, TriangleBatch & batch)
+{
+    bool screenRelative = viewSettings.screenRelative();
+    if(screenRelative)
+    {
+        batch.append(triangles(viewSettings.edgeTopologyWidth() / viewSettings.zoom(), time));
+    }
+    else
+    {
+        batch.append(triangles(viewSettings.edgeTopologyWidth(), time));
+    }
+}
+
 EdgeSample EdgeCell::startSample(Time time) const
 {
     QList<EdgeSample> sampling = getSampling(time);
@@ -46,6 +46,7 @@ public:
     using Cell::triangles;
     const Triangles & triangles(double width, Time time) const;
     void drawRawTopology(Time time, ViewSettings & viewSettings);
+    void drawRawTopologyBatched(Time time, ViewSettings & viewSettings, TriangleBatch & batch);
 
     // Geometric getters
     virtual QList<EdgeSample> getSampling(Time time) const = 0;
@@ -570,65 +570,43 @@ void triangulateHelper(const QList<EdgeSample> & samples, Triangles & triangles,
         quads[i].by = samples[i].y() - h * v[1];
     }
 
-    // tesselate
-    for(int i=1; i<n; i++)
+    // tesselate, sharing the Ai's and Bi's between adjacent quads
+    const int m = 50; // number of vertices of caps
+    triangles.reserve(2*n + (closed ? 0 : 2*(m+1)),
+                      2*(n-1) + (closed ? 0 : 2*m));
+    for(int i=0; i<n; i++)
     {
-        double ax = quads[i-1].ax;
-        double ay = quads[i-1].ay;
-        double bx = quads[i-1].bx;
-        double by = quads[i-1].by;
-
-        double cx = quads[i].ax;
-        double cy = quads[i].ay;
-        double dx = quads[i].bx;
-        double dy = quads[i].by;
-
-
-        triangles.append(ax,ay,bx,by,dx,dy);
-        triangles.append(ax,ay,dx,dy,cx,cy);
+        triangles.addVertex(quads[i].ax, quads[i].ay); // index 2*i
+        triangles.addVertex(quads[i].bx, quads[i].by); // index 2*i+1
     }
-
-    // Start cap
-    if (!closed)
+    for(int i=1; i<n; i++)
     {
-        int m = 50;
-        double cx = samples.front().x();
-        double cy = samples.front().y();
-        double r = 0.5 * samples.front().width();
-        for(int i=0; i<m; ++i)
-        {
-            double theta1 = 2 * (double) i * 3.14159 / (double) m ;
-            double theta2 = 2 * (double) (i+1) * 3.14159 / (double) m ;
-
-            double ax = cx + r*std::cos(theta1);
-            double ay = cy + r*std::sin(theta1);
-
-            double bx = cx + r*std::cos(theta2);
-            double by = cy + r*std::sin(theta2);
-
-            triangles.append(ax,ay,bx,by,cx,cy);
-        }
+        int a = 2*(i-1);
+        int b = 2*(i-1) + 1;
+        int c = 2*i;
+        int d = 2*i + 1;
+        triangles.addTriangle(a,b,d);
+        triangles.addTriangle(a,d,c);
     }
 
-    // End cap
+    // Caps
     if (!closed)
     {
-        int m = 50;
-        double cx = samples.back().x();
-        double cy = samples.back().y();
-        double r = 0.5 * samples.back().width();
-        for(int i=0; i<m; ++i)
+        for(const EdgeSample & sample: {samples.front(), samples.back()})
         {
-            double theta1 = 2 * (double) i * 3.14159 / (double) m ;
-            double theta2 = 2 * (double) (i+1) * 3.14159 / (double) m ;
-
-            double ax = cx + r*std::cos(theta1);
-            double ay = cy + r*std::sin(theta1);
-
-            double bx = cx + r*std::cos(theta2);
-            double by = cy + r*std::sin(theta2);
-
-            triangles.append(ax,ay,bx,by,cx,cy);
+            double cx = sample.x();
+            double cy = sample.y();
+            double r = 0.5 * sample.width();
+            int center = triangles.addVertex(cx, cy);
+            for(int i=0; i<m; ++i)
+            {
+                double theta = 2 * (double) i * 3.14159 / (double) m ;
+                triangles.addVertex(cx + r*std::cos(theta), cy + r*std::sin(theta));
+            }
+            for(int i=0; i<m; ++i)
+            {
+                triangles.addTriangle(center+1+i, center+1+(i+1)%m, center);
+            }
         }
     }
 }
@@ -697,6 +675,7 @@ LinearSpline::LinearSpline(QTextStream & in) //:
 
     // Vertices
     std::vector<EdgeSample,Eigen::aligned_allocator<EdgeSample> > vertices;
+    vertices.reserve(n);
     in >> field >> bracket;
     for(int i=0; i<n; i++)
     {
@@ -706,7 +685,7 @@ LinearSpline::LinearSpline(QTextStream & in) //:
         vertices << EdgeSample(list[0].toDouble(), list[1].toDouble(), list[2].toDouble());
     }
     in >> bracket;
-    curve_.setVertices(vertices);
+    curve_.setVertices(std::move(vertices));
     clearSampling();
 }
 
@@ -751,12 +730,13 @@ LinearSpline::LinearSpline(const QStringRef & str)
     // Get vertices from data
     std::vector<EdgeSample,Eigen::aligned_allocator<EdgeSample> > vertices;
     int n = (d.size()-1)/3;
+    vertices.reserve(n);
     for(int i=0; i<n; i++)
         vertices << EdgeSample(d[3*i+1], d[3*i+2], d[3*i+3]);
 
     // Set curve
     curve_.setDs(d[0]);
-    curve_.setVertices(vertices);
+    curve_.setVertices(std::move(vertices));
     clearSampling();
 }
 
@@ -19,6 +19,8 @@
 #include <QTextStream>
 #include <QtDebug>
 
+#include <unordered_map>
+
 #include "../SaveAndLoad.h"
 #include "../DevSettings.h"
 #include "../Global.h"
@@ -69,6 +71,12 @@ void FaceCell::drawRawTopology(Time time, ViewSettings & viewSettings)
         triangles(time).draw();
 }
 
+void FaceCell::drawRawTopologyBatched(Time time, ViewSettings & viewSettings, TriangleBatch & batch)
+{
+    if(viewSettings.drawTopologyFaces())
+        batch.append(triangles(time));
+}
+
 bool FaceCell::isPickableCustom(Time /*time*/) const
 {
     const bool areFacesPickable = true;
@@ -162,14 +170,15 @@ namespace
 // Active tesselator
 GLUtesselator * tobj = 0;
 
-// Offline tesselator: outputs the triangulation as offlineTessTriangles
+// Offline tesselator: outputs the triangulation as offlineTessTriangles.
+// Vertices are identified by their address, so that vertices shared by
+// several triangles are stored only once.
 GLUtesselator * tobjOffline = 0;
 Triangles offlineTessTriangles;
+std::unordered_map<const GLdouble *, int> offlineTessIndices;
 GLenum offlineTessWhich;
 int offlineTessIter;
-double offlineTessAX, offlineTessAY;
-double offlineTessBX, offlineTessBY;
-double offlineTessCX, offlineTessCY;
+int offlineTessA, offlineTessB, offlineTessC;
 
 #ifdef _WIN32
 #define CALLBACK __stdcall
@@ -219,6 +228,21 @@ void CALLBACK offlineTessError(GLenum errorCode)
     qDebug() << "Tessellation Error:" << estring;
 }
 
+int offlineTessIndex(const GLdouble * pointer)
+{
+    auto it = offlineTessIndices.find(pointer);
+    if(it != offlineTessIndices.end())
+    {
+        return it->second;
+    }
+    else
+    {
+        int i = offlineTessTriangles.addVertex(pointer[0], pointer[1]);
+        offlineTessIndices.emplace(pointer, i);
+        return i;
+    }
+}
+
 void CALLBACK offlineTessVertex(GLvoid *vertex)
 {
     const GLdouble *pointer = (GLdouble *) vertex;
@@ -227,92 +251,71 @@ void CALLBACK offlineTessVertex(GLvoid *vertex)
     {
         if(offlineTessIter == 0)
         {
-            offlineTessAX = pointer[0];
-            offlineTessAY = pointer[1];
+            offlineTessA = offlineTessIndex(pointer);
             offlineTessIter = 1;
         }
         else if(offlineTessIter == 1)
         {
-            offlineTessBX = pointer[0];
-            offlineTessBY = pointer[1];
+            offlineTessB = offlineTessIndex(pointer);
             offlineTessIter = 2;
         }
         else
         {
-            offlineTessCX = pointer[0];
-            offlineTessCY = pointer[1];
+            offlineTessC = offlineTessIndex(pointer);
             offlineTessIter = 0;
 
-            offlineTessTriangles.append(offlineTessAX, offlineTessAY,
-                                        offlineTessBX, offlineTessBY,
-                                        offlineTessCX, offlineTessCY);
+            offlineTessTriangles.addTriangle(offlineTessA, offlineTessB, offlineTessC);
         }
     }
     else if(offlineTessWhich == GL_TRIANGLE_FAN)
     {
         if(offlineTessIter == 0)
         {
-            offlineTessAX = pointer[0];
-            offlineTessAY = pointer[1];
+            offlineTessA = offlineTessIndex(pointer);
             offlineTessIter = 1;
         }
         else if(offlineTessIter == 1)
         {
-            offlineTessBX = pointer[0];
-            offlineTessBY = pointer[1];
+            offlineTessB = offlineTessIndex(pointer);
             offlineTessIter = 2;
         }
         else
         {
-            offlineTessCX = pointer[0];
-            offlineTessCY = pointer[1];
+            offlineTessC = offlineTessIndex(pointer);
 
-            offlineTessTriangles.append(offlineTessAX, offlineTessAY,
-                                        offlineTessBX, offlineTessBY,
-                                        offlineTessCX, offlineTessCY);
+            offlineTessTriangles.addTriangle(offlineTessA, offlineTessB, offlineTessC);
 
-            offlineTessBX = offlineTessCX;
-            offlineTessBY = offlineTessCY;
+            offlineTessB = offlineTessC;
         }
     }
     else if(offlineTessWhich == GL_TRIANGLE_STRIP)
     {
         if(offlineTessIter == 0)
         {
-            offlineTessAX = pointer[0];
-            offlineTessAY = pointer[1];
+            offlineTessA = offlineTessIndex(pointer);
             offlineTessIter = 1;
         }
         else if(offlineTessIter == 1)
         {
-            offlineTessBX = pointer[0];
-            offlineTessBY = pointer[1];
+            offlineTessB = offlineTessIndex(pointer);
             offlineTessIter = 2;
         }
         else if(offlineTessIter == 2)
         {
-            offlineTessCX = pointer[0];
-            offlineTessCY = pointer[1];
+            offlineTessC = offlineTessIndex(pointer);
 
-            offlineTessTriangles.append(offlineTessAX, offlineTessAY,
-                                        offlineTessBX, offlineTessBY,
-                                        offlineTessCX, offlineTessCY);
+            offlineTessTriangles.addTriangle(offlineTessA, offlineTessB, offlineTessC);
 
-            offlineTessAX = offlineTessCX;
-            offlineTessAY = offlineTessCY;
+            offlineTessA = offlineTessC;
             offlineTessIter = 3;
         }
         else
         {
-            offlineTessCX = pointer[0];
-            offlineTessCY = pointer[1];
+            offlineTessC = offlineTessIndex(pointer);
 
-            offlineTessTriangles.append(offlineTessAX, offlineTessAY,
-                                        offlineTessBX, offlineTessBY,
-                                        offlineTessCX, offlineTessCY);
+            offlineTessTriangles.addTriangle(offlineTessA, offlineTessB, offlineTessC);
 
-            offlineTessBX = offlineTessCX;
-            offlineTessBY = offlineTessCY;
+            offlineTessB = offlineTessC;
             offlineTessIter = 2;
         }
     }
@@ -360,6 +363,7 @@ void tesselatePolygon(const PolygonData & vertices, Triangles & triangles) {
 
     // Specifying data
     offlineTessTriangles.clear();
+    offlineTessIndices.clear();
     gluTessBeginPolygon(tobj, NULL);
     {
         for(const auto & vec: vertices) // for each cycle
@@ -393,8 +397,10 @@ void tesselatePolygon(const PolygonData & vertices, Triangles & triangles) {
     }
     gluTessEndPolygon(tobj);
 
-    // Tranfer to member data
+    // Tranfer to member data. Vertex addresses are only meaningful during
+    // this tesselation, so we forget them.
     triangles = offlineTessTriangles;
+    offlineTessIndices.clear();
 }
 
 } // namespace detail
@@ -32,6 +32,7 @@ public:
 
     // Drawing
     void drawRawTopology(Time time, ViewSettings & viewSettings);
+    void drawRawTopologyBatched(Time time, ViewSettings & viewSettings, TriangleBatch & batch);
 
     // Get sampling of the boundary
     virtual QList< QList<Eigen::Vector2d> > getSampling(Time time) const = 0;
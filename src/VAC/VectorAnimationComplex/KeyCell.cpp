@@ -82,7 +82,12 @@ void KeyCell::setTime(Time time)
 
     if(minTime < time_ && time_ < maxTime)
     {
+        KeyVertex * keyVertex = toKeyVertex();
+        if(vac() && keyVertex)
+            vac()->unindexKeyVertex_(keyVertex);
         time_ = time;
+        if(vac() && keyVertex)
+            vac()->indexKeyVertex_(keyVertex);
         processGeometryChanged_();
     }
 }
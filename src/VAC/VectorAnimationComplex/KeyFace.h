@@ -71,8 +71,6 @@ public:
     // Boundary
     CellSet spatialBoundary() const;
 
-    EIGEN_MAKE_ALIGNED_OPERATOR_NEW
-
 private:
     friend class VAC;
     virtual ~KeyFace();
@@ -115,10 +115,12 @@ KeyHalfedge KeyHalfedge::next()
 QList<KeyHalfedge> KeyHalfedge::endIncidentHalfEdges()
 {
     KeyVertex * v = endVertex();
-    KeyEdgeSet edges = v->star();
     QList<KeyHalfedge> halfedges;
-    foreach(KeyEdge * e, edges)
+    for(Cell * c: v->spatialStarCells())
     {
+        KeyEdge * e = c->toKeyEdge();
+        if(!e)
+            continue;
         if(e->startVertex() == v)
             halfedges << KeyHalfedge(e,true);
         if(e->endVertex() == v)
@@ -18,6 +18,7 @@
 #include "KeyEdge.h"
 #include "InbetweenVertex.h"
 #include "EdgeGeometry.h"
+#include "VAC.h"
 
 #include "../OpenGL.h"
 #include <QtDebug>
@@ -214,14 +215,12 @@ void KeyVertex::computePosFromEdges()
     // In  the  future,  if  non-keyframed instant  edges  are
     // allowed, then it would be necessary to ignore them too.
 
-    CellSet ss = spatialStar();
-
     // we don't directly modify  pos_, because in case of n==0
     // we prefer to keep the old pos_ than to replace it by 0
     Eigen::Vector2d res(0,0);
 
     int n = 0;
-    foreach(Cell * c, ss)
+    for(Cell * c: spatialStarCells())
     {
         KeyEdge * iedge = c->toKeyEdge();
         if(iedge)
@@ -246,9 +245,7 @@ void KeyVertex::computePosFromEdges()
 
 void KeyVertex::correctEdgesGeometry()
 {
-    CellSet ss = spatialStar();
-
-    foreach(Cell * c, ss)
+    for(Cell * c: spatialStarCells())
     {
         KeyEdge * iedge = c->toKeyEdge();
         if(iedge)
@@ -340,6 +337,8 @@ Eigen::Vector2d KeyVertex::dividedDifferencesTangent(bool slowInOut) const
 void KeyVertex::setPos(const Eigen::Vector2d & pos)
 {
     pos_ = pos;
+    if(vac())
+        vac()->indexKeyVertex_(this);
     processGeometryChanged_();
 }
 
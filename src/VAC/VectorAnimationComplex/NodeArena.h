@@ -0,0 +1,157 @@
+// Copyright (C) 2012-2023 The VPaint Developers.
+// See the COPYRIGHT file at the top-level directory of this distribution
+// and at https://github.com/dalboris/vpaint/blob/master/COPYRIGHT
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef VAC_NODE_ARENA_H
+#define VAC_NODE_ARENA_H
+
+#include <atomic>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <new>
+#include <vector>
+
+namespace SculptCurve
+{
+
+// Allocates nodes of the same size, typically the nodes of a std::list, by
+// chunks. Freed nodes are reused for subsequent allocations, and all the
+// memory is released at once when the arena is destroyed. The returned
+// memory is aligned for any Eigen type.
+//
+// Example:
+//   NodeArena arena;
+//   std::list<T, NodeArenaAllocator<T> > list((NodeArenaAllocator<T>(arena)));
+//
+// An arena must only be used by one thread at a time, but different arenas
+// can be used concurrently.
+//
+class NodeArena
+{
+public:
+    NodeArena() : nodeSize_(0), freeNodes_(0), current_(0), currentEnd_(0) {}
+    ~NodeArena()
+    {
+        for(char * chunk: chunks_)
+            ::operator delete(chunk);
+    }
+
+    // All nodes must have the same size
+    void * allocate(std::size_t size)
+    {
+        ++numNodeAllocations_;
+        if(nodeSize_ == 0)
+            nodeSize_ = roundUp_(size < sizeof(FreeNode) ? sizeof(FreeNode) : size);
+        assert(size <= nodeSize_);
+
+        if(freeNodes_)
+        {
+            void * res = freeNodes_;
+            freeNodes_ = freeNodes_->next;
+            return res;
+        }
+
+        if(static_cast<std::size_t>(currentEnd_ - current_) < nodeSize_)
+        {
+            ++numChunkAllocations_;
+            std::size_t chunkSize = nodeSize_ * nodesPerChunk;
+            char * chunk = static_cast<char *>(::operator new(chunkSize + alignment));
+            chunks_.push_back(chunk);
+            current_ = reinterpret_cast<char *>(roundUp_(reinterpret_cast<std::uintptr_t>(chunk)));
+            currentEnd_ = current_ + chunkSize;
+        }
+        void * res = current_;
+        current_ += nodeSize_;
+        return res;
+    }
+
+    void deallocate(void * p)
+    {
+        FreeNode * node = static_cast<FreeNode *>(p);
+        node->next = freeNodes_;
+        freeNodes_ = node;
+    }
+
+    // Total number of nodes and chunks allocated by all arenas. Comparing
+    // both shows how many allocations from the system were avoided.
+    static long long numNodeAllocations() { return numNodeAllocations_; }
+    static long long numChunkAllocations() { return numChunkAllocations_; }
+
+private:
+    NodeArena(const NodeArena &);
+    NodeArena & operator=(const NodeArena &);
+
+    static const std::size_t alignment = 32;
+    static const std::size_t nodesPerChunk = 256;
+
+    struct FreeNode
+    {
+        FreeNode * next;
+    };
+
+    std::size_t nodeSize_;
+    FreeNode * freeNodes_;
+    std::vector<char *> chunks_;
+    char * current_;
+    char * currentEnd_;
+
+    static std::atomic<long long> numNodeAllocations_;
+    static std::atomic<long long> numChunkAllocations_;
+
+    static std::size_t roundUp_(std::size_t size)
+    {
+        return (size + alignment - 1) / alignment * alignment;
+    }
+};
+
+// Standard allocator allocating from a NodeArena. Allocations of more than
+// one object at once, which std::list never does, fall back to the heap.
+template<class T>
+class NodeArenaAllocator
+{
+public:
+    typedef T value_type;
+
+    explicit NodeArenaAllocator(NodeArena & arena) : arena_(&arena) {}
+    template<class U> NodeArenaAllocator(const NodeArenaAllocator<U> & other) : arena_(other.arena_) {}
+
+    T * allocate(std::size_t n)
+    {
+        if(n == 1)
+            return static_cast<T *>(arena_->allocate(sizeof(T)));
+        else
+            return static_cast<T *>(::operator new(n * sizeof(T)));
+    }
+
+    void deallocate(T * p, std::size_t n)
+    {
+        if(n == 1)
+            arena_->deallocate(p);
+        else
+            ::operator delete(p);
+    }
+
+    template<class U> bool operator==(const NodeArenaAllocator<U> & other) const { return arena_ == other.arena_; }
+    template<class U> bool operator!=(const NodeArenaAllocator<U> & other) const { return arena_ != other.arena_; }
+
+private:
+    template<class U> friend class NodeArenaAllocator;
+    NodeArena * arena_;
+};
+
+}
+
+#endif // VAC_NODE_ARENA_H
@@ -73,6 +73,8 @@ void Operator::setRight(Edge * e, Vertex * right) { modify(e); modify(right); mo
 // Modify Entities
 void Operator::modify(Cell * c)
 {
+    if(c->vac_)
+        c->vac_->setModified_(c);
     if(!trusted_)
         /*root_->*/modifiedCells_ << c;
 }
@@ -0,0 +1,168 @@
+// Copyright (C) 2012-2023 The VPaint Developers.
+// See the COPYRIGHT file at the top-level directory of this distribution
+// and at https://github.com/dalboris/vpaint/blob/master/COPYRIGHT
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "PointIndex.h"
+
+#include <algorithm> // max, min
+#include <cmath>
+
+namespace VectorAnimationComplex
+{
+
+namespace
+{
+
+// Bucket coordinates are clamped to this range, so that far away or
+// non-finite points still end up in a valid (border) bucket
+const double maxBucketCoord = 1.0e9;
+
+}
+
+PointIndex::PointIndex(double bucketSize) :
+    bucketSize_(bucketSize > 0 ? bucketSize : 1.0)
+{
+}
+
+void PointIndex::clear()
+{
+    points_.clear();
+    buckets_.clear();
+}
+
+void PointIndex::insert(int id, double x, double y)
+{
+    remove(id);
+    Point p = {x, y};
+    points_[id] = p;
+    buckets_[bucketKey_(bucketCoord_(x), bucketCoord_(y))].push_back(id);
+}
+
+void PointIndex::remove(int id)
+{
+    auto it = points_.find(id);
+    if(it == points_.end())
+        return;
+
+    long long key = bucketKey_(bucketCoord_(it->second.x), bucketCoord_(it->second.y));
+    points_.erase(it);
+
+    auto bucket = buckets_.find(key);
+    if(bucket != buckets_.end())
+    {
+        std::vector<int> & ids = bucket->second;
+        for(size_t k=0; k<ids.size(); ++k)
+        {
+            if(ids[k] == id)
+            {
+                ids[k] = ids.back();
+                ids.pop_back();
+                break;
+            }
+        }
+        if(ids.empty())
+            buckets_.erase(bucket);
+    }
+}
+
+bool PointIndex::contains(int id) const
+{
+    return points_.find(id) != points_.end();
+}
+
+void PointIndex::query(double x, double y, double radius, std::vector<int> & out) const
+{
+    if(!(radius > 0))
+        return;
+
+    double r2 = radius * radius;
+    auto isInside = [x, y, r2](const Point & p)
+    {
+        double dx = p.x - x;
+        double dy = p.y - y;
+        return dx*dx + dy*dy < r2;
+    };
+
+    int i1 = bucketCoord_(x - radius);
+    int i2 = bucketCoord_(x + radius);
+    int j1 = bucketCoord_(y - radius);
+    int j2 = bucketCoord_(y + radius);
+    double numBuckets = (static_cast<double>(i2) - i1 + 1) * (static_cast<double>(j2) - j1 + 1);
+    if(numBuckets > static_cast<double>(points_.size()))
+    {
+        // Large radius: cheaper to test all points
+        for(const auto & point: points_)
+        {
+            if(isInside(point.second))
+                out.push_back(point.first);
+        }
+    }
+    else
+    {
+        for(int i=i1; i<=i2; ++i)
+        {
+            for(int j=j1; j<=j2; ++j)
+            {
+                auto bucket = buckets_.find(bucketKey_(i, j));
+                if(bucket == buckets_.end())
+                    continue;
+
+                for(int id: bucket->second)
+                {
+                    if(isInside(points_.at(id)))
+                        out.push_back(id);
+                }
+            }
+        }
+    }
+}
+
+int PointIndex::nearest(double x, double y, double radius) const
+{
+    std::vector<int> ids;
+    query(x, y, radius, ids);
+
+    int res = -1;
+    double minD2 = 0;
+    for(int id: ids)
+    {
+        const Point & p = points_.at(id);
+        double dx = p.x - x;
+        double dy = p.y - y;
+        double d2 = dx*dx + dy*dy;
+        if(res == -1 || d2 < minD2 || (d2 == minD2 && id < res))
+        {
+            res = id;
+            minD2 = d2;
+        }
+    }
+    return res;
+}
+
+int PointIndex::bucketCoord_(double x) const
+{
+    double i = std::floor(x / bucketSize_);
+    if(!(i > -maxBucketCoord)) // also catches NaN
+        i = -maxBucketCoord;
+    i = std::min(i, maxBucketCoord);
+    return static_cast<int>(i);
+}
+
+long long PointIndex::bucketKey_(int i, int j)
+{
+    return (static_cast<long long>(i) << 32) ^ static_cast<long long>(static_cast<unsigned int>(j));
+}
+
+}
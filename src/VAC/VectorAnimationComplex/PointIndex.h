@@ -0,0 +1,87 @@
+// Copyright (C) 2012-2023 The VPaint Developers.
+// See the COPYRIGHT file at the top-level directory of this distribution
+// and at https://github.com/dalboris/vpaint/blob/master/COPYRIGHT
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef POINT_INDEX_H
+#define POINT_INDEX_H
+
+#include <unordered_map>
+#include <vector>
+
+namespace VectorAnimationComplex
+{
+
+// A PointIndex stores points identified by an integer, typically cell IDs,
+// and quickly finds the points close to a given position, e.g., the vertices
+// to snap to.
+//
+// It is implemented as a hashed uniform grid of buckets, such that points can
+// be inserted, moved, and removed in constant time. Queries only visit the
+// buckets overlapping the search disk, or all points if there are fewer
+// points than buckets to visit.
+//
+// Usage:
+//
+//   PointIndex index;
+//   index.insert(vertex->id(), vertex->pos()[0], vertex->pos()[1]);
+//   ...
+//   int id = index.nearest(x, y, tolerance);
+//
+class PointIndex
+{
+public:
+    PointIndex(double bucketSize = 20.0);
+
+    // Removes all points
+    void clear();
+
+    // Adds a point, or moves it if a point with the same ID already exists
+    void insert(int id, double x, double y);
+
+    // Removes a point. Does nothing if there is no point with this ID.
+    void remove(int id);
+
+    // Returns whether there is a point with the given ID
+    bool contains(int id) const;
+
+    // Returns the number of points
+    int size() const { return static_cast<int>(points_.size()); }
+
+    // Appends to `out` the IDs of the points whose distance to (x,y) is
+    // strictly less than `radius`.
+    void query(double x, double y, double radius, std::vector<int> & out) const;
+
+    // Returns the ID of the closest point to (x,y) among those whose distance
+    // is strictly less than `radius`, or -1 if there is no such point. Ties
+    // are broken in favor of the smallest ID.
+    int nearest(double x, double y, double radius) const;
+
+private:
+    struct Point
+    {
+        double x, y;
+    };
+
+    double bucketSize_;
+    std::unordered_map<int, Point> points_;
+    std::unordered_map<long long, std::vector<int>> buckets_;
+
+    int bucketCoord_(double x) const;
+    static long long bucketKey_(int i, int j);
+};
+
+}
+
+#endif // POINT_INDEX_H
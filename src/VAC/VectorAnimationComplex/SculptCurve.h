@@ -64,6 +64,8 @@
 #include <Eigen/LU>
 #include <Eigen/StdVector>
 
+#include "NodeArena.h"
+
 #ifndef DEFINE_STD_VECTOR_INSERTION_OPERATOR
 #define DEFINE_STD_VECTOR_INSERTION_OPERATOR
 // Defines insertion operator (<<) for std::vector, for convenience
@@ -313,9 +315,12 @@ public:
                 lastDs_ = ds_;
         }
 
-        // We'll work on a linked list for fast insertion/deletion in the middle
-        typedef std::list<T,Eigen::aligned_allocator<T> > SampleList;
-        SampleList samples;
+        // We'll work on a linked list for fast insertion/deletion in the middle.
+        // Its nodes are allocated from an arena, released all at once on return.
+        typedef NodeArenaAllocator<T> SampleAllocator;
+        typedef std::list<T,SampleAllocator> SampleList;
+        NodeArena arena;
+        SampleList samples((SampleAllocator(arena)));
 
         // First pass: copy all non-NaN samples to the list
         double defaultWidth = 10;
@@ -528,7 +533,7 @@ public:
         // Step 3: Subdivision scheme
         if(subdivide) // Note: this implies n>=3
         {
-            SampleList subdividedSamples;
+            SampleList subdividedSamples((SampleAllocator(arena)));
             bool subdivideAgain = true;
             while(subdivideAgain)
             {
@@ -590,6 +595,7 @@ public:
 
         // Copy back the list to the vector
         vertices_.clear();
+        vertices_.reserve(samples.size());
         typename SampleList::iterator itBegin = samples.begin();
         typename SampleList::iterator itEnd = samples.end();
         for(typename SampleList::iterator it = itBegin; it != itEnd; ++it)
@@ -597,6 +603,101 @@ public:
         setDirtyArclengths_();
     }
 
+    // Same as resample(true), but only resamples the vertices i1 to i2, e.g.,
+    // after they have been sculpted. The rest of the curve is assumed to be
+    // already sampled, and is kept as is. The cost is proportional to the
+    // number of vertices in the window, except for copying the vertices and
+    // shifting the arclengths after it.
+    void resample(int i1, int i2)
+    {
+        // Fall back to resampling everything when the window reaches the
+        // start/end point of loops, or when the curve is small enough for
+        // the special cases of resample() to matter
+        int n = size();
+        int minI1 = isClosed_ ? 2 : 0;
+        int maxI2 = isClosed_ ? n-3 : n-1;
+        if(n < 8 || i1 > i2 || i1 < minI1 || i2 > maxI2)
+        {
+            resample(true);
+            return;
+        }
+
+        // The window is [a,b]. Vertices a and b are kept, and vertices
+        // prev and next are only used by the subdivision scheme.
+        int a = std::max(0, i1-1);
+        int b = std::min(n-1, i2+1);
+        int prev = std::max(0, a-1);
+        int next = std::min(n-1, b+1);
+        bool isLast = (b == n-1);
+
+        // Step 1: Remove samples closer than ds/2 to the previous one.
+        // Remove the sample before b if it is too close to b.
+        typedef std::vector<T,Eigen::aligned_allocator<T> > SampleVector;
+        SampleVector samples;
+        samples.reserve(b-a+1);
+        samples.push_back(vertices_[a]);
+        double halfDs = 0.5 * ds();
+        double quarterDs = 0.25 * ds();
+        for(int i=a+1; i<b; ++i)
+        {
+            if(samples.back().distanceTo(vertices_[i]) >= halfDs)
+                samples.push_back(vertices_[i]);
+        }
+        if(samples.size() > 1 && samples.back().distanceTo(vertices_[b]) < (isLast ? quarterDs : halfDs))
+            samples.pop_back();
+        samples.push_back(vertices_[b]);
+
+        // Step 3: Subdivision scheme, see resample()
+        SampleVector subdividedSamples;
+        bool subdivideAgain = true;
+        while(subdivideAgain)
+        {
+            subdivideAgain = false;
+            int m = static_cast<int>(samples.size());
+            subdividedSamples.clear();
+            subdividedSamples.reserve(2*m);
+            subdividedSamples.push_back(samples[0]);
+            for(int i=1; i<m; ++i)
+            {
+                const T & sample1 = samples[i-1];
+                const T & sample2 = samples[i];
+                if(sample1.distanceTo(sample2) > ds())
+                {
+                    const T & sample0 = (i > 1) ? samples[i-2] : vertices_[prev];
+                    const T & sample3 = (i < m-1) ? samples[i+1] : vertices_[next];
+                    double w = 0.0625; // i.e., 1/16
+                    double halfPlusW = 0.5625; // i.e., 1/2 + 1/16
+                    T newSample = (sample1+sample2)*halfPlusW - (sample0+sample3)*w;
+                    subdividedSamples.push_back(newSample);
+                    subdivideAgain = true;
+                }
+                subdividedSamples.push_back(sample2);
+            }
+            samples.swap(subdividedSamples);
+        }
+
+        // Patch the arclengths of the window and shift the ones after it
+        if(!dirtyArclengths_)
+        {
+            int m = static_cast<int>(samples.size());
+            double oldArclengthB = arclengths_[b];
+            std::vector<double> windowArclengths(m);
+            windowArclengths[0] = arclengths_[a];
+            for(int i=1; i<m; ++i)
+                windowArclengths[i] = windowArclengths[i-1] + samples[i-1].distanceTo(samples[i]);
+            double delta = windowArclengths[m-1] - oldArclengthB;
+
+            arclengths_.erase(arclengths_.begin()+a, arclengths_.begin()+b+1);
+            arclengths_.insert(arclengths_.begin()+a, windowArclengths.begin(), windowArclengths.end());
+            for(std::size_t i=a+m; i<arclengths_.size(); ++i)
+                arclengths_[i] += delta;
+        }
+
+        // Replace the window
+        vertices_.erase(vertices_.begin()+a, vertices_.begin()+b+1);
+        vertices_.insert(vertices_.begin()+a, samples.begin(), samples.end());
+    }
+
     // directly set the curve to be the provided vertices, for instance
     // coming from another neatening algorithm or curve representation
     // keep the loopness it has before calling the function
@@ -612,6 +713,16 @@ public:
         setDirtyArclengths_();
     }
 
+    // same as above, but takes the provided vertices instead of copying them
+    void setVertices(std::vector<T,Eigen::aligned_allocator<T> > && newVertices)
+    {
+        bool loopTmp = isClosed_;
+        clear();
+        isClosed_ = loopTmp;
+        vertices_.swap(newVertices);
+        setDirtyArclengths_();
+    }
+
     // -------- Continuous curve --------
 
     // Note: these functions ignore whatever is in qTemp
@@ -772,7 +883,7 @@ public:
                 r0 = halfLength;
                 w0 = w_(halfLength);
             }
-            for(int i=0; i<size(); ++i)
+            forEachVertexNear_(sculptIndex_, sculptRadius_, [&](int i)
             {
                 // compute signed distance, loop-unaware.
                 double d =  arclengths_[sculptIndex_] - arclengths_[i];
@@ -787,7 +898,7 @@ public:
 
                 // insert vertex into sculptTemp_
                 if(d > sculptRadius_)
-                    continue;
+                    return;
 
                 double w;
                 if(handleLargeRadius)
@@ -796,7 +907,7 @@ public:
                     w = w_(d);
 
                 sculptTemp_ << SculptTemp(i, w, vertices_[i].x(), vertices_[i].y());
-            }
+            });
         }
         else
         {
@@ -873,28 +984,44 @@ public:
 
     void continueSculptDeform(double x, double y)
     {
-        setDirtyArclengths_();
-
+        int i1 = size();
+        int i2 = -1;
         for(auto & v: sculptTemp_)
         {
             vertices_[v.i].setX(v.x  + v.w * (x - sculptStartX_));
             vertices_[v.i].setY(v.y  + v.w * (y - sculptStartY_));
+            i1 = std::min(i1, v.i);
+            i2 = std::max(i2, v.i);
         }
+        updateArclengths_(i1, i2);
     }
 
     void endSculptDeform()
     {
-        sculptTemp_.clear();
-        resample(true);
+        if(sculptTemp_.empty())
+        {
+            resample(true);
+        }
+        else
+        {
+            int i1 = size();
+            int i2 = -1;
+            for(auto & v: sculptTemp_)
+            {
+                i1 = std::min(i1, v.i);
+                i2 = std::max(i2, v.i);
+            }
+            sculptTemp_.clear();
+            resample(i1, i2);
+        }
     }
 
     // apply a smooth filter of radius sculptRadius_ and intensity intensity at sculptVertex_
     void sculptSmooth(double intensity)
     {
-        precomputeArclengths_();
-        std::vector<T,Eigen::aligned_allocator<T> > copyVertices = vertices_;
         if(!size())
             return;
+        precomputeArclengths_();
 
         // to handle loops
         double l = length();
@@ -913,10 +1040,16 @@ public:
         // this is only useful if isClosed == false
         double sSculpt = arclengthOfSculptVertex();
 
-        for(int i=0; i<size(); ++i)
+        // New positions of affected vertices. They are only written back
+        // once all are computed, since they depend on the original positions
+        // of their neighbours.
+        std::vector<int> smoothedIndices;
+        std::vector<T,Eigen::aligned_allocator<T> > smoothedVertices;
+
+        forEachVertexNear_(sculptIndex_, sculptRadius_, [&](int i)
         {
             if(!isClosed_ && (i==0 || i==size()-1))
-                continue;
+                return;
 
             // for every affected vertex i
             double d = arclengths_[sculptIndex_] - arclengths_[i];
@@ -942,7 +1075,7 @@ public:
                     localIntensity = intensity * w_(d);
                 T res;
                 double sum = 0;
-                for(int j=0; j<size(); ++j)
+                forEachVertexNear_(i, localRadius, [&](int j)
                 {
                     double d2 = arclengths_[i] - arclengths_[j];
                     if(isClosed_)
@@ -958,10 +1091,10 @@ public:
                     if(std::abs(d2)<localRadius)
                     {
                         double w = exp( - 5 * d2*d2 / (double) (localRadius*localRadius) ); //w_(d2,localRadius);
-                        res = res + copyVertices[j] * w;
+                        res = res + vertices_[j] * w;
                         sum += w;
                     }
-                }
+                });
                 if(sum>0)
                 {
                     res = res * (1/sum);
@@ -979,11 +1112,27 @@ public:
                             finalIntensity = localIntensity * alpha;
                         }
                     }
-                    vertices_[i] = copyVertices[i].lerp(finalIntensity, res);
+                    smoothedIndices.push_back(i);
+                    smoothedVertices.push_back(vertices_[i].lerp(finalIntensity, res));
                 }
             }
+        });
+
+        if(smoothedIndices.empty())
+        {
+            resample(true);
+            return;
         }
-        resample(true);
+        int i1 = size();
+        int i2 = -1;
+        for(std::size_t k=0; k<smoothedIndices.size(); ++k)
+        {
+            int i = smoothedIndices[k];
+            vertices_[i] = smoothedVertices[k];
+            i1 = std::min(i1, i);
+            i2 = std::max(i2, i);
+        }
+        resample(i1, i2);
     }
 
 
@@ -2139,6 +2288,82 @@ private:
     double ds_;
     double lastDs_;
     void setDirtyArclengths_()   const { dirtyArclengths_ = true; }
+
+    // Updates the arclengths after vertices i1 to i2 have moved, without
+    // recomputing the ones before. Does nothing if arclengths are dirty.
+    void updateArclengths_(int i1, int i2) const
+    {
+        int n = size();
+        if(dirtyArclengths_ || static_cast<int>(arclengths_.size()) != n)
+        {
+            setDirtyArclengths_();
+            return;
+        }
+
+        int k1 = std::max(i1, 1);
+        int k2 = std::min(i2+1, n-1);
+        if(k1 > k2)
+            return;
+
+        double oldArclength = arclengths_[k2];
+        for(int k=k1; k<=k2; ++k)
+            arclengths_[k] = arclengths_[k-1] + vertices_[k-1].distanceTo(vertices_[k]);
+        double delta = arclengths_[k2] - oldArclength;
+        for(int k=k2+1; k<n; ++k)
+            arclengths_[k] += delta;
+    }
+
+    // Calls f(i) for each vertex i whose distance to vertex c, measured
+    // along the curve, is at most r, walking from c in both directions.
+    // For loops, distances are loop-aware, and both copies of the start/end
+    // point are visited. Requires up-to-date arclengths.
+    template <class F>
+    void forEachVertexNear_(int c, double r, F f) const
+    {
+        int n = size();
+        double l = length();
+        if(isClosed_ && r >= 0.5 * l)
+        {
+            // Every vertex is within r of c
+            for(int i=0; i<n; ++i)
+                f(i);
+            return;
+        }
+
+        f(c);
+
+        // Forward
+        for(int k=1; k<n; ++k)
+        {
+            int i = c+k;
+            double d;
+            if(i < n)
+                d = arclengths_[i] - arclengths_[c];
+            else if(isClosed_)
+                d = (l - arclengths_[c]) + arclengths_[(i -= n)];
+            else
+                break;
+            if(d > r)
+                break;
+            f(i);
+        }
+
+        // Backward
+        for(int k=1; k<n; ++k)
+        {
+            int i = c-k;
+            double d;
+            if(i >= 0)
+                d = arclengths_[c] - arclengths_[i];
+            else if(isClosed_)
+                d = arclengths_[c] + (l - arclengths_[(i += n)]);
+            else
+                break;
+            if(d > r)
+                break;
+            f(i);
+        }
+    }
     void precomputeArclengths_() const
     {
         if(!dirtyArclengths_)
@@ -0,0 +1,210 @@
+// Copyright (C) 2012-2023 The VPaint Developers.
+// See the COPYRIGHT file at the top-level directory of this distribution
+// and at https://github.com/dalboris/vpaint/blob/master/COPYRIGHT
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef VAC_SMALL_CELL_SET_H
+#define VAC_SMALL_CELL_SET_H
+
+#include "CellList.h"
+
+#include <algorithm>
+#include <functional>
+
+namespace VectorAnimationComplex
+{
+
+// A non-owning view of a contiguous range of cells, for iterating over a
+// SmallCellSet without copying it. It is invalidated when the set changes.
+//
+// Example:
+//   for(Cell * c: vertex->spatialStarCells())
+//       ...
+//
+class CellRange
+{
+public:
+    typedef Cell * const * const_iterator;
+    typedef const_iterator iterator;
+
+    CellRange() : begin_(0), end_(0) {}
+    CellRange(const_iterator begin, const_iterator end) : begin_(begin), end_(end) {}
+
+    const_iterator begin() const { return begin_; }
+    const_iterator end() const { return end_; }
+    int size() const { return static_cast<int>(end_ - begin_); }
+    bool isEmpty() const { return begin_ == end_; }
+    bool contains(Cell * c) const { return std::find(begin_, end_, c) != end_; }
+
+private:
+    const_iterator begin_;
+    const_iterator end_;
+};
+
+// A set of cells stored in a vector, with room for N cells inline. This is
+// meant for stars: most cells have only a few cells in their star, for which
+// a QSet is slow to iterate and takes several allocations.
+//
+// While small, the cells are unsorted: insert() appends, and remove() moves
+// the last cell in place of the removed one. Above SortedThreshold cells, the
+// cells are kept sorted by address, so that contains(), insert() and remove()
+// use a binary search. Either way, the order of iteration is unspecified.
+//
+template<int N>
+class SmallCellSet
+{
+public:
+    typedef Cell * const * const_iterator;
+    typedef const_iterator iterator;
+
+    SmallCellSet() : data_(inline_), size_(0), capacity_(N), sorted_(false) {}
+    SmallCellSet(const SmallCellSet & other) : SmallCellSet() { *this = other; }
+    ~SmallCellSet() { if(data_ != inline_) delete[] data_; }
+
+    SmallCellSet & operator=(const SmallCellSet & other)
+    {
+        if(this != &other)
+        {
+            reserve_(other.size_);
+            std::copy(other.begin(), other.end(), data_);
+            size_ = other.size_;
+            sorted_ = other.sorted_;
+        }
+        return *this;
+    }
+
+    int size() const { return size_; }
+    bool isEmpty() const { return size_ == 0; }
+    const_iterator begin() const { return data_; }
+    const_iterator end() const { return data_ + size_; }
+    CellRange range() const { return CellRange(begin(), end()); }
+
+    bool contains(Cell * c) const
+    {
+        return find_(c) != data_ + size_;
+    }
+
+    // Returns false if the cell was already in the set
+    bool insert(Cell * c)
+    {
+        Cell ** end = data_ + size_;
+        if(sorted_)
+        {
+            Cell ** it = std::lower_bound(data_, end, c, std::less<Cell *>());
+            if(it != end && *it == c)
+                return false;
+            int i = static_cast<int>(it - data_);
+            reserve_(size_ + 1);
+            std::copy_backward(data_ + i, data_ + size_, data_ + size_ + 1);
+            data_[i] = c;
+            ++size_;
+        }
+        else
+        {
+            if(std::find(data_, end, c) != end)
+                return false;
+            reserve_(size_ + 1);
+            data_[size_++] = c;
+            if(size_ > SortedThreshold)
+            {
+                std::sort(data_, data_ + size_, std::less<Cell *>());
+                sorted_ = true;
+            }
+        }
+        return true;
+    }
+
+    SmallCellSet & operator<<(Cell * c)
+    {
+        insert(c);
+        return *this;
+    }
+
+    // Returns false if the cell was not in the set
+    bool remove(Cell * c)
+    {
+        Cell ** it = find_(c);
+        if(it == data_ + size_)
+            return false;
+        if(sorted_)
+        {
+            std::copy(it + 1, data_ + size_, it);
+            --size_;
+            sorted_ = size_ > SortedThreshold;
+        }
+        else
+        {
+            *it = data_[size_ - 1];
+            --size_;
+        }
+        return true;
+    }
+
+    // Note: keeps the allocated memory, if any
+    void clear()
+    {
+        size_ = 0;
+        sorted_ = false;
+    }
+
+    CellSet toCellSet() const
+    {
+        CellSet res;
+        res.reserve(size_);
+        for(Cell * c: *this)
+            res << c;
+        return res;
+    }
+
+private:
+    static const int SortedThreshold = 16;
+
+    Cell ** data_; // either inline_, or allocated if size_ > N
+    int size_;
+    int capacity_;
+    bool sorted_;
+    Cell * inline_[N];
+
+    Cell ** find_(Cell * c) const
+    {
+        Cell ** end = data_ + size_;
+        if(sorted_)
+        {
+            Cell ** it = std::lower_bound(data_, end, c, std::less<Cell *>());
+            return (it != end && *it == c) ? it : end;
+        }
+        else
+        {
+            return std::find(data_, end, c);
+        }
+    }
+
+    void reserve_(int n)
+    {
+        if(n > capacity_)
+        {
+            int capacity = std::max(n, 2 * capacity_);
+            Cell ** data = new Cell*[capacity];
+            std::copy(data_, data_ + size_, data);
+            if(data_ != inline_)
+                delete[] data_;
+            data_ = data;
+            capacity_ = capacity;
+        }
+    }
+};
+
+}
+
+#endif // VAC_SMALL_CELL_SET_H
@@ -0,0 +1,208 @@
+// Copyright (C) 2012-2023 The VPaint Developers.
+// See the COPYRIGHT file at the top-level directory of this distribution
+// and at https://github.com/dalboris/vpaint/blob/master/COPYRIGHT
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "SpatialIndex.h"
+
+#include <algorithm> // min, max, fill
+#include <cmath>
+
+namespace VectorAnimationComplex
+{
+
+namespace
+{
+
+// Maximum number of buckets along each dimension
+const int maxNumBuckets = 1024;
+
+// Items covering more buckets than this are not stored in the grid
+const int maxBucketsPerItem = 64;
+
+}
+
+SpatialIndex::SpatialIndex() :
+    xMin_(0),
+    yMin_(0),
+    bucketWidth_(1),
+    bucketHeight_(1),
+    numBucketsX_(0),
+    numBucketsY_(0),
+    stamp_(0)
+{
+}
+
+void SpatialIndex::clear()
+{
+    ids_.clear();
+    boxes_.clear();
+    numBucketsX_ = 0;
+    numBucketsY_ = 0;
+    bucketOffsets_.clear();
+    bucketItems_.clear();
+    largeItems_.clear();
+    stamps_.clear();
+    stamp_ = 0;
+}
+
+void SpatialIndex::insert(int id, const BoundingBox & bb)
+{
+    if(!bb.isEmpty())
+    {
+        ids_.push_back(id);
+        boxes_.push_back(bb);
+    }
+}
+
+void SpatialIndex::bucketRange_(const BoundingBox & bb, int & i1, int & i2, int & j1, int & j2) const
+{
+    auto clampedIndex = [](double u, int n) {
+        // Note: comparing as double first handles infinite values
+        if(u <= 0) return 0;
+        else if(u >= n-1) return n-1;
+        else return static_cast<int>(u);
+    };
+    i1 = clampedIndex((bb.xMin() - xMin_) / bucketWidth_,  numBucketsX_);
+    i2 = clampedIndex((bb.xMax() - xMin_) / bucketWidth_,  numBucketsX_);
+    j1 = clampedIndex((bb.yMin() - yMin_) / bucketHeight_, numBucketsY_);
+    j2 = clampedIndex((bb.yMax() - yMin_) / bucketHeight_, numBucketsY_);
+}
+
+void SpatialIndex::build()
+{
+    const int n = size();
+    bucketOffsets_.clear();
+    bucketItems_.clear();
+    largeItems_.clear();
+    stamps_.assign(n, 0);
+    stamp_ = 0;
+
+    // Compute extent of finite items. Infinite items are always tested.
+    BoundingBox extent;
+    std::vector<bool> isFinite(n);
+    for(int k=0; k<n; ++k)
+    {
+        isFinite[k] = !boxes_[k].isInfinite();
+        if(isFinite[k])
+            extent.unite(boxes_[k]);
+    }
+
+    // Compute grid dimensions, aiming at about one bucket per item
+    if(extent.isEmpty())
+    {
+        xMin_ = yMin_ = 0;
+        bucketWidth_ = bucketHeight_ = 1;
+        numBucketsX_ = numBucketsY_ = 1;
+    }
+    else
+    {
+        const double w = std::max(extent.width(),  1e-6);
+        const double h = std::max(extent.height(), 1e-6);
+        const double bucketSize = std::sqrt(w * h / std::max(1, n));
+        numBucketsX_ = std::min(maxNumBuckets, std::max(1, static_cast<int>(std::ceil(w / bucketSize))));
+        numBucketsY_ = std::min(maxNumBuckets, std::max(1, static_cast<int>(std::ceil(h / bucketSize))));
+        xMin_ = extent.xMin();
+        yMin_ = extent.yMin();
+        bucketWidth_  = w / numBucketsX_;
+        bucketHeight_ = h / numBucketsY_;
+    }
+
+    // Count items per bucket, then fill buckets
+    const int numBuckets = numBucketsX_ * numBucketsY_;
+    bucketOffsets_.assign(numBuckets + 1, 0);
+    std::vector<bool> isLarge(n);
+    for(int k=0; k<n; ++k)
+    {
+        int i1, i2, j1, j2;
+        bucketRange_(boxes_[k], i1, i2, j1, j2);
+        isLarge[k] = !isFinite[k] || (i2-i1+1) * (j2-j1+1) > maxBucketsPerItem;
+        if(isLarge[k])
+        {
+            largeItems_.push_back(k);
+            continue;
+        }
+        for(int j=j1; j<=j2; ++j)
+            for(int i=i1; i<=i2; ++i)
+                ++bucketOffsets_[j*numBucketsX_ + i + 1];
+    }
+    for(int b=0; b<numBuckets; ++b)
+        bucketOffsets_[b+1] += bucketOffsets_[b];
+    bucketItems_.resize(bucketOffsets_[numBuckets]);
+    std::vector<int> fill(bucketOffsets_.begin(), bucketOffsets_.end() - 1);
+    for(int k=0; k<n; ++k)
+    {
+        if(isLarge[k])
+            continue;
+        int i1, i2, j1, j2;
+        bucketRange_(boxes_[k], i1, i2, j1, j2);
+        for(int j=j1; j<=j2; ++j)
+            for(int i=i1; i<=i2; ++i)
+                bucketItems_[fill[j*numBucketsX_ + i]++] = k;
+    }
+}
+
+void SpatialIndex::nextStamp_() const
+{
+    ++stamp_;
+    if(stamp_ == 0)
+    {
+        // Wrapped around: reset all stamps
+        std::fill(stamps_.begin(), stamps_.end(), 0);
+        stamp_ = 1;
+    }
+}
+
+void SpatialIndex::query_(const BoundingBox & bb, std::vector<int> & out) const
+{
+    if(bb.isEmpty() || bucketOffsets_.empty())
+        return;
+
+    auto test = [&](int k) {
+        if(stamps_[k] != stamp_ && boxes_[k].intersects(bb))
+        {
+            stamps_[k] = stamp_;
+            out.push_back(ids_[k]);
+        }
+    };
+
+    int i1, i2, j1, j2;
+    bucketRange_(bb, i1, i2, j1, j2);
+    for(int j=j1; j<=j2; ++j)
+    {
+        for(int i=i1; i<=i2; ++i)
+        {
+            const int b = j*numBucketsX_ + i;
+            for(int p=bucketOffsets_[b]; p<bucketOffsets_[b+1]; ++p)
+                test(bucketItems_[p]);
+        }
+    }
+    for(int k: largeItems_)
+        test(k);
+}
+
+void SpatialIndex::query(const BoundingBox & bb, std::vector<int> & out) const
+{
+    nextStamp_();
+    query_(bb, out);
+}
+
+void SpatialIndex::query(const std::vector<BoundingBox> & boxes, std::vector<int> & out) const
+{
+    nextStamp_();
+    for(const BoundingBox & bb: boxes)
+        query_(bb, out);
+}
+
+}
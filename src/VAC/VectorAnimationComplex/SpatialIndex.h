@@ -0,0 +1,94 @@
+// Copyright (C) 2012-2023 The VPaint Developers.
+// See the COPYRIGHT file at the top-level directory of this distribution
+// and at https://github.com/dalboris/vpaint/blob/master/COPYRIGHT
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef SPATIAL_INDEX_H
+#define SPATIAL_INDEX_H
+
+#include "BoundingBox.h"
+#include <vector>
+
+namespace VectorAnimationComplex
+{
+
+// A SpatialIndex stores items identified by an integer, typically cell IDs,
+// each with a bounding box, and quickly finds the items whose bounding box
+// intersects a given rectangle.
+//
+// It is implemented as a uniform grid of buckets, sized such that there is
+// about one bucket per item. Items covering too many buckets are stored
+// separately and tested at each query. The index doesn't support updates:
+// it is meant to be built once for a given time and set of cells, then
+// queried many times, e.g., while the user drags the mouse.
+//
+// Usage:
+//
+//   SpatialIndex index;
+//   index.insert(cell->id(), cell->boundingBox(time));
+//   ...
+//   index.build();
+//   std::vector<int> ids;
+//   index.query(rect, ids);
+//
+class SpatialIndex
+{
+public:
+    SpatialIndex();
+
+    // Removes all items
+    void clear();
+
+    // Adds an item. Items with an empty bounding box are ignored. Call
+    // build() after adding items and before querying them.
+    void insert(int id, const BoundingBox & bb);
+
+    // Builds the grid of buckets from the inserted items
+    void build();
+
+    // Returns the number of items
+    int size() const { return static_cast<int>(ids_.size()); }
+
+    // Appends to `out` the IDs of the items whose bounding box intersects
+    // `bb`, or at least one of the given `boxes`. Each ID is appended
+    // only once.
+    void query(const BoundingBox & bb, std::vector<int> & out) const;
+    void query(const std::vector<BoundingBox> & boxes, std::vector<int> & out) const;
+
+private:
+    // Items
+    std::vector<int> ids_;
+    std::vector<BoundingBox> boxes_;
+
+    // Grid of buckets, stored in compressed form: the items of bucket k
+    // are bucketItems_[bucketOffsets_[k]] to bucketItems_[bucketOffsets_[k+1]-1]
+    double xMin_, yMin_;
+    double bucketWidth_, bucketHeight_;
+    int numBucketsX_, numBucketsY_;
+    std::vector<int> bucketOffsets_;
+    std::vector<int> bucketItems_;
+    std::vector<int> largeItems_;
+
+    // Query stamps, used to report each item only once per query
+    mutable std::vector<unsigned int> stamps_;
+    mutable unsigned int stamp_;
+
+    void bucketRange_(const BoundingBox & bb, int & i1, int & i2, int & j1, int & j2) const;
+    void query_(const BoundingBox & bb, std::vector<int> & out) const;
+    void nextStamp_() const;
+};
+
+}
+
+#endif // SPATIAL_INDEX_H
@@ -0,0 +1,318 @@
+// Copyright (C) 2012-2023 The VPaint Developers.
+// See the COPYRIGHT file at the top-level directory of this distribution
+// and at https://github.com/dalboris/vpaint/blob/master/COPYRIGHT
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "TriangleBatch.h"
+#include "Triangles.h"
+
+#include "../GLUtils.h"
+#include "../OpenGL.h"
+
+#include <QOpenGLContext>
+
+#include <algorithm> // min, max
+
+namespace VectorAnimationComplex
+{
+
+namespace
+{
+
+std::uint32_t toByte(double x)
+{
+    return static_cast<std::uint32_t>(std::min(1.0, std::max(0.0, x)) * 255.0 + 0.5);
+}
+
+// Packs the color such that its bytes in memory are R, G, B, A, regardless
+// of endianness, as expected by glColorPointer(4, GL_UNSIGNED_BYTE, ...).
+std::uint32_t packColor(double r, double g, double b, double a)
+{
+    std::uint32_t res;
+    unsigned char * bytes = reinterpret_cast<unsigned char *>(&res);
+    bytes[0] = static_cast<unsigned char>(toByte(r));
+    bytes[1] = static_cast<unsigned char>(toByte(g));
+    bytes[2] = static_cast<unsigned char>(toByte(b));
+    bytes[3] = static_cast<unsigned char>(toByte(a));
+    return res;
+}
+
+}
+
+TriangleBatch::TriangleBatch() :
+    vertices_(),
+    colors_(),
+    indices_(),
+    color_(packColor(0, 0, 0, 1)),
+    items_(),
+    numAppended_(0),
+    isModified_(false),
+    modifiedVerticesBegin_(0),
+    modifiedIndicesBegin_(0),
+    vertexBuffer_(QOpenGLBuffer::VertexBuffer),
+    colorBuffer_(QOpenGLBuffer::VertexBuffer),
+    indexBuffer_(QOpenGLBuffer::IndexBuffer),
+    shareGroup_(0),
+    isBufferOutdated_(true)
+{
+}
+
+bool TriangleBatch::Item::operator==(const Item & other) const
+{
+    return version == other.version &&
+           x == other.x && y == other.y && radius == other.radius &&
+           color == other.color;
+}
+
+int TriangleBatch::numVertices() const
+{
+    if(!isModified_ && numAppended_ < items_.size())
+        return static_cast<int>(items_[numAppended_].verticesBegin);
+    else
+        return static_cast<int>(colors_.size());
+}
+
+int TriangleBatch::numTriangles() const
+{
+    if(!isModified_ && numAppended_ < items_.size())
+        return static_cast<int>(items_[numAppended_].indicesBegin / 3);
+    else
+        return static_cast<int>(indices_.size() / 3);
+}
+
+void TriangleBatch::setColor(double r, double g, double b, double a)
+{
+    color_ = packColor(r, g, b, a);
+}
+
+void TriangleBatch::setColor(const double * rgba)
+{
+    color_ = packColor(rgba[0], rgba[1], rgba[2], rgba[3]);
+}
+
+bool TriangleBatch::beginItem_(Item & item)
+{
+    if(!isModified_)
+    {
+        if(numAppended_ < items_.size())
+        {
+            // Same as last flush: nothing to copy
+            const Item & previous = items_[numAppended_];
+            if(previous == item)
+            {
+                ++numAppended_;
+                return false;
+            }
+
+            // Different: discard this item and all following ones
+            vertices_.resize(2 * previous.verticesBegin);
+            colors_.resize(previous.verticesBegin);
+            indices_.resize(previous.indicesBegin);
+            items_.resize(numAppended_);
+        }
+        isModified_ = true;
+        modifiedVerticesBegin_ = colors_.size();
+        modifiedIndicesBegin_ = indices_.size();
+    }
+
+    item.verticesBegin = colors_.size();
+    item.indicesBegin = indices_.size();
+    items_.push_back(item);
+    ++numAppended_;
+    return true;
+}
+
+void TriangleBatch::appendColor_(size_t numVertices)
+{
+    colors_.insert(colors_.end(), numVertices, color_);
+}
+
+void TriangleBatch::append(const Triangles & triangles)
+{
+    Item item = {triangles.version(), 0, 0, 0, color_, 0, 0};
+    if(!beginItem_(item))
+        return;
+
+    const std::uint32_t offset = static_cast<std::uint32_t>(item.verticesBegin);
+    const std::vector<float> & vertices = triangles.vertices();
+    const std::vector<std::uint32_t> & indices = triangles.indices();
+    vertices_.insert(vertices_.end(), vertices.begin(), vertices.end());
+    appendColor_(vertices.size() / 2);
+    if(offset == 0)
+    {
+        indices_.insert(indices_.end(), indices.begin(), indices.end());
+    }
+    else
+    {
+        indices_.reserve(indices_.size() + indices.size());
+        for(std::uint32_t i: indices)
+            indices_.push_back(offset + i);
+    }
+}
+
+void TriangleBatch::appendDisk(const Eigen::Vector2d & center, double radius)
+{
+    Item item = {0, center[0], center[1], radius, color_, 0, 0};
+    if(!beginItem_(item))
+        return;
+
+    // Center vertex followed by n vertices on the circle
+    const std::vector<Eigen::Vector2d> & circle = GLUtils::unitCircle();
+    const std::uint32_t n = static_cast<std::uint32_t>(circle.size());
+    const std::uint32_t c = static_cast<std::uint32_t>(item.verticesBegin);
+    vertices_.push_back(static_cast<float>(center[0]));
+    vertices_.push_back(static_cast<float>(center[1]));
+    for(const Eigen::Vector2d & u: circle)
+    {
+        vertices_.push_back(static_cast<float>(center[0] + radius * u[0]));
+        vertices_.push_back(static_cast<float>(center[1] + radius * u[1]));
+    }
+    appendColor_(n + 1);
+    for(std::uint32_t i=0; i<n; ++i)
+    {
+        indices_.push_back(c);
+        indices_.push_back(c + 1 + i);
+        indices_.push_back(c + 1 + (i+1) % n);
+    }
+}
+
+void TriangleBatch::flush()
+{
+    // Discard items of the last flush that were not appended again
+    if(!isModified_ && numAppended_ < items_.size())
+    {
+        const Item & first = items_[numAppended_];
+        vertices_.resize(2 * first.verticesBegin);
+        colors_.resize(first.verticesBegin);
+        indices_.resize(first.indicesBegin);
+        items_.resize(numAppended_);
+    }
+
+    if(!indices_.empty())
+    {
+        if(upload_())
+            drawBuffers_();
+        else
+            drawClientArrays_();
+
+        // Note: with GL_COLOR_ARRAY, the current color is left undefined
+        // afterwards, so we reset it to the last color, as if it had been set
+        // with glColor by the immediate-mode code this replaces.
+        const unsigned char * bytes = reinterpret_cast<const unsigned char *>(&color_);
+        glColor4ub(bytes[0], bytes[1], bytes[2], bytes[3]);
+    }
+
+    numAppended_ = 0;
+    isModified_ = false;
+}
+
+void TriangleBatch::clear()
+{
+    // Note: clear() keeps the capacity, so no reallocation happens when the
+    // batch is reused
+    vertices_.clear();
+    colors_.clear();
+    indices_.clear();
+    items_.clear();
+    numAppended_ = 0;
+    isModified_ = false;
+}
+
+bool TriangleBatch::upload_()
+{
+    QOpenGLContext * context = QOpenGLContext::currentContext();
+    if(!context)
+        return false;
+
+    if(!vertexBuffer_.buffer.isCreated())
+    {
+        // First flush, or the context of the VBOs has been destroyed
+        for(Buffer * b: {&vertexBuffer_, &colorBuffer_, &indexBuffer_})
+        {
+            b->buffer.create();
+            b->buffer.setUsagePattern(QOpenGLBuffer::DynamicDraw);
+            b->capacity = 0;
+        }
+        shareGroup_ = context->shareGroup();
+        isBufferOutdated_ = true;
+    }
+    else if(context->shareGroup() != shareGroup_)
+    {
+        // The VBOs can't be used in this context, and won't be updated
+        isBufferOutdated_ = true;
+        return false;
+    }
+
+    std::size_t verticesBegin = isBufferOutdated_ ? 0 : modifiedVerticesBegin_;
+    std::size_t indicesBegin = isBufferOutdated_ ? 0 : modifiedIndicesBegin_;
+    if(isModified_ || isBufferOutdated_)
+    {
+        upload_(vertexBuffer_, vertices_.data(), vertices_.size() * sizeof(float), 2 * verticesBegin * sizeof(float));
+        upload_(colorBuffer_, colors_.data(), colors_.size() * sizeof(std::uint32_t), verticesBegin * sizeof(std::uint32_t));
+        upload_(indexBuffer_, indices_.data(), indices_.size() * sizeof(std::uint32_t), indicesBegin * sizeof(std::uint32_t));
+    }
+    isBufferOutdated_ = false;
+    return true;
+}
+
+void TriangleBatch::upload_(Buffer & b, const void * data, std::size_t size, std::size_t modifiedBegin)
+{
+    const char * bytes = static_cast<const char *>(data);
+    int n = static_cast<int>(size);
+    int begin = static_cast<int>(modifiedBegin);
+
+    b.buffer.bind();
+    if(n > b.capacity)
+    {
+        // Reallocate with some margin, since the batch usually grows by
+        // small steps while drawing
+        b.capacity = n + n / 2;
+        b.buffer.allocate(b.capacity);
+        b.buffer.write(0, bytes, n);
+    }
+    else if(begin < n)
+    {
+        b.buffer.write(begin, bytes + begin, n - begin);
+    }
+    b.buffer.release();
+}
+
+void TriangleBatch::drawBuffers_()
+{
+    glEnableClientState(GL_VERTEX_ARRAY);
+    glEnableClientState(GL_COLOR_ARRAY);
+    vertexBuffer_.buffer.bind();
+    glVertexPointer(2, GL_FLOAT, 0, 0);
+    colorBuffer_.buffer.bind();
+    glColorPointer(4, GL_UNSIGNED_BYTE, 0, 0);
+    indexBuffer_.buffer.bind();
+    glDrawElements(GL_TRIANGLES, static_cast<GLsizei>(indices_.size()), GL_UNSIGNED_INT, 0);
+    QOpenGLBuffer::release(QOpenGLBuffer::IndexBuffer);
+    QOpenGLBuffer::release(QOpenGLBuffer::VertexBuffer);
+    glDisableClientState(GL_COLOR_ARRAY);
+    glDisableClientState(GL_VERTEX_ARRAY);
+}
+
+void TriangleBatch::drawClientArrays_()
+{
+    glEnableClientState(GL_VERTEX_ARRAY);
+    glEnableClientState(GL_COLOR_ARRAY);
+    glVertexPointer(2, GL_FLOAT, 0, vertices_.data());
+    glColorPointer(4, GL_UNSIGNED_BYTE, 0, colors_.data());
+    glDrawElements(GL_TRIANGLES, static_cast<GLsizei>(indices_.size()), GL_UNSIGNED_INT, indices_.data());
+    glDisableClientState(GL_COLOR_ARRAY);
+    glDisableClientState(GL_VERTEX_ARRAY);
+}
+
+}
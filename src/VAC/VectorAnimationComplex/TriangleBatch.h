@@ -0,0 +1,145 @@
+// Copyright (C) 2012-2023 The VPaint Developers.
+// See the COPYRIGHT file at the top-level directory of this distribution
+// and at https://github.com/dalboris/vpaint/blob/master/COPYRIGHT
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef TRIANGLE_BATCH_H
+#define TRIANGLE_BATCH_H
+
+#include "Eigen.h"
+#include <QOpenGLBuffer>
+#include <cstdint>
+#include <vector>
+
+class QOpenGLContextGroup;
+
+namespace VectorAnimationComplex
+{
+
+class Triangles;
+
+// A TriangleBatch accumulates colored triangles, typically the triangles of
+// all the cells of a VAC, so that they can be drawn with a single call
+// instead of one call per cell, or even one call per vertex.
+//
+// Usage:
+//
+//   batch.setColor(r, g, b, a);
+//   batch.append(triangles);
+//   ...
+//   batch.flush(); // draw and clear
+//
+// Triangles are drawn in the order they were appended, so the result is the
+// same as drawing them one after the other. Anything drawn by other means in
+// between must be preceded by a call to flush().
+//
+// Like Triangles, the batch is an indexed mesh: vertices and indices are
+// copied as is from each Triangles object, with indices offset by the
+// number of vertices already in the batch.
+//
+// The batch is stored in vertex buffer objects (VBOs), and is meant to be
+// reused from frame to frame for the same drawing pass. The batch remembers
+// what it drew last time: appended triangles whose content (see
+// Triangles::version()) and color didn't change since the last flush are
+// neither copied nor uploaded again, and only the part of the buffers
+// following the first change is uploaded. Therefore, redrawing a scene where
+// nothing changed doesn't transfer any vertex to the GPU, and editing a
+// cell only uploads the cells drawn after it.
+//
+// The VBOs belong to the OpenGL context current at the first flush. If the
+// batch is later flushed in a context that doesn't share its objects, it
+// falls back to client-side vertex arrays.
+//
+class TriangleBatch
+{
+public:
+    TriangleBatch();
+
+    // Sets the color of subsequently appended triangles
+    void setColor(double r, double g, double b, double a = 1.0);
+    void setColor(const double * rgba);
+
+    // Appends triangles
+    void append(const Triangles & triangles);
+    void appendDisk(const Eigen::Vector2d & center, double radius);
+
+    // Returns the number of vertices and triangles appended since the last
+    // flush
+    int numVertices() const;
+    int numTriangles() const;
+    bool isEmpty() const { return numAppended_ == 0; }
+
+    // Draws all appended triangles, then starts a new batch
+    void flush();
+
+    // Discards the appended triangles and all content kept from previous
+    // flushes, without drawing
+    void clear();
+
+private:
+    // Copy of the content of the VBOs
+    std::vector<float> vertices_;       // (x, y) per vertex
+    std::vector<std::uint32_t> colors_; // RGBA8 per vertex
+    std::vector<std::uint32_t> indices_;
+    std::uint32_t color_;
+
+    // Appended items, each being either a Triangles object or a disk, in the
+    // order they were appended, with where they start in the buffers
+    struct Item
+    {
+        std::uint64_t version; // Triangles::version(), or 0 for disks
+        double x, y, radius;   // For disks only
+        std::uint32_t color;
+        std::size_t verticesBegin;
+        std::size_t indicesBegin;
+
+        bool operator==(const Item & other) const;
+    };
+    std::vector<Item> items_;
+
+    // Number of items appended since the last flush. As long as they are
+    // the same as the first items of the last flush, the buffers are
+    // unchanged. At the first different one, the buffers are truncated
+    // and the following items are copied.
+    std::size_t numAppended_;
+    bool isModified_;
+    std::size_t modifiedVerticesBegin_;
+    std::size_t modifiedIndicesBegin_;
+
+    // Returns whether the given item, about to be appended, needs to be
+    // copied to the buffers
+    bool beginItem_(Item & item);
+    void appendColor_(size_t numVertices);
+
+    // VBOs, and the share group of the context they belong to
+    struct Buffer
+    {
+        Buffer(QOpenGLBuffer::Type type) : buffer(type), capacity(0) {}
+        QOpenGLBuffer buffer;
+        int capacity; // in bytes
+    };
+    Buffer vertexBuffer_;
+    Buffer colorBuffer_;
+    Buffer indexBuffer_;
+    QOpenGLContextGroup * shareGroup_;
+    bool isBufferOutdated_; // whether the VBOs must be entirely uploaded
+    bool upload_();
+    void upload_(Buffer & buffer, const void * data, std::size_t size, std::size_t modifiedBegin);
+    void drawBuffers_();
+    void drawClientArrays_();
+};
+
+}
+
+#endif // TRIANGLE_BATCH_H
@@ -18,16 +18,49 @@
 
 #include "../OpenGL.h"
 #include "../View3DSettings.h"
+#include <algorithm>
+#include <atomic>
 #include <limits>
+#include <numeric>
 
 namespace VectorAnimationComplex
 {
 
 Triangles::Triangles() :
-    triangles_()
+    vertices_(),
+    indices_(),
+    version_(0),
+    bvhNodes_(),
+    bvhTriangles_()
 {
 }
 
+void Triangles::reserve(int numVertices, int numTriangles)
+{
+    vertices_.reserve(2 * numVertices);
+    indices_.reserve(3 * numTriangles);
+}
+
+std::uint64_t Triangles::version() const
+{
+    // Versions are assigned lazily, so that building triangles doesn't
+    // consume one version per added triangle. The counter is atomic since
+    // triangles may be built and versioned on worker threads, e.g. by
+    // background jobs, though a given object must not be accessed from
+    // several threads at once, as for any other method.
+    static std::atomic<std::uint64_t> lastVersion(0);
+    if (version_ == 0)
+        version_ = ++lastVersion;
+    return version_;
+}
+
+Triangle Triangles::operator[] (int i) const
+{
+    return Triangle(vertex(indices_[3*i]),
+                    vertex(indices_[3*i+1]),
+                    vertex(indices_[3*i+2]));
+}
+
 bool Triangle::intersects(const Eigen::Vector2d & p) const
 {
     double a1 = cross(b-a,p-a);
@@ -143,10 +176,143 @@ bool Triangle::intersects(const BoundingBox & bb) const
     return true;
 }
 
+namespace
+{
+
+// Meshes with fewer triangles are hit-tested by brute force: building and
+// storing a BVH for them is not worth it.
+const int bvhMinTriangles = 64;
+
+// Maximum number of triangles in a leaf of the BVH
+const int bvhLeafSize = 8;
+
+// Results of testing a node of the BVH against a query
+enum class BVHNodeTest
+{
+    Disjoint,   // no triangle of the node can intersect the query
+    Overlaps,   // some triangles of the node may intersect the query
+    IsContained // all triangles of the node intersect the query
+};
+
+}
+
+bool Triangles::hasBVH_() const
+{
+    const int n = size();
+    if (n < bvhMinTriangles)
+        return false;
+
+    if (bvhNodes_.empty())
+    {
+        std::vector<BoundingBox> boxes;
+        boxes.reserve(n);
+        for (int i=0; i<n; ++i)
+            boxes.push_back((*this)[i].boundingBox());
+
+        bvhTriangles_.resize(n);
+        std::iota(bvhTriangles_.begin(), bvhTriangles_.end(), 0);
+        bvhNodes_.reserve(2 * (n / bvhLeafSize) + 1);
+        buildBVH_(0, n, boxes);
+    }
+    return true;
+}
+
+int Triangles::buildBVH_(int begin, int end, const std::vector<BoundingBox> & boxes) const
+{
+    const int index = static_cast<int>(bvhNodes_.size());
+    bvhNodes_.push_back(BVHNode());
+
+    // Compute bounding box of the node, and of the centers of its triangles
+    BoundingBox bb;
+    BoundingBox centers;
+    for (int k=begin; k<end; ++k)
+    {
+        const BoundingBox & b = boxes[bvhTriangles_[k]];
+        bb.unite(b);
+        centers.unite(BoundingBox(b.xMid(), b.yMid()));
+    }
+
+    // Note: vertices are floats, so these conversions are exact
+    BVHNode & node = bvhNodes_[index];
+    node.xMin = static_cast<float>(bb.xMin());
+    node.xMax = static_cast<float>(bb.xMax());
+    node.yMin = static_cast<float>(bb.yMin());
+    node.yMax = static_cast<float>(bb.yMax());
+    node.begin = begin;
+    node.end = end;
+    node.right = -1;
+
+    // Split at the median along the largest dimension, which keeps the
+    // tree balanced even for very uneven triangle sizes
+    if (end - begin > bvhLeafSize)
+    {
+        const bool splitX = centers.width() >= centers.height();
+        const int mid = begin + (end - begin) / 2;
+        std::nth_element(bvhTriangles_.begin() + begin,
+                         bvhTriangles_.begin() + mid,
+                         bvhTriangles_.begin() + end,
+                         [&](std::uint32_t i, std::uint32_t j) {
+            return splitX ? boxes[i].xMid() < boxes[j].xMid()
+                          : boxes[i].yMid() < boxes[j].yMid();
+        });
+        buildBVH_(begin, mid, boxes);
+        const int right = buildBVH_(mid, end, boxes);
+        bvhNodes_[index].right = right; // Note: `node` may be dangling now
+    }
+
+    return index;
+}
+
+template <typename NodeTest, typename TriangleTest>
+bool Triangles::intersectsBVH_(NodeTest nodeTest, TriangleTest triangleTest) const
+{
+    // Depth-first traversal. The tree is balanced, so its depth is at most
+    // log2(size()) + 1, and the stack can't overflow.
+    int stack[64];
+    int stackSize = 0;
+    stack[stackSize++] = 0;
+    while (stackSize > 0)
+    {
+        const int index = stack[--stackSize];
+        const BVHNode & node = bvhNodes_[index];
+        const BVHNodeTest res = nodeTest(node);
+        if (res == BVHNodeTest::IsContained)
+        {
+            return true;
+        }
+        else if (res == BVHNodeTest::Overlaps)
+        {
+            if (node.right < 0)
+            {
+                for (int k=node.begin; k<node.end; ++k)
+                    if (triangleTest((*this)[bvhTriangles_[k]]))
+                        return true;
+            }
+            else
+            {
+                stack[stackSize++] = node.right;
+                stack[stackSize++] = index + 1;
+            }
+        }
+    }
+    return false;
+}
+
 bool Triangles::intersects(const Eigen::Vector2d & p) const
 {
-    for (const Triangle & t : triangles_)
-        if (t.intersects(p))
+    if (hasBVH_())
+    {
+        return intersectsBVH_(
+            [&](const BVHNode & node) {
+                return (p[0] < node.xMin || p[0] > node.xMax ||
+                        p[1] < node.yMin || p[1] > node.yMax) ?
+                            BVHNodeTest::Disjoint : BVHNodeTest::Overlaps;
+            },
+            [&](const Triangle & t) { return t.intersects(p); });
+    }
+
+    for (int i=0; i<size(); ++i)
+        if ((*this)[i].intersects(p))
             return true;
 
     return false;
@@ -154,8 +320,24 @@ bool Triangles::intersects(const Eigen::Vector2d & p) const
 
 bool Triangles::intersects(const BoundingBox & bb) const
 {
-    for (const Triangle & t : triangles_)
-        if (t.intersects(bb))
+    if (hasBVH_())
+    {
+        return intersectsBVH_(
+            [&](const BVHNode & node) {
+                if (bb.xMax() < node.xMin || bb.xMin() > node.xMax ||
+                    bb.yMax() < node.yMin || bb.yMin() > node.yMax)
+                    return BVHNodeTest::Disjoint;
+                else if (bb.xMin() <= node.xMin && node.xMax <= bb.xMax() &&
+                         bb.yMin() <= node.yMin && node.yMax <= bb.yMax())
+                    return BVHNodeTest::IsContained;
+                else
+                    return BVHNodeTest::Overlaps;
+            },
+            [&](const Triangle & t) { return t.intersects(bb); });
+    }
+
+    for (int i=0; i<size(); ++i)
+        if ((*this)[i].intersects(bb))
             return true;
 
     return false;
@@ -171,22 +353,28 @@ BoundingBox Triangle::boundingBox() const
 
 BoundingBox Triangles::boundingBox() const
 {
+    // Note: all vertices are used by at least one triangle, so we can
+    // iterate over vertices rather than triangles
     BoundingBox bb;
-    for (const Triangle & t : triangles_)
-        bb.unite(t.boundingBox());
+    for (int i=0; i<numVertices(); ++i)
+    {
+        double x = vertices_[2*i];
+        double y = vertices_[2*i+1];
+        bb.unite(BoundingBox(x, y));
+    }
     return bb;
 }
 
 void Triangles::draw() const
 {
-    glBegin(GL_TRIANGLES);
-    for (unsigned int i=0; i<triangles_.size(); ++i)
-    {
-        glVertex2d(triangles_[i].a[0], triangles_[i].a[1]);
-        glVertex2d(triangles_[i].b[0], triangles_[i].b[1]);
-        glVertex2d(triangles_[i].c[0], triangles_[i].c[1]);
-    }
-    glEnd();
+    if (indices_.empty())
+        return;
+
+    // One draw call instead of one glVertex call per vertex
+    glEnableClientState(GL_VERTEX_ARRAY);
+    glVertexPointer(2, GL_FLOAT, 0, vertices_.data());
+    glDrawElements(GL_TRIANGLES, static_cast<GLsizei>(indices_.size()), GL_UNSIGNED_INT, indices_.data());
+    glDisableClientState(GL_VERTEX_ARRAY);
 }
 
 void Triangles::draw3D(Time t, View3DSettings & viewSettings) const
@@ -194,11 +382,9 @@ void Triangles::draw3D(Time t, View3DSettings & viewSettings) const
     const double z = viewSettings.zFromT(t);
 
     glBegin (GL_TRIANGLES);
-    for (unsigned int i=0; i<triangles_.size(); ++i)
+    for (std::uint32_t i : indices_)
     {
-        glVertex3d(viewSettings.xFromX2D(triangles_[i].a[0]), viewSettings.yFromY2D(triangles_[i].a[1]), z);
-        glVertex3d(viewSettings.xFromX2D(triangles_[i].b[0]), viewSettings.yFromY2D(triangles_[i].b[1]), z);
-        glVertex3d(viewSettings.xFromX2D(triangles_[i].c[0]), viewSettings.yFromY2D(triangles_[i].c[1]), z);
+        glVertex3d(viewSettings.xFromX2D(vertices_[2*i]), viewSettings.yFromY2D(vertices_[2*i+1]), z);
     }
     glEnd();
 }
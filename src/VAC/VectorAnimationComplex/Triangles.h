@@ -20,6 +20,7 @@
 #include "../TimeDef.h"
 #include "Eigen.h"
 #include "BoundingBox.h"
+#include <cstdint>
 #include <vector>
 
 class View3DSettings;
@@ -58,6 +59,16 @@ struct Triangle {
     EIGEN_MAKE_ALIGNED_OPERATOR_NEW
 };
 
+// Triangles are stored as an indexed mesh in single precision: an array of
+// vertex positions, shared between adjacent triangles, and an array of
+// vertex indices, three per triangle. This is several times more compact
+// than storing three double-precision points per triangle, which matters
+// since triangles are cached per cell and per frame, and is the layout
+// expected by glDrawElements().
+//
+// For large meshes, hit-testing uses a bounding volume hierarchy (BVH) over
+// the triangles, built on first use and kept until the triangles change.
+//
 class Triangles
 {
 public:
@@ -65,34 +76,70 @@ public:
     Triangles();
 
     // Clear
-    inline void clear() {triangles_.clear();}
+    inline void clear() {vertices_.clear(); indices_.clear(); invalidateBVH_(); version_ = 0;}
 
-    // Append a triangle
+    // Append a vertex, and return its index
+    inline int addVertex(double x, double y)
+    {
+        int i = numVertices();
+        vertices_.push_back(static_cast<float>(x));
+        vertices_.push_back(static_cast<float>(y));
+        version_ = 0;
+        return i;
+    }
+    inline int addVertex(const Eigen::Vector2d & p)
+    {
+        return addVertex(p[0], p[1]);
+    }
+
+    // Append a triangle given the indices of its vertices
+    inline void addTriangle(int i, int j, int k)
+    {
+        indices_.push_back(static_cast<std::uint32_t>(i));
+        indices_.push_back(static_cast<std::uint32_t>(j));
+        indices_.push_back(static_cast<std::uint32_t>(k));
+        invalidateBVH_();
+        version_ = 0;
+    }
+
+    // Append a triangle with new vertices. Prefer addVertex() and
+    // addTriangle() when vertices are shared between triangles.
     inline Triangles & operator<< (const Triangle & t)
     {
-        triangles_.push_back(t);
+        append(t.a[0], t.a[1], t.b[0], t.b[1], t.c[0], t.c[1]);
         return *this;
     }
     inline void append(double ax, double ay,
                        double bx, double by,
                        double cx, double cy)
     {
-        Triangle t;
-        t.a[0] = ax;
-        t.a[1] = ay;
-        t.b[0] = bx;
-        t.b[1] = by;
-        t.c[0] = cx;
-        t.c[1] = cy;
-        triangles_.push_back(t);
+        int i = addVertex(ax, ay);
+        int j = addVertex(bx, by);
+        int k = addVertex(cx, cy);
+        addTriangle(i, j, k);
     }
 
-    // Access and modify content
-    inline int size() const {return (int)triangles_.size();}
-    inline Triangle & operator[] (int i) {return triangles_[i];}
+    // Reserve memory for the given number of vertices and triangles
+    void reserve(int numVertices, int numTriangles);
+
+    // Access content
+    inline int size() const {return (int)(indices_.size() / 3);}
+    inline int numVertices() const {return (int)(vertices_.size() / 2);}
+    inline Eigen::Vector2d vertex(int i) const {return Eigen::Vector2d(vertices_[2*i], vertices_[2*i+1]);}
+    Triangle operator[] (int i) const;
 
-    // Access raw data
-    inline double * data() {return reinterpret_cast<double*>(triangles_.data());}
+    // Access raw data: packed (x, y) vertex positions, and three vertex
+    // indices per triangle, ready to be passed to glVertexPointer() and
+    // glDrawElements()
+    inline const std::vector<float> & vertices() const {return vertices_;}
+    inline const std::vector<std::uint32_t> & indices() const {return indices_;}
+
+    // Returns a number identifying the current content: it changes whenever
+    // the triangles change, and is never the same for two different
+    // contents, even of different Triangles objects. Copies share the
+    // version of their source. This allows TriangleBatch to detect that the
+    // triangles it has already uploaded to the GPU are still valid.
+    std::uint64_t version() const;
 
     // Check whether a point p is included is at least one triangle
     bool intersects(const Eigen::Vector2d & p) const;
@@ -107,10 +154,35 @@ public:
     void draw() const;
     void draw3D(Time t, View3DSettings & viewSettings) const;
 
-    EIGEN_MAKE_ALIGNED_OPERATOR_NEW
-
 private:
-    std::vector<Triangle, Eigen::aligned_allocator<Triangle>> triangles_;
+    std::vector<float> vertices_;
+    std::vector<std::uint32_t> indices_;
+    mutable std::uint64_t version_; // 0 means not assigned yet
+
+    // Bounding volume hierarchy. Each node covers a contiguous range of
+    // bvhTriangles_, which stores triangle indices sorted such that
+    // triangles of the same node are close to each other. Node 0 is the
+    // root, and is followed by its left subtree then its right subtree.
+    struct BVHNode
+    {
+        float xMin, xMax, yMin, yMax;
+        int begin, end; // range of triangles in bvhTriangles_
+        int right;      // index of right child, or -1 for leaves
+    };
+    mutable std::vector<BVHNode> bvhNodes_;
+    mutable std::vector<std::uint32_t> bvhTriangles_;
+    inline void invalidateBVH_()
+    {
+        if (!bvhNodes_.empty())
+        {
+            bvhNodes_.clear();
+            bvhTriangles_.clear();
+        }
+    }
+    bool hasBVH_() const;
+    int buildBVH_(int begin, int end, const std::vector<BoundingBox> & boxes) const;
+    template <typename NodeTest, typename TriangleTest>
+    bool intersectsBVH_(NodeTest nodeTest, TriangleTest triangleTest) const;
 };
 
 }
@@ -34,6 +34,7 @@
 
 #include "Algorithms.h"
 #include "CellObserver.h"
+#include "CellAllocator.h"
 
 #include "EdgeSample.h"
 #include "EdgeGeometry.h"
@@ -52,6 +53,7 @@
 #include "../XmlStreamWriter.h"
 #include "../XmlStreamReader.h"
 
+#include <QHash>
 #include <QPair>
 #include <QtDebug>
 #include <QApplication>
@@ -59,6 +61,13 @@
 #include <QStatusBar>
 #include <QColorDialog>
 #include <QInputDialog>
+#include <QElapsedTimer>
+#include <QRunnable>
+#include <QThreadPool>
+
+#include <algorithm> // max, sort
+#include <cmath> // isfinite
+#include <memory> // unique_ptr
 
 #define MYDEBUG 0
 
@@ -72,6 +81,55 @@ namespace
 
 const double PI = 3.14159;
 
+// Skips cells that are entirely outside of the visible rect of the given view
+// settings. Cell bounding boxes are cached per frame, so this is much cheaper
+// than drawing them, especially when zoomed in on large scenes.
+class ViewCuller
+{
+public:
+    ViewCuller(const ViewSettings & viewSettings) :
+        isEnabled_(false)
+    {
+        double xMin = viewSettings.visibleXMin();
+        double xMax = viewSettings.visibleXMax();
+        double yMin = viewSettings.visibleYMin();
+        double yMax = viewSettings.visibleYMax();
+        if (std::isfinite(xMin) && std::isfinite(xMax) &&
+            std::isfinite(yMin) && std::isfinite(yMax))
+        {
+            // Margin accounting for what is drawn outside of the cell bounding
+            // boxes: topology outline, selection highlighting, and antialiasing.
+            double s = 0.5 * std::max(6, std::max(viewSettings.vertexTopologySize(),
+                                                  viewSettings.edgeTopologyWidth()));
+            if (viewSettings.screenRelative() && viewSettings.zoom() > 0)
+                s /= viewSettings.zoom();
+            double margin = s + 2;
+
+            rect_ = BoundingBox(xMin - margin, xMax + margin,
+                                yMin - margin, yMax + margin);
+            isEnabled_ = true;
+        }
+    }
+
+    bool mayBeVisible(Cell * c, Time time) const
+    {
+        if (!isEnabled_)
+            return true;
+
+        // Note: checking existence first is necessary, since computing the
+        // bounding box of a cell that doesn't exist at this time is invalid
+        if (!c->exists(time))
+            return false;
+
+        return c->boundingBox(time).intersects(rect_) ||
+               c->outlineBoundingBox(time).intersects(rect_);
+    }
+
+private:
+    bool isEnabled_;
+    BoundingBox rect_;
+};
+
 bool isCycleContainedInFace(const Cycle & cycle, const PreviewKeyFace & face)
 {
     // Get edges involved in cycle
@@ -264,6 +322,7 @@ bool addHoleToPaintedFace(QSet<KeyEdge*> & potentialHoleEdges,
 void VAC::initNonCopyable()
 {
     drawRectangleOfSelection_ = false;
+    hasRectangleOfSelectionModifiers_ = false;
     sketchedEdge_ = 0;
     hoveredFaceOnMousePress_ = 0;
     hoveredFaceOnMouseRelease_ = 0;
@@ -272,6 +331,11 @@ void VAC::initNonCopyable()
     hoveredCell_ = 0;
     transformTool_.setNoHoveredObject();
     transformTool_.setCells(CellSet());
+    transactionDepth_ = 0;
+    transactionGeometryChangedCells_.clear();
+    trackStarChanges_ = false;
+    starChangedVertices_.clear();
+    modifiedCellIds_.clear();
     deselectAll();
     signalCounter_ = 0;
 }
@@ -281,12 +345,21 @@ void VAC::initCopyable()
     setMaxID_(-1);
     ds_ = 5.0;
     cells_.clear();
+    for(int i=0; i<NumCellTypes; ++i)
+        cellIdsByType_[i].clear();
     zOrdering_.clear();
+    keyVertexIndices_.clear();
+    sculptIndex_.clear();
+    sculptIndexChangedEdges_.clear();
+    hasSculptIndex_ = false;
 }
 
 
 VAC::VAC() :
-    SceneObject()
+    SceneObject(),
+    numSelectedCells_(),
+    selectedCellsDirty_(false),
+    numDraws_(0)
 {
     initNonCopyable();
     initCopyable();
@@ -295,6 +368,7 @@ VAC::VAC() :
 VAC::~VAC()
 {
     deleteAllCells();
+    qDeleteAll(drawBatches_);
 }
 
 QString VAC::stringType()
@@ -318,7 +392,7 @@ VAC * VAC::clone()
     foreach(Cell * cell, cells_)
     {
         Cell * newCell = cell->clone();
-        newVAC->cells_[newCell->id()] = newCell;
+        newVAC->addToCellTable_(newCell);
         newCell->setSelected(false);
         newCell->setHovered(false);
     }
@@ -440,31 +514,12 @@ void VAC::drawSketchedEdge(Time time, ViewSettings & /*viewSettings*/) const
     glEnd();
 
     // Start cap
-    int n = 50;
     p = Eigen::Vector2d( sketchedEdge_->leftPos().x(), sketchedEdge_->leftPos().y() );
-    double r = 0.5 * sketchedEdge_->leftPos().width();
-    glBegin(GL_POLYGON);
-    {
-        for(int i=0; i<n; ++i)
-        {
-            double theta = 2 * (double) i * 3.14159 / (double) n ;
-            glVertex2d(p.x() + r*std::cos(theta),p.y()+ r*std::sin(theta));
-        }
-    }
-    glEnd();
+    GLUtils::drawDisk(p, 0.5 * sketchedEdge_->leftPos().width());
 
     // End cap
     p = Eigen::Vector2d( sketchedEdge_->rightPos().x(), sketchedEdge_->rightPos().y() );
-    r = 0.5 * sketchedEdge_->rightPos().width();
-    glBegin(GL_POLYGON);
-    {
-        for(int i=0; i<n; ++i)
-        {
-            double theta = 2 * (double) i * 3.14159 / (double) n ;
-            glVertex2d(p.x() + r*std::cos(theta),p.y()+ r*std::sin(theta));
-        }
-    }
-    glEnd();
+    GLUtils::drawDisk(p, 0.5 * sketchedEdge_->rightPos().width());
 }
 
 void VAC::drawTopologySketchedEdge(Time time, ViewSettings & viewSettings) const
@@ -486,16 +541,51 @@ void VAC::drawTopologySketchedEdge(Time time, ViewSettings & viewSettings) const
     glEnd();
 }
 
+VAC::DrawBatches & VAC::findDrawBatches_(ViewSettings & viewSettings, Time time)
+{
+    // Keep the batches of a few recent draws. This is enough for all onion
+    // skins of all views, while bounding the memory used when the time
+    // changes.
+    const int maxDrawBatches = 32;
+
+    DrawBatchesKey key(reinterpret_cast<quintptr>(&viewSettings), time.floatTime());
+    DrawBatches * res = drawBatches_.value(key, 0);
+    if(!res)
+    {
+        if(drawBatches_.size() >= maxDrawBatches)
+        {
+            auto oldest = drawBatches_.begin();
+            for(auto it = drawBatches_.begin(); it != drawBatches_.end(); ++it)
+                if(it.value()->lastUsed < oldest.value()->lastUsed)
+                    oldest = it;
+            delete oldest.value();
+            drawBatches_.erase(oldest);
+        }
+        res = new DrawBatches();
+        drawBatches_.insert(key, res);
+    }
+    res->lastUsed = ++numDraws_;
+    return *res;
+}
+
 void VAC::draw(Time time, ViewSettings & viewSettings)
 {
     ViewSettings::DisplayMode displayMode = viewSettings.displayMode();
+    ViewCuller culler(viewSettings);
+
+    // Note: cells are appended to the batches in z-order, then drawn in one
+    // call per pass, which gives the same result as drawing them one by one,
+    // but with much less driver overhead.
+    DrawBatches & batches = findDrawBatches_(viewSettings, time);
 
     // Illustration mode
     if( (displayMode == ViewSettings::ILLUSTRATION))
     {
-        // Draw all cells
+        // Draw all visible cells
         for(auto c: zOrdering_)
-            c->draw(time, viewSettings);
+            if(culler.mayBeVisible(c, time))
+                c->drawBatched(time, viewSettings, batches.fill);
+        batches.fill.flush();
 
         // Draw sketched edge
         if(sketchedEdge_)
@@ -505,9 +595,11 @@ void VAC::draw(Time time, ViewSettings & viewSettings)
     // Outline only mode
     else if( (displayMode == ViewSettings::OUTLINE) )
     {
-        // Draw all cells
+        // Draw all visible cells
         for(auto c: zOrdering_)
-            c->drawTopology(time, viewSettings);
+            if(culler.mayBeVisible(c, time))
+                c->drawTopologyBatched(time, viewSettings, batches.topology);
+        batches.topology.flush();
 
         // Draw sketched edge
         if(sketchedEdge_)
@@ -519,13 +611,17 @@ void VAC::draw(Time time, ViewSettings & viewSettings)
     {
         // First pass
         for(auto c: zOrdering_)
-            c->draw(time, viewSettings);
+            if(culler.mayBeVisible(c, time))
+                c->drawBatched(time, viewSettings, batches.fill);
+        batches.fill.flush();
         if(sketchedEdge_)
             drawSketchedEdge(time, viewSettings);
 
         // Second pass
         for(auto c: zOrdering_)
-            c->drawTopology(time, viewSettings);
+            if(culler.mayBeVisible(c, time))
+                c->drawTopologyBatched(time, viewSettings, batches.topology);
+        batches.topology.flush();
         if(sketchedEdge_)
             drawTopologySketchedEdge(time, viewSettings);
     }
@@ -553,9 +649,8 @@ void VAC::draw(Time time, ViewSettings & viewSettings)
         glColor3d(1,0,0);
 
         // draw point on instant edge
-        int n = 50;
         EdgeSample p = sculptedEdge_->geometry()->sculptVertex();
-        glBegin(GL_POLYGON);
+        Eigen::Vector2d center(p.x(), p.y());
         {
             double r = 0.5 * p.width();
             if(displayMode == ViewSettings::ILLUSTRATION_OUTLINE ||
@@ -571,26 +666,12 @@ void VAC::draw(Time time, ViewSettings & viewSettings)
             {
                 r = 1.0 / viewSettings.zoom();
             }
-            for(int i=0; i<n; ++i)
-            {
-                double theta = 2 * (double) i * 3.14159 / (double) n ;
-                glVertex2d(p.x() + r*std::cos(theta),p.y()+ r*std::sin(theta));
-            }
+            GLUtils::drawDisk(center, r);
         }
-        glEnd();
 
         // draw circle of influence
         glLineWidth(1);
-        glBegin(GL_LINE_LOOP);
-        {
-            double r = global()->sculptRadius();
-            for(int i=0; i<n; ++i)
-            {
-                double theta = 2 * (double) i * 3.14159 / (double) n ;
-                glVertex2d(p.x() + r*std::cos(theta),p.y()+ r*std::sin(theta));
-            }
-        }
-        glEnd();
+        GLUtils::drawCircle(center, global()->sculptRadius());
     }
 
     // Draw pen radius and snap threshold
@@ -608,8 +689,6 @@ void VAC::draw(Time time, ViewSettings & viewSettings)
         Eigen::Vector2d p = global()->sceneCursorPos();
 
         // Draw pen cursor position + radius as disk
-        int n = 50;
-        glBegin(GL_POLYGON);
         {
             // Note: Unlike for the sculpt radius widget, we always draw the sketch widget with the actual
             //       drawn width even in topology mode, since we want to give feedback to the user to what's
@@ -630,28 +709,14 @@ void VAC::draw(Time time, ViewSettings & viewSettings)
             {
                 r = 1.0 / viewSettings.zoom();
             }
-            for(int i=0; i<n; ++i)
-            {
-                double theta = 2 * (double) i * 3.14159 / (double) n ;
-                glVertex2d(p[0] + r*std::cos(theta),p[1]+ r*std::sin(theta));
-            }
+            GLUtils::drawDisk(p, r);
         }
-        glEnd();
 
         // draw snap radius
         if(global()->snapMode())
         {
             glLineWidth(1);
-            glBegin(GL_LINE_LOOP);
-            {
-                double r = global()->snapThreshold();
-                for(int i=0; i<n; ++i)
-                {
-                    double theta = 2 * (double) i * 3.14159 / (double) n ;
-                    glVertex2d(p[0] + r*std::cos(theta),p[1]+ r*std::sin(theta));
-                }
-            }
-            glEnd();
+            GLUtils::drawCircle(p, global()->snapThreshold());
         }
 
 
@@ -685,7 +750,7 @@ void VAC::draw(Time time, ViewSettings & viewSettings)
     // Transform tool
     if(global()->toolMode() == Global::SELECT && viewSettings.isMainDrawing())
     {
-        transformTool_.draw(selectedCells_, time, viewSettings);
+        transformTool_.draw(selectedCells(), time, viewSettings);
     }
 
     // Draw edge orientation
@@ -721,22 +786,25 @@ void VAC::draw(Time time, ViewSettings & viewSettings)
 void VAC::drawPick(Time time, ViewSettings & viewSettings)
 {
     ViewSettings::DisplayMode displayMode = viewSettings.displayMode();
+    ViewCuller culler(viewSettings);
 
     if( (displayMode == ViewSettings::ILLUSTRATION) )
     {
-        // Draw all cells
+        // Draw all visible cells
         for(auto c: zOrdering_)
         {
-            c->drawPick(time, viewSettings);
+            if(culler.mayBeVisible(c, time))
+                c->drawPick(time, viewSettings);
         }
     }
 
     else if( (displayMode == ViewSettings::OUTLINE) )
     {
-        // Draw all cells
+        // Draw all visible cells
         for(auto c: zOrdering_)
         {
-            c->drawPickTopology(time, viewSettings);
+            if(culler.mayBeVisible(c, time))
+                c->drawPickTopology(time, viewSettings);
         }
     }
 
@@ -745,7 +813,7 @@ void VAC::drawPick(Time time, ViewSettings & viewSettings)
         // first pass: pick faces normally
         for(auto c: zOrdering_)
         {
-            if(c->toFaceCell())
+            if(c->toFaceCell() && culler.mayBeVisible(c, time))
                 c->drawPick(time, viewSettings);
         }
 
@@ -753,7 +821,7 @@ void VAC::drawPick(Time time, ViewSettings & viewSettings)
         // second pass: pick vertices and edges as outline
         for(auto c: zOrdering_)
         {
-            if(!c->toFaceCell())
+            if(!c->toFaceCell() && culler.mayBeVisible(c, time))
                 c->drawPickTopology(time, viewSettings);
         }
     }
@@ -761,7 +829,7 @@ void VAC::drawPick(Time time, ViewSettings & viewSettings)
     // Transform tool
     if(global()->toolMode() == Global::SELECT && viewSettings.isMainDrawing())
     {
-        transformTool_.drawPick(selectedCells_, time, viewSettings);
+        transformTool_.drawPick(selectedCells(), time, viewSettings);
     }
 }
 
@@ -800,10 +868,144 @@ void VAC::endAggregateSignals_()
         {
             transformTool_.setCells(selectedCells());
             emit selectionChanged();
+            informTimelineOfSelection();
         }
     }
 }
 
+void VAC::emitNeedUpdatePicking_()
+{
+    if(transactionDepth_ == 0)
+        emit needUpdatePicking();
+    else
+        transactionNeedUpdatePicking_ = true;
+}
+
+void VAC::emitChanged_()
+{
+    if(transactionDepth_ == 0)
+        emit changed();
+    else
+        transactionChanged_ = true;
+}
+
+void VAC::emitCheckpoint_()
+{
+    if(transactionDepth_ == 0)
+        emit checkpoint();
+    else
+        transactionCheckpoint_ = true;
+}
+
+
+
+// ------------------------ Transactions -----------------------
+
+void VAC::beginTransaction()
+{
+    if(transactionDepth_ == 0)
+    {
+        transactionNeedUpdatePicking_ = false;
+        transactionChanged_ = false;
+        transactionCheckpoint_ = false;
+        transactionGeometryChangedCells_.clear();
+    }
+
+    transactionDepth_++;
+    beginAggregateSignals_();
+}
+
+void VAC::endTransaction()
+{
+    if(transactionDepth_ == 0)
+        return;
+
+    if(transactionDepth_ == 1)
+    {
+        // Invalidate cached geometry. Deleted cells were removed from
+        // transactionGeometryChangedCells_ by removeCell_().
+        CellSet toClearCells;
+        foreach(Cell * cell, transactionGeometryChangedCells_)
+            toClearCells.unite(cell->geometryDependentCells_());
+        transactionGeometryChangedCells_.clear();
+        foreach(Cell * cell, toClearCells)
+            cell->clearCachedGeometry_();
+        processGeometryChanged_(toClearCells);
+
+#if defined(VPAINT_CHECK_ALL_INVARIANTS)
+        modifiedCellIds_.clear();
+        if(!check())
+            qDebug() << "VAC is not valid at the end of a transaction";
+#elif defined(QT_DEBUG) || defined(VPAINT_CHECK_INVARIANTS)
+        if(!checkModified())
+            qDebug() << "VAC is not valid at the end of a transaction";
+#else
+        modifiedCellIds_.clear();
+#endif
+    }
+
+    transactionDepth_--;
+    endAggregateSignals_();
+
+    if(transactionDepth_ == 0)
+    {
+        if(transactionNeedUpdatePicking_)
+            emit needUpdatePicking();
+        if(transactionChanged_)
+            emit changed();
+        if(transactionCheckpoint_)
+            emit checkpoint();
+    }
+}
+
+bool VAC::isInTransaction() const
+{
+    return transactionDepth_ > 0;
+}
+
+void VAC::beginTrackingStarChanges_()
+{
+    trackStarChanges_ = true;
+    starChangedVertices_.clear();
+}
+
+KeyVertexSet VAC::endTrackingStarChanges_()
+{
+    KeyVertexSet res;
+    res.swap(starChangedVertices_);
+    trackStarChanges_ = false;
+    return res;
+}
+
+void VAC::setModified_(Cell * cell)
+{
+    modifiedCellIds_.insert(cell->id());
+}
+
+void VAC::processStarChanged_(Cell * cell)
+{
+    setModified_(cell);
+    if(trackStarChanges_)
+    {
+        KeyVertex * keyVertex = cell->toKeyVertex();
+        if(keyVertex)
+            starChangedVertices_.insert(keyVertex);
+    }
+}
+
+bool VAC::deferGeometryChanged_(Cell * cell)
+{
+    if(transactionDepth_ > 0)
+    {
+        transactionGeometryChangedCells_.insert(cell);
+        return true;
+    }
+    else
+    {
+        return false;
+    }
+}
+
 
 
 // ----------------- Selecting and Highlighting ----------------
@@ -849,14 +1051,14 @@ void VAC::deselectAll(Time time)
 void VAC::deselectAll()
 {
     if(numSelectedCells() != 0)
-        setSelectedCells(CellSet(),false);
+        setSelectedIds_(CellBitSet(),false);
 }
 
 void VAC::invertSelection()
 {
-    QSet<Cell *> newSelectedCells = cells();
-    newSelectedCells.subtract(selectedCells());
-    setSelectedCells(newSelectedCells);
+    CellBitSet ids = cellIds_(AllTypes);
+    ids.subtract(selectedIds_);
+    setSelectedIds_(ids,true);
 }
 
 Cell * VAC::hoveredCell() const
@@ -866,12 +1068,37 @@ Cell * VAC::hoveredCell() const
 
 const CellSet & VAC::selectedCells() const
 {
+    if(selectedCellsDirty_)
+    {
+        selectedCells_.clear();
+        selectedCells_.reserve(selectedIds_.count());
+        selectedIds_.forEach([this](int id) {
+            selectedCells_.insert(cells_.value(id));
+        });
+        selectedCellsDirty_ = false;
+    }
     return selectedCells_;
 }
 
+const CellBitSet & VAC::selectedIds() const
+{
+    return selectedIds_;
+}
+
 int VAC::numSelectedCells() const
 {
-    return selectedCells_.size();
+    return selectedIds_.count();
+}
+
+int VAC::numSelectedCells(int types) const
+{
+    int res = 0;
+    for(int i=0; i<NumCellTypes; ++i)
+    {
+        if(types & (1 << i))
+            res += numSelectedCells_[i];
+    }
+    return res;
 }
 
 int VAC::hoveredTransformWidgetId() const
@@ -922,7 +1149,7 @@ void VAC::read(XmlStreamReader & xml)
             int id = cell->id();
             if(id > maxID_)
                 setMaxID_(id);
-            cells_.insert(id, cell);
+            addToCellTable_(cell);
             zOrdering_.insertLast(cell);
         }
     }
@@ -990,7 +1217,10 @@ void VAC::exportSVG_(QTextStream & out, const VectorExportSettings & settings, T
 }
 
 VAC::VAC(QTextStream & in) :
-    SceneObject()
+    SceneObject(),
+    numSelectedCells_(),
+    selectedCellsDirty_(false),
+    numDraws_(0)
 {
     clear();
 
@@ -1006,7 +1236,7 @@ VAC::VAC(QTextStream & in) :
         int id = cell->id();
         if(id > maxID_)
             setMaxID_(id);
-        cells_.insert(id, cell);
+        addToCellTable_(cell);
         zOrdering_.insertLast(cell);
         Read::skipBracket(in); // }
     }
@@ -1021,10 +1251,7 @@ VAC::VAC(QTextStream & in) :
 
 Cell * VAC::getCell(int id)
 {
-    if(cells_.contains(id))
-        return cells_[id];
-    else
-        return 0;
+    return cells_.value(id);
 }
 
 KeyVertex * VAC::getKeyVertex(int id)
@@ -1198,8 +1425,12 @@ void VAC::insertCell_(Cell * cell)
     int id = getAvailableID();
     cell->id_ = id;
     cell->vac_ = this;
-    cells_.insert(id, cell);
+    addToCellTable_(cell);
     zOrdering_.insertCell(cell);
+    if(KeyVertex * keyVertex = cell->toKeyVertex())
+        indexKeyVertex_(keyVertex);
+    if(hasSculptIndex_ && cell->toKeyEdge())
+        sculptIndexChangedEdges_.insert(id);
 }
 
 void VAC::insertCellLast_(Cell * cell)
@@ -1207,15 +1438,118 @@ void VAC::insertCellLast_(Cell * cell)
     int id = getAvailableID();
     cell->id_ = id;
     cell->vac_ = this;
-    cells_.insert(id, cell);
+    addToCellTable_(cell);
     zOrdering_.insertLast(cell);
+    if(KeyVertex * keyVertex = cell->toKeyVertex())
+        indexKeyVertex_(keyVertex);
+    if(hasSculptIndex_ && cell->toKeyEdge())
+        sculptIndexChangedEdges_.insert(id);
+}
+
+PointIndex & VAC::keyVertexIndex_(Time time)
+{
+    auto it = keyVertexIndices_.find(time);
+    if(it == keyVertexIndices_.end())
+    {
+        it = keyVertexIndices_.insert(time, PointIndex());
+        foreach(KeyVertex * keyVertex, instantVertices(time))
+            it->insert(keyVertex->id(), keyVertex->pos()[0], keyVertex->pos()[1]);
+    }
+    return *it;
+}
+
+void VAC::indexKeyVertex_(KeyVertex * keyVertex)
+{
+    // Indices not built yet will include this vertex when they are
+    auto it = keyVertexIndices_.find(keyVertex->time());
+    if(it != keyVertexIndices_.end() && checkContains(keyVertex))
+        it->insert(keyVertex->id(), keyVertex->pos()[0], keyVertex->pos()[1]);
+}
+
+void VAC::unindexKeyVertex_(KeyVertex * keyVertex)
+{
+    auto it = keyVertexIndices_.find(keyVertex->time());
+    if(it != keyVertexIndices_.end())
+        it->remove(keyVertex->id());
+}
+
+void VAC::updateSculptIndex_(Time time)
+{
+    // Rebuilding is linear in the number of edges, so we only do it once
+    // the cost of testing changed edges at each query is comparable
+    int maxChangedEdges = std::max(64, sculptIndex_.size() / 4);
+    if(!hasSculptIndex_ || !(sculptIndexTime_ == time) ||
+       sculptIndexChangedEdges_.size() > maxChangedEdges)
+    {
+        sculptIndex_.clear();
+        foreach(KeyEdge * iedge, instantEdges(time))
+            sculptIndex_.insert(iedge->id(), iedge->outlineBoundingBox(time));
+        sculptIndex_.build();
+        sculptIndexTime_ = time;
+        sculptIndexChangedEdges_.clear();
+        hasSculptIndex_ = true;
+    }
+}
+
+void VAC::processGeometryChanged_(const CellSet & cells)
+{
+    if(hasSculptIndex_)
+    {
+        foreach(Cell * cell, cells)
+        {
+            if(cell->toKeyEdge())
+                sculptIndexChangedEdges_.insert(cell->id());
+        }
+    }
+}
+
+void VAC::addToCellTable_(Cell * cell)
+{
+    setModified_(cell);
+    cells_.insert(cell->id(), cell);
+    cellIdsByType_[cellTypeIndex_(cell)].insert(cell->id());
+}
+
+void VAC::removeFromCellTable_(Cell * cell)
+{
+    cells_.remove(cell->id());
+    cellIdsByType_[cellTypeIndex_(cell)].remove(cell->id());
+}
+
+int VAC::cellTypeIndex_(Cell * cell)
+{
+    if(cell->toKeyVertex())
+        return 0;
+    else if(cell->toKeyEdge())
+        return 1;
+    else if(cell->toKeyFace())
+        return 2;
+    else if(cell->toInbetweenVertex())
+        return 3;
+    else if(cell->toInbetweenEdge())
+        return 4;
+    assert(cell->toInbetweenFace());
+    return 5;
+}
+
+CellBitSet VAC::cellIds_(int types) const
+{
+    CellBitSet res;
+    for(int i=0; i<NumCellTypes; ++i)
+    {
+        if(types & (1 << i))
+            res.unite(cellIdsByType_[i]);
+    }
+    return res;
 }
 
 void VAC::removeCell_(Cell * cell)
 {
     if(cell)
     {
-        cells_.remove(cell->id());
+        if(KeyVertex * keyVertex = cell->toKeyVertex())
+            unindexKeyVertex_(keyVertex);
+        removeFromCellTable_(cell);
         zOrdering_.removeCell(cell);
         removeFromSelection(cell,false);
         if(cell->isSelected())
@@ -1236,6 +1570,9 @@ void VAC::removeCell_(Cell * cell)
             hoveredFaceOnMouseRelease_= 0;
         hoveredFacesOnMouseMove_.remove(cell->toKeyFace());
         facesToConsiderForCutting_.remove(cell->toKeyFace());
+        transactionGeometryChangedCells_.remove(cell);
+        if(trackStarChanges_)
+            starChangedVertices_.remove(cell->toKeyVertex());
     }
 }
 
@@ -1288,22 +1625,26 @@ void VAC::smartDelete()
     //       v1 ---------- v2
     //  then deleting v1 should also delete v2 since e is deleted as a side effect
 
+    beginTransaction();
+    beginTrackingStarChanges_();
     smartDelete_(selectedCells());
 
-    // Automatic cleaning of vertices
-    // naive method for now, not efficient but works
+    // Automatic cleaning of vertices: only those whose star was affected
+    // by the deletion may have become isolated
+    KeyVertexSet verticesToConsiderForCleaning = endTrackingStarChanges_();
     if(global()->deleteIsolatedVertices())
     {
-        foreach(KeyVertex * keyVertex, instantVertices())
+        foreach(KeyVertex * keyVertex, verticesToConsiderForCleaning)
         {
-            if(keyVertex->star().isEmpty())
+            if(keyVertex->isStarEmpty())
                 deleteCell(keyVertex);
         }
     }
 
-    emit needUpdatePicking();
-    emit changed();
-    emit checkpoint();
+    emitNeedUpdatePicking_();
+    emitChanged_();
+    emitCheckpoint_();
+    endTransaction();
 }
 
 void VAC::deleteSelectedCells()
@@ -1311,49 +1652,64 @@ void VAC::deleteSelectedCells()
     if(numSelectedCells() == 0)
         return;
 
-    while(numSelectedCells() != 0)
-    {
-        Cell * obj = *selectedCells().begin();
-        deleteCell(obj);
-    }
+    beginTransaction();
+    beginTrackingStarChanges_();
+    deleteCells(selectedCells());
 
-    // Automatic cleaning of vertices
-    // naive method for now, not efficient but works
+    // Automatic cleaning of vertices: only those whose star was affected
+    // by the deletion may have become isolated
+    KeyVertexSet verticesToConsiderForCleaning = endTrackingStarChanges_();
     if(global()->deleteIsolatedVertices())
     {
-        foreach(KeyVertex * keyVertex, instantVertices())
+        foreach(KeyVertex * keyVertex, verticesToConsiderForCleaning)
         {
-            if(keyVertex->star().isEmpty())
+            if(keyVertex->isStarEmpty())
                 deleteCell(keyVertex);
         }
     }
 
-    emit needUpdatePicking();
-    emit changed();
-    emit checkpoint();
+    emitNeedUpdatePicking_();
+    emitChanged_();
+    emitCheckpoint_();
+    endTransaction();
 }
 
 void VAC::deleteCells(const QSet<int>  & cellIds)
 {
+    CellSet cells;
     foreach(int id, cellIds)
     {
-        // Get cell corresponding to ID
         Cell * cell = getCell(id);
-
-        // Note: cell might be NULL, as it might have been recursively deleted
-        //       that's why this method has to be implemented with IDs, as pointers
-        //       can become invalid if implemented directly with QSet<Cell*>
         if(cell)
-            deleteCell(cell);
+            cells << cell;
     }
+    deleteCells(cells);
 }
 
 void VAC::deleteCells(const CellSet & cells)
 {
-    QSet<int> cellIds;
-    foreach(Cell * c, cells)
-        cellIds << c->id();
-    deleteCells(cellIds);
+    // Deleting a cell recursively deletes its star. Since the star of a cell
+    // only contains cells of higher dimension, we delete the whole star of
+    // the given cells at once, by decreasing dimension, so that no deletion
+    // has to recurse.
+    CellList cellsToDelete;
+    Algorithms::fullstar(cells, cellsToDelete);
+    QVector<int> cellIdsByDimension[4];
+    foreach(Cell * c, cellsToDelete)
+        cellIdsByDimension[c->dimension()] << c->id();
+
+    for(int d=3; d>=0; --d)
+    {
+        foreach(int id, cellIdsByDimension[d])
+        {
+            // Note: cell might be NULL if it was nonetheless recursively
+            //       deleted, that's why this is implemented with IDs, as
+            //       pointers can become invalid
+            Cell * cell = getCell(id);
+            if(cell)
+                deleteCell(cell);
+        }
+    }
 }
 
 void VAC::deleteCell(Cell * cell)
@@ -1453,12 +1809,18 @@ void VAC::smartDeleteCell(Cell * cell)
 
 void VAC::deleteAllCells()
 {
+    // Delete from the highest ID downward: the table releases trailing empty
+    // slots, so last() stays constant-time, while begin() would have to skip
+    // over the growing run of empty slots left at the front
     while(!cells_.isEmpty())
     {
-        Cell * obj = *cells_.begin();
+        Cell * obj = cells_.last();
         deleteCell(obj);
     }
     setMaxID_(-1);
+
+    // Give back to the system the chunks that no other VAC uses
+    CellAllocator::instance().releaseUnusedMemory();
 }
 
 void VAC::setMaxID_(int maxID)
@@ -1580,6 +1942,52 @@ void VAC::beginRectangleOfSelection(double x, double y, Time time)
     rectangleOfSelectionEndY_ = y;
     drawRectangleOfSelection_ = true;
     rectangleOfSelectionSelectedBefore_ = selectedCells();
+
+    // Index the bounding boxes of pickable cells. Cells don't move while
+    // the rectangle is dragged, so the index is built only once.
+    rectangleOfSelectionIndex_.clear();
+    for(Cell * c: zOrdering_)
+    {
+        if (c->isPickable(timeInteractivity_))
+        {
+            rectangleOfSelectionIndex_.insert(c->id(), c->boundingBox(timeInteractivity_));
+        }
+    }
+    rectangleOfSelectionIndex_.build();
+    cellsInRectangleOfSelection_.clear();
+    rectangleOfSelectionBoundingBox_ = BoundingBox();
+    hasRectangleOfSelectionModifiers_ = false;
+}
+
+namespace
+{
+
+// Appends to `out` rectangles covering a minus b. These rectangles include
+// their boundary, so they may slightly overlap b.
+void appendDifference(const BoundingBox & a, const BoundingBox & b, std::vector<BoundingBox> & out)
+{
+    if(a.isEmpty())
+        return;
+
+    if(!a.intersects(b))
+    {
+        out.push_back(a);
+        return;
+    }
+
+    // Left and right vertical strips, then bottom and top strips in between
+    if(a.xMin() < b.xMin())
+        out.push_back(BoundingBox(a.xMin(), b.xMin(), a.yMin(), a.yMax()));
+    if(b.xMax() < a.xMax())
+        out.push_back(BoundingBox(b.xMax(), a.xMax(), a.yMin(), a.yMax()));
+    double xMin = std::max(a.xMin(), b.xMin());
+    double xMax = std::min(a.xMax(), b.xMax());
+    if(a.yMin() < b.yMin())
+        out.push_back(BoundingBox(xMin, xMax, a.yMin(), b.yMin()));
+    if(b.yMax() < a.yMax())
+        out.push_back(BoundingBox(xMin, xMax, b.yMax(), a.yMax()));
+}
+
 }
 
 void VAC::continueRectangleOfSelection(double x, double y)
@@ -1592,19 +2000,90 @@ void VAC::continueRectangleOfSelection(double x, double y)
     const BoundingBox bb(rectangleOfSelectionStartX_, rectangleOfSelectionEndX_,
                          rectangleOfSelectionStartY_, rectangleOfSelectionEndY_);
 
-    // Compute which cells intersect with bounding box
-    cellsInRectangleOfSelection_.clear();
-    for(Cell * c: zOrdering_)
-    {
-        if (c->isPickable(timeInteractivity_) &&
-            c->intersects(timeInteractivity_, bb))
+    // Only cells intersecting the difference between the previous and
+    // current rectangle may enter or leave the rectangle. Find them using
+    // the spatial index, then test them exactly.
+    std::vector<BoundingBox> changedRegions;
+    appendDifference(bb, rectangleOfSelectionBoundingBox_, changedRegions);
+    appendDifference(rectangleOfSelectionBoundingBox_, bb, changedRegions);
+    std::vector<int> candidates;
+    rectangleOfSelectionIndex_.query(changedRegions, candidates);
+    rectangleOfSelectionBoundingBox_ = bb;
+
+    CellSet enteringCells;
+    CellSet leavingCells;
+    for(int id: candidates)
+    {
+        Cell * c = getCell(id);
+        if(!c) // deleted since the rectangle started
+            continue;
+
+        bool wasInRectangle = cellsInRectangleOfSelection_.contains(c);
+        bool isInRectangle = c->intersects(timeInteractivity_, bb);
+        if(isInRectangle && !wasInRectangle)
         {
             cellsInRectangleOfSelection_ << c;
+            enteringCells << c;
+        }
+        else if(!isInRectangle && wasInRectangle)
+        {
+            cellsInRectangleOfSelection_.remove(c);
+            leavingCells << c;
         }
     }
 
-    // Set result
-    setSelectedCellsFromRectangleOfSelection();
+    // Set result. If modifiers didn't change, only cells entering or
+    // leaving the rectangle may change their selection state.
+    Qt::KeyboardModifiers modifiers = QGuiApplication::keyboardModifiers();
+    if(hasRectangleOfSelectionModifiers_ && modifiers == rectangleOfSelectionModifiers_)
+    {
+        updateSelectedCellsFromRectangleOfSelection_(enteringCells, leavingCells, modifiers);
+    }
+    else
+    {
+        setSelectedCellsFromRectangleOfSelection(modifiers);
+    }
+}
+
+void VAC::updateSelectedCellsFromRectangleOfSelection_(
+        const CellSet & enteringCells, const CellSet & leavingCells,
+        Qt::KeyboardModifiers modifiers)
+{
+    // Same logic as setSelectedCellsFromRectangleOfSelection(modifiers),
+    // applied to one cell
+    auto isSelectedAfter = [&](Cell * c, bool isInRectangle) {
+        bool wasSelectedBefore = rectangleOfSelectionSelectedBefore_.contains(c);
+        if(modifiers == Qt::NoModifier)
+            return isInRectangle;
+        else if(modifiers & Qt::ShiftModifier)
+        {
+            if(modifiers & Qt::AltModifier)
+                return wasSelectedBefore && isInRectangle;
+            else
+                return wasSelectedBefore || isInRectangle;
+        }
+        else if(modifiers & Qt::AltModifier)
+            return wasSelectedBefore && !isInRectangle;
+        else
+            return c->isSelected();
+    };
+
+    beginAggregateSignals_();
+    foreach(Cell * c, enteringCells)
+    {
+        if(isSelectedAfter(c, true))
+            addToSelection(c, false);
+        else
+            removeFromSelection(c, false);
+    }
+    foreach(Cell * c, leavingCells)
+    {
+        if(isSelectedAfter(c, false))
+            addToSelection(c, false);
+        else
+            removeFromSelection(c, false);
+    }
+    endAggregateSignals_();
 }
 
 void VAC::setSelectedCellsFromRectangleOfSelection()
@@ -1616,6 +2095,9 @@ void VAC::setSelectedCellsFromRectangleOfSelection()
 
 void VAC::setSelectedCellsFromRectangleOfSelection(Qt::KeyboardModifiers modifiers)
 {
+    hasRectangleOfSelectionModifiers_ = true;
+    rectangleOfSelectionModifiers_ = modifiers;
+
     if(modifiers == Qt::NoModifier)
     {
         // Set selection
@@ -1650,6 +2132,7 @@ void VAC::setSelectedCellsFromRectangleOfSelection(Qt::KeyboardModifiers modifie
 void VAC::endRectangleOfSelection()
 {
     drawRectangleOfSelection_ = false;
+    rectangleOfSelectionIndex_.clear();
 }
 
 // ------------- User action: drawing a new stroke -------------
@@ -1669,6 +2152,10 @@ void VAC::beginSketchEdge(double x, double y, double w, Time time)
             hoveredCell_ = keyframe_(sface, timeInteractivity_);
         hoveredFaceOnMousePress_ = hoveredCell_->toKeyFace();
     }
+
+    // Build the index of vertices to snap to now rather than on release
+    if(global()->snapMode())
+        keyVertexIndex_(timeInteractivity_);
 }
 
 void VAC::continueSketchEdge(double x, double y, double w)
@@ -1721,7 +2208,7 @@ void VAC::endSketchEdge()
 
 
         //emit changed();
-        emit checkpoint();
+        emitCheckpoint_();
     }
 }
 
@@ -1804,7 +2291,7 @@ void VAC::endCutFace(KeyVertex * endVertex)
         if(hasBeenCut)
         {
             //emit changed();
-            emit checkpoint();
+            emitCheckpoint_();
         }
     }
 }
@@ -2222,6 +2709,325 @@ VAC::SplitInfo VAC::cutEdgeAtVertices_(KeyEdge * edgeToSplit, const std::vector<
 }
 
 
+///////////////////////////////////////////////////////////////////////////
+////////////////////             PLANAR MAP             ///////////////////
+
+namespace
+{
+
+// A straight segment of the sampling of an edge, between samples i and i+1
+struct PlanarMapSegment
+{
+    int edge;       // index of the edge
+    int i;          // index of the first sample
+    int k;          // index among the kept segments of the edge, which
+                    // excludes zero-length segments
+    double s;       // arclength of the first sample
+    double length;  // length of the segment
+    double ax, ay, bx, by;
+    double xMin, xMax, yMin, yMax;
+    int row0, row1; // rows of the broad phase spanned by the segment
+};
+
+// Disjoint-set forest, used to cluster the intersections that must end up
+// as the same vertex
+class PlanarMapClusters
+{
+public:
+    int add()
+    {
+        int i = static_cast<int>(parent_.size());
+        parent_.push_back(i);
+        return i;
+    }
+
+    int size() const
+    {
+        return static_cast<int>(parent_.size());
+    }
+
+    int find(int i)
+    {
+        while(parent_[i] != i)
+        {
+            parent_[i] = parent_[parent_[i]];
+            i = parent_[i];
+        }
+        return i;
+    }
+
+    void unite(int i, int j)
+    {
+        i = find(i);
+        j = find(j);
+        if(i < j)
+            parent_[j] = i;
+        else if(j < i)
+            parent_[i] = j;
+    }
+
+private:
+    std::vector<int> parent_;
+};
+
+// Computes where the point (px, py) projects onto segment q, as a parameter
+// u in [0, 1], and returns the distance between the point and its projection.
+double projectOnSegment(double px, double py, const PlanarMapSegment & q, double & u)
+{
+    double vx = q.bx - q.ax;
+    double vy = q.by - q.ay;
+    double l2 = vx*vx + vy*vy;
+    u = ((px - q.ax)*vx + (py - q.ay)*vy) / l2;
+    u = std::min(1.0, std::max(0.0, u));
+    double dx = q.ax + u*vx - px;
+    double dy = q.ay + u*vy - py;
+    return std::sqrt(dx*dx + dy*dy);
+}
+
+// Computes the intersections between segments p and q, where segments
+// closer than `tolerance` are considered intersecting (e.g., when the
+// endpoint of an edge touches another edge). Calls f(u, v) for each
+// intersection, where u and v are the parameters in [0, 1] of the
+// intersection along p and q.
+template <typename F>
+void intersectSegments(const PlanarMapSegment & p, const PlanarMapSegment & q, double tolerance, F f)
+{
+    double ux = p.bx - p.ax, uy = p.by - p.ay;
+    double vx = q.bx - q.ax, vy = q.by - q.ay;
+    double wx = q.ax - p.ax, wy = q.ay - p.ay;
+    double det = ux*vy - uy*vx;
+    if(std::abs(det) > 1e-10 * p.length * q.length)
+    {
+        // Solve p.a + u*(p.b-p.a) = q.a + v*(q.b-q.a), allowing u and v to
+        // be slightly outside [0, 1] to account for the tolerance
+        double u = (wx*vy - wy*vx) / det;
+        double v = (wx*uy - wy*ux) / det;
+        double du = tolerance / p.length;
+        double dv = tolerance / q.length;
+        if(-du <= u && u <= 1+du && -dv <= v && v <= 1+dv)
+            f(std::min(1.0, std::max(0.0, u)), std::min(1.0, std::max(0.0, v)));
+    }
+    else
+    {
+        // Parallel segments: only consider endpoints touching the other
+        // segment. Overlapping parts are left as is.
+        double t;
+        if(projectOnSegment(p.ax, p.ay, q, t) <= tolerance) f(0.0, t);
+        if(projectOnSegment(p.bx, p.by, q, t) <= tolerance) f(1.0, t);
+        if(projectOnSegment(q.ax, q.ay, p, t) <= tolerance) f(t, 0.0);
+        if(projectOnSegment(q.bx, q.by, p, t) <= tolerance) f(t, 1.0);
+    }
+}
+
+}
+
+void VAC::makePlanarMap(const KeyEdgeList & edgesToIntersect, double tolerance)
+{
+    // Get edges to intersect and their sampling as segments
+    KeyEdgeList edges;
+    std::vector<double> lengths;
+    std::vector<int> numSegments;
+    std::vector<PlanarMapSegment> segments;
+    foreach(KeyEdge * edge, edgesToIntersect)
+    {
+        LinearSpline * geometry = dynamic_cast<LinearSpline *>(edge->geometry());
+        if(!geometry)
+            continue;
+
+        const SculptCurve::Curve<EdgeSample> & curve = geometry->curve();
+        int n = curve.size();
+        if(n < 2)
+            continue;
+
+        int e = edges.size();
+        edges << edge;
+        lengths.push_back(curve.arclength(n-1));
+        int numKept = 0;
+        for(int i=0; i<n-1; ++i)
+        {
+            EdgeSample a = curve[i];
+            EdgeSample b = curve[i+1];
+            PlanarMapSegment seg;
+            seg.edge = e;
+            seg.i = i;
+            seg.k = numKept;
+            seg.s = curve.arclength(i);
+            seg.length = a.distanceTo(b);
+            seg.ax = a.x(); seg.ay = a.y();
+            seg.bx = b.x(); seg.by = b.y();
+            seg.xMin = std::min(seg.ax, seg.bx) - tolerance;
+            seg.xMax = std::max(seg.ax, seg.bx) + tolerance;
+            seg.yMin = std::min(seg.ay, seg.by) - tolerance;
+            seg.yMax = std::max(seg.ay, seg.by) + tolerance;
+            if(seg.length > 1e-10)
+            {
+                segments.push_back(seg);
+                ++numKept;
+            }
+        }
+        numSegments.push_back(numKept);
+    }
+    if(segments.empty())
+        return;
+
+    // Broad phase: sweep a vertical line from left to right, keeping track of
+    // the segments it crosses ("active" segments). To avoid testing all pairs
+    // of active segments, they are bucketed in horizontal rows, whose height
+    // is a few times the average segment size. Each pair is tested only in
+    // the first row shared by both segments.
+    double yMin = segments[0].yMin;
+    double yMax = segments[0].yMax;
+    double averageSize = 0;
+    for(const PlanarMapSegment & seg: segments)
+    {
+        yMin = std::min(yMin, seg.yMin);
+        yMax = std::max(yMax, seg.yMax);
+        averageSize += (seg.xMax - seg.xMin) + (seg.yMax - seg.yMin);
+    }
+    averageSize /= segments.size();
+    const int maxRows = 1 << 16;
+    double rowHeight = std::max(4 * averageSize, (yMax - yMin) / maxRows);
+    int numRows = std::min(maxRows, static_cast<int>((yMax - yMin) / rowHeight) + 1);
+    auto rowOf = [&](double y) {
+        return std::min(numRows-1, std::max(0, static_cast<int>((y - yMin) / rowHeight)));
+    };
+    std::vector<int> order(segments.size());
+    for(size_t k=0; k<segments.size(); ++k)
+    {
+        PlanarMapSegment & seg = segments[k];
+        seg.row0 = rowOf(seg.yMin);
+        seg.row1 = rowOf(seg.yMax);
+        order[k] = static_cast<int>(k);
+    }
+    std::sort(order.begin(), order.end(), [&](int k1, int k2) {
+        return segments[k1].xMin < segments[k2].xMin; });
+
+    // Narrow phase: compute the intersections as split values on both edges.
+    // Each split value is a node of the clusters.
+    PlanarMapClusters clusters;
+    std::vector< std::vector< std::pair<double,int> > > splitValues(edges.size()); // (s, node)
+    // Note: consecutive segments are compared by their index among kept
+    // segments rather than by sample index, since two segments separated by
+    // skipped zero-length segments also share an endpoint
+    auto areAdjacent = [&](const PlanarMapSegment & p, const PlanarMapSegment & q) {
+        if(p.edge != q.edge)
+            return false;
+        int last = numSegments[p.edge] - 1;
+        return std::abs(p.k - q.k) == 1 ||
+               (edges[p.edge]->isClosed() && ((p.k == 0 && q.k == last) || (p.k == last && q.k == 0)));
+    };
+    std::vector< std::vector<int> > activeRows(numRows);
+    for(int k: order)
+    {
+        const PlanarMapSegment & p = segments[k];
+        for(int r = p.row0; r <= p.row1; ++r)
+        {
+            std::vector<int> & active = activeRows[r];
+            size_t j = 0;
+            while(j < active.size())
+            {
+                const PlanarMapSegment & q = segments[active[j]];
+                if(q.xMax < p.xMin)
+                {
+                    // Expired: remove from active segments of this row
+                    active[j] = active.back();
+                    active.pop_back();
+                    continue;
+                }
+                ++j;
+                if(r != std::max(p.row0, q.row0) || q.yMax < p.yMin || p.yMax < q.yMin || areAdjacent(p, q))
+                    continue;
+
+                intersectSegments(p, q, tolerance, [&](double u, double v) {
+                    int n1 = clusters.add();
+                    int n2 = clusters.add();
+                    clusters.unite(n1, n2);
+                    splitValues[p.edge].push_back(std::make_pair(p.s + u * p.length, n1));
+                    splitValues[q.edge].push_back(std::make_pair(q.s + v * q.length, n2));
+                });
+            }
+            active.push_back(k);
+        }
+    }
+
+    // For each edge, merge close split values, and map the ones close to the
+    // endpoints of open edges to their end vertices. Then, split the edge.
+    std::vector<KeyVertex*> vertexOfNode(clusters.size(), 0);
+    QHash<KeyVertex*, int> nodeOfVertex;
+    auto nodeOf = [&](KeyVertex * v) {
+        if(!nodeOfVertex.contains(v))
+        {
+            nodeOfVertex[v] = clusters.add();
+            vertexOfNode.push_back(v);
+        }
+        return nodeOfVertex[v];
+    };
+    for(int e=0; e<edges.size(); ++e)
+    {
+        std::vector< std::pair<double,int> > & values = splitValues[e];
+        if(values.empty())
+            continue;
+        std::sort(values.begin(), values.end());
+
+        KeyEdge * edge = edges[e];
+        double l = lengths[e];
+        bool isClosed = edge->isClosed();
+
+        // Group split values closer than tolerance. groups[g] is the node
+        // representing the group, and groupValues[g] the split value.
+        std::vector<int> groups;
+        std::vector<double> groupValues;
+        for(const auto & value: values)
+        {
+            double s = value.first;
+            int node = value.second;
+            if(!isClosed && s <= tolerance)
+                clusters.unite(node, nodeOf(edge->startVertex()));
+            else if(!isClosed && s >= l - tolerance)
+                clusters.unite(node, nodeOf(edge->endVertex()));
+            else if(!groups.empty() && s - groupValues.back() <= tolerance)
+                clusters.unite(node, groups.back());
+            else
+            {
+                groups.push_back(node);
+                groupValues.push_back(s);
+            }
+        }
+        if(isClosed && groups.size() > 1 && groupValues.front() + l - groupValues.back() <= tolerance)
+        {
+            clusters.unite(groups.front(), groups.back());
+            groups.pop_back();
+            groupValues.pop_back();
+        }
+        if(groups.empty())
+            continue;
+
+        // Split edge
+        std::vector<double> cutValues;
+        if(!isClosed)
+            cutValues.push_back(0);
+        cutValues.insert(cutValues.end(), groupValues.begin(), groupValues.end());
+        cutValues.push_back(isClosed ? groupValues.front() + l : l);
+        SplitInfo info = cutEdgeAtVertices_(edge, cutValues);
+        for(size_t g=0; g<groups.size() && g<static_cast<size_t>(info.newVertices.size()); ++g)
+            vertexOfNode[groups[g]] = info.newVertices[g];
+    }
+
+    // Glue all vertices of each cluster together
+    std::vector< std::vector<KeyVertex*> > verticesOfCluster(clusters.size());
+    for(int node=0; node<clusters.size(); ++node)
+    {
+        if(vertexOfNode[node])
+            verticesOfCluster[clusters.find(node)].push_back(vertexOfNode[node]);
+    }
+    for(const std::vector<KeyVertex*> & vertices: verticesOfCluster)
+    {
+        KeyVertex * v = vertices.empty() ? 0 : vertices[0];
+        for(size_t k=1; k<vertices.size() && v; ++k)
+            v = glue_(v, vertices[k]);
+    }
+}
+
 ///////////////////////////////////////////////////////////////////////////
 ////////////////////               GLUING               ///////////////////
 
@@ -2260,14 +3066,14 @@ VAC::SplitInfo VAC::cutEdgeAtVertices_(KeyEdge * edgeToSplit, const std::vector<
     }
     */
 
-void VAC::glue_(KeyVertex * v1, KeyVertex * v2)
+KeyVertex * VAC::glue_(KeyVertex * v1, KeyVertex * v2)
 {
     // make sure they have same time
     if(v1->time() != v2->time())
     {
         QMessageBox::information(0, QObject::tr("operation aborted"),
                                  QObject::tr("you can't glue two vertices not sharing the same time."));
-        return;
+        return 0;
     }
 
     // create new vertex
@@ -2321,6 +3127,8 @@ void VAC::glue_(KeyVertex * v1, KeyVertex * v2)
     // delete glued vertices
     deleteCell(v1);
     deleteCell(v2);
+
+    return v3;
 }
 
 namespace
@@ -2545,8 +3353,7 @@ void VAC::unglue_(KeyVertex * v)
                 if(f->cycles_[i].vertex_ == v) // Steiner vertex
                 {
                     // Create new vertex
-                    KeyVertex * vNew = newKeyVertex(v->time());
-                    vNew->pos_ = v->pos();
+                    KeyVertex * vNew = newKeyVertex(v->time(), v->pos());
 
                     // Use it instead of original one
                     f->cycles_[i].vertex_ = vNew;
@@ -2559,8 +3366,7 @@ void VAC::unglue_(KeyVertex * v)
                     if(f->cycles_[i][j].startVertex() == v)
                     {
                         // Create new vertex
-                        KeyVertex * vNew = newKeyVertex(v->time());
-                        vNew->pos_ = v->pos();
+                        KeyVertex * vNew = newKeyVertex(v->time(), v->pos());
 
                         // Use it instead of original one
                         // The bracket here do "f->something_ = vNew" (done indirectly via the halfedges)
@@ -2618,8 +3424,7 @@ void VAC::unglue_(KeyVertex * v)
                 if(e->startVertex() == v)
                 {
                     // Create new vertex
-                    KeyVertex * vNew = newKeyVertex(v->time());
-                    vNew->pos_ = v->pos();
+                    KeyVertex * vNew = newKeyVertex(v->time(), v->pos());
 
                     // Use it instead of original one
                     e->startVertex_ = vNew;
@@ -2629,8 +3434,7 @@ void VAC::unglue_(KeyVertex * v)
                 if(e->endVertex() == v)
                 {
                     // Create new vertex
-                    KeyVertex * vNew = newKeyVertex(v->time());
-                    vNew->pos_ = v->pos();
+                    KeyVertex * vNew = newKeyVertex(v->time(), v->pos());
 
                     // Use it instead of original one
                     e->endVertex_ = vNew;
@@ -2698,8 +3502,116 @@ void VAC::unglue_(KeyEdge * e)
     }
 }
 
-bool VAC::uncut_(KeyVertex * v)
+namespace
+{
+
+// Returns the geometry of the edge replacing e1 and e2 when uncutting at
+// their common vertex v, that is, the concatenation h1 -> v -> h2. This only
+// reads e1 and e2, so it is safe to call from worker threads as long as the
+// VAC is not modified meanwhile.
+LinearSpline * uncutGeometry(KeyVertex * v, KeyEdge * e1, KeyEdge * e2)
+{
+    bool side1 = (e1->endVertex() == v);
+    bool side2 = (e2->startVertex() == v);
+    SculptCurve::Curve<EdgeSample> & g1 = static_cast<LinearSpline*>(e1->geometry())->curve();
+    SculptCurve::Curve<EdgeSample> & g2 = static_cast<LinearSpline*>(e2->geometry())->curve();
+    std::vector<EdgeSample,Eigen::aligned_allocator<EdgeSample> > g3Vertices;
+    int n1 = g1.size();
+    int n2 = g2.size();
+    g3Vertices.reserve(n1 + n2);
+    if(side1)
+    {
+        for(int i=0; i<n1; ++i)
+            g3Vertices << g1[i];
+    }
+    else
+    {
+        for(int i=n1-1; i>=0; --i)
+            g3Vertices << g1[i];
+    }
+    if(side2)
+    {
+        for(int i=1; i<n2; ++i)
+            g3Vertices << g2[i];
+    }
+    else
+    {
+        for(int i=n2-2; i>=0; --i)
+            g3Vertices << g2[i];
+    }
+    SculptCurve::Curve<EdgeSample> g3;
+    g3.setVertices(std::move(g3Vertices));
+    return new LinearSpline(g3, false);
+}
+
+// Returns whether v is a key vertex with exactly two incident key edges,
+// none of them a loop, and no incident inbetween cells. If so, sets e1 and
+// e2 to these edges, in increasing ID order, as in VAC::uncut_(v).
+bool isUncutBetweenTwoEdgesCandidate(KeyVertex * v, KeyEdge * & e1, KeyEdge * & e2)
+{
+    if(!v->temporalStarBeforeCells().isEmpty() || !v->temporalStarAfterCells().isEmpty())
+        return false;
+
+    int numIncidentEdges = 0;
+    for(Cell * c: v->spatialStarCells())
+    {
+        if(KeyEdge * e = c->toKeyEdge())
+        {
+            ++numIncidentEdges;
+            if(numIncidentEdges == 1)
+                e1 = e;
+            else if(numIncidentEdges == 2)
+                e2 = e;
+            else
+                return false;
+        }
+    }
+    if(numIncidentEdges != 2)
+        return false;
+
+    if( (e1->startVertex() == e1->endVertex()) || (e2->startVertex() == e2->endVertex()))
+        return false;
+
+    if(e2->id() < e1->id())
+        std::swap(e1, e2);
+    return true;
+}
+
+// Uncutting at a vertex between two edges, as computed by simplifyAll()
+struct UncutJob
+{
+    KeyVertex * vertex;
+    KeyEdge * e1;
+    KeyEdge * e2;
+    LinearSpline * geometry;
+};
+
+class UncutGeometryTask: public QRunnable
+{
+public:
+    UncutGeometryTask(UncutJob * begin, UncutJob * end) :
+        begin_(begin), end_(end)
+    {
+    }
+
+    void run() override
+    {
+        for(UncutJob * job = begin_; job != end_; ++job)
+            job->geometry = uncutGeometry(job->vertex, job->e1, job->e2);
+    }
+
+private:
+    UncutJob * begin_;
+    UncutJob * end_;
+};
+
+}
+
+bool VAC::uncut_(KeyVertex * v, LinearSpline * geometry)
 {
+    // Deleted if unused
+    std::unique_ptr<LinearSpline> geometryOwner(geometry);
+
     // Note: Uncut does not yet support incident inbetween cells. As a
     // workaround, we do nothing, as if uncutting here isn't possible, even
     // though maybe in theory it is. In the future, we should handle the cases
@@ -2789,6 +3701,11 @@ bool VAC::uncut_(KeyVertex * v)
             //qDebug() << "Uncut abort: more than two incident edges";
             return false;
         }
+
+        // Deterministic order, so that the new geometry can be computed
+        // beforehand, see simplifyAll()
+        if(e2->id() < e1->id())
+            std::swap(e1, e2);
     }
     else
     {
@@ -2893,35 +3810,8 @@ bool VAC::uncut_(KeyVertex * v)
         // create equivalent edge/halfedge
         // [... ; h = (e,true) ; ...]  <=>  [...;h1;h2;...]
 
-        // compute new geometry
-        SculptCurve::Curve<EdgeSample> & g1 = static_cast<LinearSpline*>(e1->geometry())->curve();
-        SculptCurve::Curve<EdgeSample> & g2 = static_cast<LinearSpline*>(e2->geometry())->curve();
-        std::vector<EdgeSample,Eigen::aligned_allocator<EdgeSample> > g3Vertices;
-        int n1 = g1.size();
-        int n2 = g2.size();
-        if(h1.side)
-        {
-            for(int i=0; i<n1; ++i)
-                g3Vertices << g1[i];
-        }
-        else
-        {
-            for(int i=n1-1; i>=0; --i)
-                g3Vertices << g1[i];
-        }
-        if(h2.side)
-        {
-            for(int i=1; i<n2; ++i)
-                g3Vertices << g2[i];
-        }
-        else
-        {
-            for(int i=n2-2; i>=0; --i)
-                g3Vertices << g2[i];
-        }
-        SculptCurve::Curve<EdgeSample> g3;
-        g3.setVertices(g3Vertices);
-        LinearSpline * ls3 = new LinearSpline(g3, false);
+        // compute new geometry, unless already computed
+        LinearSpline * ls3 = geometry ? geometryOwner.release() : uncutGeometry(v, e1, e2);
 
         // create new edge
         KeyEdge * e = newKeyEdge(v->time(), h1.startVertex(), h2.endVertex(), ls3);
@@ -3377,6 +4267,10 @@ void VAC::insertSketchedEdgeInVAC()
 
 void VAC::insertSketchedEdgeInVAC(double tolerance, bool useFaceToConsiderForCutting)
 {
+    // Many edges may be cut and many faces updated: invalidate their cached
+    // geometry only once at the end
+    beginTransaction();
+
     // --------------------------------------------------------------------
     // ---------------------- Input Variables -----------------------------
     // --------------------------------------------------------------------
@@ -3720,9 +4614,18 @@ void VAC::insertSketchedEdgeInVAC(double tolerance, bool useFaceToConsiderForCut
     {
         EdgeSample startVertex = sketchedEdge_->curve().start();
         EdgeSample endVertex = sketchedEdge_->curve().end();
-        foreach(KeyVertex * v, instantVertices(timeInteractivity_))
-        {
-            // todo: be careful!! Potentially add several times the same node here!!!
+        PointIndex & keyVertexIndex = keyVertexIndex_(timeInteractivity_);
+        std::vector<int> ids;
+        keyVertexIndex.query(startVertex.x(), startVertex.y(), tolerance, ids);
+        keyVertexIndex.query(endVertex.x(), endVertex.y(), tolerance, ids);
+
+        // Vertices close to both end nodes are reported twice. Sorting by ID
+        // also preserves the order in which vertices used to be considered.
+        std::sort(ids.begin(), ids.end());
+        ids.erase(std::unique(ids.begin(), ids.end()), ids.end());
+        foreach(int id, ids)
+        {
+            KeyVertex * v = getKeyVertex(id);
             EdgeSample sv = startVertex;
             sv.setX(v->pos()[0]);
             sv.setY(v->pos()[1]);
@@ -3736,11 +4639,8 @@ void VAC::insertSketchedEdgeInVAC(double tolerance, bool useFaceToConsiderForCut
                 sv = endVertex;
                 sv.setX(v->pos()[0]);
                 sv.setY(v->pos()[1]);
-                if(sv.distanceTo(endVertex) < tolerance)
-                {
-                    splitNodes.existing << sv;
-                    splitNodes.existingNodes << v;
-                }
+                splitNodes.existing << sv;
+                splitNodes.existingNodes << v;
             }
         }
     }
@@ -4113,6 +5013,8 @@ void VAC::insertSketchedEdgeInVAC(double tolerance, bool useFaceToConsiderForCut
             }
         }
     }
+
+    endTransaction();
 }
 
 // --------------------- Sculpting ------------------------
@@ -4121,11 +5023,29 @@ void VAC::updateSculpt(double x, double y, Time time)
 {
     double radius = global()->sculptRadius();
     timeInteractivity_ = time;
-    KeyEdgeList iedges = instantEdges(timeInteractivity_);
+    updateSculptIndex_(timeInteractivity_);
+
+    // Only edges with a sample in this rectangle can be within the radius.
+    // Candidates are sorted by ID so that ties are resolved as before.
+    BoundingBox bb(x-radius, x+radius, y-radius, y+radius);
+    std::vector<int> ids;
+    sculptIndex_.query(bb, ids);
+    foreach(int id, sculptIndexChangedEdges_)
+        ids.push_back(id);
+    std::sort(ids.begin(), ids.end());
+    ids.erase(std::unique(ids.begin(), ids.end()), ids.end());
+
     double minD = std::numeric_limits<double>::max();
     sculptedEdge_ = 0;
-    foreach(KeyEdge * iedge, iedges)
+    foreach(int id, ids)
     {
+        KeyEdge * iedge = getKeyEdge(id);
+        if(!iedge || !iedge->exists(timeInteractivity_) ||
+           !iedge->outlineBoundingBox(timeInteractivity_).intersects(bb))
+        {
+            continue;
+        }
+
         double d = iedge->updateSculpt(x, y, radius);
         if(d<radius && d<minD)
         {
@@ -4158,7 +5078,7 @@ void VAC::endSculptDeform()
     {
         sculptedEdge_->endSculptDeform();
         //emit changed(); // done manually by View, after calling updatePicking(newX, newY)
-        emit checkpoint();
+        emitCheckpoint_();
     }
 }
 
@@ -4185,7 +5105,7 @@ void VAC::endSculptEdgeWidth()
     {
         sculptedEdge_->endSculptEdgeWidth();
         //emit changed(); // done manually by View, after calling updatePicking(newX, newY)
-        emit checkpoint();
+        emitCheckpoint_();
     }
 }
 
@@ -4217,7 +5137,7 @@ void VAC::endSculptSmooth()
     {
         sculptedEdge_->endSculptSmooth();
         //emit changed(); // done manually by View, after calling updatePicking(newX, newY)
-        emit checkpoint();
+        emitCheckpoint_();
     }
 }
 
@@ -4633,9 +5553,9 @@ void VAC::inbetweenSelection()
     }
 
     deselectAll();
-    emit needUpdatePicking();
-    emit changed();
-    emit checkpoint();
+    emitNeedUpdatePicking_();
+    emitChanged_();
+    emitCheckpoint_();
 }
 
 void VAC::keyframeSelection()
@@ -4643,9 +5563,9 @@ void VAC::keyframeSelection()
     keyframe_(selectedCells(), global()->activeTime());
     deselectAll();
 
-    emit needUpdatePicking();
-    emit changed();
-    emit checkpoint();
+    emitNeedUpdatePicking_();
+    emitChanged_();
+    emitCheckpoint_();
 }
 
 class KeyframeHelper
@@ -5238,9 +6158,9 @@ void VAC::createFace()
     {
         newKeyFace(cycles);
 
-        emit needUpdatePicking();
-        emit changed();
-        emit checkpoint();
+        emitNeedUpdatePicking_();
+        emitChanged_();
+        emitCheckpoint_();
     }
 }
 
@@ -5269,9 +6189,9 @@ void VAC::addCyclesToFace()
         foreach(KeyFace * face, faceSet)
             face->addCycles(cycles);
 
-        emit needUpdatePicking();
-        emit changed();
-        emit checkpoint();
+        emitNeedUpdatePicking_();
+        emitChanged_();
+        emitCheckpoint_();
     }
 }
 
@@ -5317,9 +6237,9 @@ void VAC::removeCyclesFromFace()
         }
     }
 
-    emit needUpdatePicking();
-    emit changed();
-    emit checkpoint();
+    emitNeedUpdatePicking_();
+    emitChanged_();
+    emitCheckpoint_();
 
 }
 
@@ -5338,8 +6258,8 @@ void VAC::changeColor()
         }
 
         //emit needUpdatePicking();
-        emit changed();
-        emit checkpoint();
+        emitChanged_();
+        emitCheckpoint_();
     }
 }
 
@@ -5349,9 +6269,9 @@ void VAC::raise()
     {
         zOrdering_.raise(selectedCells());
 
-        emit needUpdatePicking();
-        emit changed();
-        emit checkpoint();
+        emitNeedUpdatePicking_();
+        emitChanged_();
+        emitCheckpoint_();
     }
 }
 
@@ -5361,9 +6281,9 @@ void VAC::lower()
     {
         zOrdering_.lower(selectedCells());
 
-        emit needUpdatePicking();
-        emit changed();
-        emit checkpoint();
+        emitNeedUpdatePicking_();
+        emitChanged_();
+        emitCheckpoint_();
     }
 }
 
@@ -5373,9 +6293,9 @@ void VAC::raiseToTop()
     {
         zOrdering_.raiseToTop(selectedCells());
 
-        emit needUpdatePicking();
-        emit changed();
-        emit checkpoint();
+        emitNeedUpdatePicking_();
+        emitChanged_();
+        emitCheckpoint_();
     }
 }
 
@@ -5385,9 +6305,9 @@ void VAC::lowerToBottom()
     {
         zOrdering_.lowerToBottom(selectedCells());
 
-        emit needUpdatePicking();
-        emit changed();
-        emit checkpoint();
+        emitNeedUpdatePicking_();
+        emitChanged_();
+        emitCheckpoint_();
     }
 }
 
@@ -5398,9 +6318,9 @@ void VAC::altRaise()
     {
         zOrdering_.altRaise(selectedCells());
 
-        emit needUpdatePicking();
-        emit changed();
-        emit checkpoint();
+        emitNeedUpdatePicking_();
+        emitChanged_();
+        emitCheckpoint_();
     }
 }
 
@@ -5410,9 +6330,9 @@ void VAC::altLower()
     {
         zOrdering_.altLower(selectedCells());
 
-        emit needUpdatePicking();
-        emit changed();
-        emit checkpoint();
+        emitNeedUpdatePicking_();
+        emitChanged_();
+        emitCheckpoint_();
     }
 }
 
@@ -5422,9 +6342,9 @@ void VAC::altRaiseToTop()
     {
         zOrdering_.altRaiseToTop(selectedCells());
 
-        emit needUpdatePicking();
-        emit changed();
-        emit checkpoint();
+        emitNeedUpdatePicking_();
+        emitChanged_();
+        emitCheckpoint_();
     }
 }
 
@@ -5434,9 +6354,9 @@ void VAC::altLowerToBottom()
     {
         zOrdering_.altLowerToBottom(selectedCells());
 
-        emit needUpdatePicking();
-        emit changed();
-        emit checkpoint();
+        emitNeedUpdatePicking_();
+        emitChanged_();
+        emitCheckpoint_();
     }
 }
 
@@ -5457,9 +6377,9 @@ void VAC::changeEdgeWidth()
 
         }
 
-        emit needUpdatePicking();
-        emit changed();
-        emit checkpoint();
+        emitNeedUpdatePicking_();
+        emitChanged_();
+        emitCheckpoint_();
     }
 }
 
@@ -5486,9 +6406,9 @@ void VAC::glue()
         return;
     }
 
-    emit needUpdatePicking();
-    emit changed();
-    emit checkpoint();
+    emitNeedUpdatePicking_();
+    emitChanged_();
+    emitCheckpoint_();
 }
 
 void VAC::unglue()
@@ -5501,9 +6421,9 @@ void VAC::unglue()
     foreach(KeyVertex * ivertex, vertexSet)
         unglue_(ivertex);
 
-    emit needUpdatePicking();
-    emit changed();
-    emit checkpoint();
+    emitNeedUpdatePicking_();
+    emitChanged_();
+    emitCheckpoint_();
 }
 
 void VAC::uncut()
@@ -5522,10 +6442,108 @@ void VAC::uncut()
     {
         deselectAll();
 
-        emit needUpdatePicking();
-        emit changed();
-        emit checkpoint();
+        emitNeedUpdatePicking_();
+        emitChanged_();
+        emitCheckpoint_();
+    }
+}
+
+void VAC::simplifyAll()
+{
+    QElapsedTimer timer;
+    timer.start();
+    int numCellsBefore = cells_.size();
+
+    beginTransaction();
+
+    // Vertices between two edges are the vast majority of removable vertices
+    // in traced or imported drawings. Uncutting at such a vertex doesn't
+    // change whether other vertices are candidates, so we only collect
+    // candidates once. Note: ID order makes the result deterministic.
+    QVector<int> candidates;
+    foreach(KeyVertex * v, instantVertices())
+    {
+        KeyEdge * e1;
+        KeyEdge * e2;
+        if(isUncutBetweenTwoEdgesCandidate(v, e1, e2))
+            candidates << v->id();
+    }
+
+    // Proceed by rounds. At each round, we select candidates that don't share
+    // any edge, so that uncutting at one of them doesn't affect the others.
+    // Their new geometry is then computed in parallel, and the topological
+    // changes are done sequentially. In a chain of vertices between two
+    // edges, each round removes every other vertex.
+    QThreadPool threadPool;
+    std::vector<UncutJob> jobs;
+    CellBitSet usedEdges;
+    while(!candidates.isEmpty())
+    {
+        QVector<int> remainingCandidates;
+        jobs.clear();
+        usedEdges.clear();
+        foreach(int id, candidates)
+        {
+            KeyVertex * v = getKeyVertex(id);
+            KeyEdge * e1;
+            KeyEdge * e2;
+            if(v && isUncutBetweenTwoEdgesCandidate(v, e1, e2))
+            {
+                if(usedEdges.contains(e1->id()) || usedEdges.contains(e2->id()))
+                {
+                    remainingCandidates << id;
+                }
+                else
+                {
+                    usedEdges.insert(e1->id());
+                    usedEdges.insert(e2->id());
+                    UncutJob job = {v, e1, e2, 0};
+                    jobs.push_back(job);
+                }
+            }
+        }
+
+        // Compute new geometries, by chunks large enough to amortize the
+        // synchronization
+        const int minChunkSize = 64;
+        int numJobs = static_cast<int>(jobs.size());
+        int numChunks = std::min(4 * threadPool.maxThreadCount(), numJobs / minChunkSize);
+        if(numChunks > 1)
+        {
+            for(int i=0; i<numChunks; ++i)
+            {
+                UncutJob * begin = jobs.data() + static_cast<long long>(numJobs) * i / numChunks;
+                UncutJob * end = jobs.data() + static_cast<long long>(numJobs) * (i+1) / numChunks;
+                threadPool.start(new UncutGeometryTask(begin, end));
+            }
+            threadPool.waitForDone();
+        }
+        else
+        {
+            UncutGeometryTask(jobs.data(), jobs.data() + numJobs).run();
+        }
+
+        // Uncut. This may still fail because of incident faces, in which case
+        // the geometry is discarded, and the vertex is not considered again.
+        for(UncutJob & job: jobs)
+            uncut_(job.vertex, job.geometry);
+
+        candidates.swap(remainingCandidates);
+    }
+
+    int numRemovedCells = numCellsBefore - cells_.size();
+    if(numRemovedCells > 0)
+    {
+        emitNeedUpdatePicking_();
+        emitChanged_();
+        emitCheckpoint_();
     }
+
+    endTransaction();
+
+    global()->mainWindow()->statusBar()->showMessage(
+                tr("Simplify all: %1 cells removed in %2 ms")
+                .arg(numRemovedCells).arg(timer.elapsed()));
 }
 
 void VAC::cut(VAC* & clipboard)
@@ -5541,9 +6559,9 @@ void VAC::cut(VAC* & clipboard)
 
     smartDelete_(selectedCells());
 
-    emit needUpdatePicking();
-    emit changed();
-    emit checkpoint();
+    emitNeedUpdatePicking_();
+    emitChanged_();
+    emitCheckpoint_();
 }
 
 void VAC::copy(VAC* & clipboard)
@@ -5582,9 +6600,9 @@ void VAC::paste(VAC *& clipboard)
     // Delete clone
     delete cloneOfClipboard;
 
-    emit needUpdatePicking();
-    emit changed();
-    emit checkpoint();
+    emitNeedUpdatePicking_();
+    emitChanged_();
+    emitCheckpoint_();
 }
 
 void VAC::motionPaste(VAC* & clipboard)
@@ -5768,9 +6786,9 @@ void VAC::motionPaste(VAC* & clipboard)
     delete cloneOfClipboard;
 
     informTimelineOfSelection();
-    emit needUpdatePicking();
-    emit changed();
-    emit checkpoint();
+    emitNeedUpdatePicking_();
+    emitChanged_();
+    emitCheckpoint_();
 
 }
 
@@ -5824,19 +6842,18 @@ void VAC::informTimelineOfSelection()
     double t1 = 0;
     double t2 = 0;
 
-    foreach(Cell * cell, selectedCells_)
+    if(numSelectedCells(KeyTypes) > 0)
     {
-        KeyCell * keyCell = cell->toKeyCell();
-        InbetweenCell * inbetweenCell = cell->toInbetweenCell();
-        if(keyCell)
-        {
-            if(selectionType != 1)
-            {
-                selectionType = 1;
-                t = keyCell->time().floatTime();
-                t1 = std::numeric_limits<double>::lowest(); // = -max
-                t2 = std::numeric_limits<double>::max();
-            }
+        // Inbetween cells are ignored if there are key cells
+        selectionType = 1;
+        CellBitSet keyCellIds = selectedIds_;
+        keyCellIds.intersect(cellIds_(KeyTypes));
+        t = cells_.value(keyCellIds.first())->toKeyCell()->time().floatTime();
+        t1 = std::numeric_limits<double>::lowest(); // = -max
+        t2 = std::numeric_limits<double>::max();
+
+        keyCellIds.forEach([&](int id) {
+            KeyCell * keyCell = cells_.value(id)->toKeyCell();
 
             InbetweenCellSet beforeCells = keyCell->temporalStarBefore();
             foreach(InbetweenCell * scell, beforeCells)
@@ -5851,14 +6868,15 @@ void VAC::informTimelineOfSelection()
                 double tafter = scell->afterTime().floatTime();
                 t2 = std::min(tafter,t2);
             }
-        }
-        else if(inbetweenCell && (selectionType!=1) )
-        {
-            selectionType = 2;
-            t1 = inbetweenCell->beforeTime().floatTime();
-            t2 = inbetweenCell->afterTime().floatTime();
-            break; // i.e., ignore further cells
-        }
+        });
+    }
+    else if(numSelectedCells(InbetweenTypes) > 0)
+    {
+        // Only consider one inbetween cell
+        selectionType = 2;
+        InbetweenCell * inbetweenCell = cells_.value(selectedIds_.first())->toInbetweenCell();
+        t1 = inbetweenCell->beforeTime().floatTime();
+        t2 = inbetweenCell->afterTime().floatTime();
     }
 
     if(selectionType == 1)
@@ -5878,28 +6896,32 @@ void VAC::informTimelineOfSelection()
 
 void VAC::addToSelection(Cell * cell, bool emitSignal)
 {
-    if(cell && !cell->isSelected())
+    if(cell && checkContains(cell) && selectedIds_.insert(cell->id()))
     {
-        selectedCells_ << cell;
         cell->setSelected(true);
+        ++numSelectedCells_[cellTypeIndex_(cell)];
+        if(!selectedCellsDirty_)
+            selectedCells_ << cell;
         emitSelectionChanged_();
         if(emitSignal)
         {
-            emit changed();
+            emitChanged_();
         }
     }
 }
 
 void VAC::removeFromSelection(Cell * cell, bool emitSignal)
 {
-    if(cell && cell->isSelected())
+    if(cell && selectedIds_.remove(cell->id()))
     {
-        selectedCells_.remove(cell);
         cell->setSelected(false);
+        --numSelectedCells_[cellTypeIndex_(cell)];
+        if(!selectedCellsDirty_)
+            selectedCells_.remove(cell);
         emitSelectionChanged_();
         if(emitSignal)
         {
-            emit changed();
+            emitChanged_();
         }
     }
 }
@@ -5917,41 +6939,45 @@ void VAC::toggleSelection(Cell * cell, bool emitSignal)
 
 void VAC::addToSelection(const CellSet & cells, bool emitSignal)
 {
-    beginAggregateSignals_();
+    CellBitSet ids = selectedIds_;
     foreach(Cell * c, cells)
-        addToSelection(c, false);
-    endAggregateSignals_();
+        if(checkContains(c))
+            ids.insert(c->id());
+    setSelectedIds_(ids, false);
 
     if(emitSignal)
     {
-        emit changed();
+        emitChanged_();
     }
 }
 
 void VAC::removeFromSelection(const CellSet & cells, bool emitSignal)
 {
-    beginAggregateSignals_();
+    CellBitSet ids = selectedIds_;
     foreach(Cell * c, cells)
-        removeFromSelection(c, false);
-    endAggregateSignals_();
+        if(checkContains(c))
+            ids.remove(c->id());
+    setSelectedIds_(ids, false);
 
     if(emitSignal)
     {
-        emit changed();
+        emitChanged_();
     }
 }
 
 
 void VAC::toggleSelection(const CellSet & cells, bool emitSignal)
 {
-    beginAggregateSignals_();
+    CellBitSet ids;
     foreach(Cell * c, cells)
-        toggleSelection(c, false);
-    endAggregateSignals_();
+        if(checkContains(c))
+            ids.insert(c->id());
+    ids.toggle(selectedIds_);
+    setSelectedIds_(ids, false);
 
     if(emitSignal)
     {
-        emit changed();
+        emitChanged_();
     }
 }
 
@@ -5967,53 +6993,73 @@ void VAC::setSelectedCell(Cell * cell, bool emitSignal)
 
 void VAC::setSelectedCells(const CellSet & cells, bool emitSignal)
 {
-    bool changing = false;
+    CellBitSet ids;
+    foreach(Cell * c, cells)
+        if(checkContains(c))
+            ids.insert(c->id());
+
+    // Reuse the given set rather than rebuilding it from IDs later, which
+    // is possible unless it contains cells not in this VAC
+    setSelectedIds_(ids, emitSignal, ids.count() == cells.size() ? &cells : 0);
+}
+
+void VAC::setSelectedIds_(const CellBitSet & ids, bool emitSignal, const CellSet * cells)
+{
+    CellBitSet changedIds = selectedIds_;
+    changedIds.toggle(ids);
+    if(changedIds.isEmpty())
+        return;
 
-    // Detect if any new cell is added to the selection, and set
-    // all new cells as unselected.
-    foreach(Cell * cell, cells)
+    selectedIds_ = ids;
+    changedIds.forEach([this](int id) {
+        cells_.value(id)->setSelected(selectedIds_.contains(id));
+    });
+    updateNumSelectedCells_();
+    if(cells)
     {
-        if (cell->isSelected())
-        {
-            cell->setSelected(false);
-        }
-        else
-        {
-            changing = true;
-        }
+        selectedCells_ = *cells;
+        selectedCellsDirty_ = false;
     }
-
-    // Detect if any cell is removed from the selection, and set
-    // all old cells as unselected.
-    // This works due to the previous step: any cell in selectedCells_
-    // which is still selected is *not* in the new cells.
-    foreach(Cell * cell, selectedCells_)
+    else
     {
-        if (cell->isSelected())
-        {
-            changing = true;
-            cell->setSelected(false);
-        }
+        selectedCellsDirty_ = true;
     }
 
-    // Set new cells as selected
-    foreach(Cell * cell, cells)
-        cell->setSelected(true);
-    selectedCells_ = cells;
-
-    if (changing)
+    emitSelectionChanged_();
+    if(emitSignal)
     {
-        emitSelectionChanged_();
-        if(emitSignal)
-        {
-            emit changed();
-        }
+        emitChanged_();
     }
 }
 
+void VAC::updateNumSelectedCells_()
+{
+    for(int i=0; i<NumCellTypes; ++i)
+        numSelectedCells_[i] = selectedIds_.intersectionCount(cellIdsByType_[i]);
+}
+
+void VAC::keepSelectedCells_(int types, bool emitSignal)
+{
+    CellBitSet ids = selectedIds_;
+    ids.intersect(cellIds_(types));
+    setSelectedIds_(ids, emitSignal);
+}
+
+void VAC::discardSelectedCells_(int types, bool emitSignal)
+{
+    CellBitSet ids = selectedIds_;
+    ids.subtract(cellIds_(types));
+    setSelectedIds_(ids, emitSignal);
+}
+
 void VAC::selectAll(bool emitSignal)
 {
-    addToSelection(cells(), emitSignal);
+    setSelectedIds_(cellIds_(AllTypes), false);
+
+    if(emitSignal)
+    {
+        emitChanged_();
+    }
 }
 
 void VAC::selectAllAtTime(Time time, bool emitSignal)
@@ -6023,232 +7069,140 @@ void VAC::selectAllAtTime(Time time, bool emitSignal)
 
 void VAC::selectConnected(bool emitSignal)
 {
-    addToSelection(Algorithms::connected(selectedCells()), emitSignal);
+    CellList cells;
+    Algorithms::connected(selectedCells(), cells);
+    addToSelection_(cells, emitSignal);
 }
 
 void VAC::selectClosure(bool emitSignal)
 {
-    addToSelection(Algorithms::closure(selectedCells()), emitSignal);
+    CellList cells;
+    Algorithms::closure(selectedCells(), cells);
+    addToSelection_(cells, emitSignal);
 }
 
-void VAC::selectVertices(bool emitSignal)
+void VAC::addToSelection_(const CellList & cells, bool emitSignal)
 {
-    CellSet cellsToSelect;
-    foreach(Cell * c, selectedCells())
-        if(c->toVertexCell())
-            cellsToSelect.insert(c);
+    // Note: unlike addToSelection(), we know that all the cells are in the VAC
+    CellBitSet ids = selectedIds_;
+    foreach(Cell * c, cells)
+        ids.insert(c->id());
+    setSelectedIds_(ids, false);
 
-    setSelectedCells(cellsToSelect,emitSignal);
+    if(emitSignal)
+    {
+        emitChanged_();
+    }
 }
 
-void VAC::selectEdges(bool emitSignal)
+void VAC::selectVertices(bool emitSignal)
 {
-    CellSet cellsToSelect;
-    foreach(Cell * c, selectedCells())
-        if(c->toEdgeCell())
-            cellsToSelect.insert(c);
+    keepSelectedCells_(VertexTypes, emitSignal);
+}
 
-    setSelectedCells(cellsToSelect,emitSignal);
+void VAC::selectEdges(bool emitSignal)
+{
+    keepSelectedCells_(EdgeTypes, emitSignal);
 }
 
 void VAC::selectFaces(bool emitSignal)
 {
-    CellSet cellsToSelect;
-    foreach(Cell * c, selectedCells())
-        if(c->toFaceCell())
-            cellsToSelect.insert(c);
-
-    setSelectedCells(cellsToSelect,emitSignal);
+    keepSelectedCells_(FaceTypes, emitSignal);
 }
 
 void VAC::deselectVertices(bool emitSignal)
 {
-    CellSet cellsToSelect;
-    foreach(Cell * c, selectedCells())
-        if(!c->toVertexCell())
-            cellsToSelect.insert(c);
-
-    setSelectedCells(cellsToSelect,emitSignal);
+    discardSelectedCells_(VertexTypes, emitSignal);
 }
 
 void VAC::deselectEdges(bool emitSignal)
 {
-    CellSet cellsToSelect;
-    foreach(Cell * c, selectedCells())
-        if(!c->toEdgeCell())
-            cellsToSelect.insert(c);
-
-    setSelectedCells(cellsToSelect,emitSignal);
+    discardSelectedCells_(EdgeTypes, emitSignal);
 }
 
 void VAC::deselectFaces(bool emitSignal)
 {
-    CellSet cellsToSelect;
-    foreach(Cell * c, selectedCells())
-        if(!c->toFaceCell())
-            cellsToSelect.insert(c);
-
-    setSelectedCells(cellsToSelect,emitSignal);
+    discardSelectedCells_(FaceTypes, emitSignal);
 }
 
 void VAC::selectKeyCells(bool emitSignal)
 {
-    CellSet cellsToSelect;
-    foreach(Cell * c, selectedCells())
-        if(c->toKeyCell())
-            cellsToSelect.insert(c);
-
-    setSelectedCells(cellsToSelect,emitSignal);
+    keepSelectedCells_(KeyTypes, emitSignal);
 }
 
 void VAC::selectInbetweenCells(bool emitSignal)
 {
-    CellSet cellsToSelect;
-    foreach(Cell * c, selectedCells())
-        if(c->toInbetweenCell())
-            cellsToSelect.insert(c);
-
-    setSelectedCells(cellsToSelect,emitSignal);
+    keepSelectedCells_(InbetweenTypes, emitSignal);
 }
 
 void VAC::deselectKeyCells(bool emitSignal)
 {
-    CellSet cellsToSelect;
-    foreach(Cell * c, selectedCells())
-        if(!c->toKeyCell())
-            cellsToSelect.insert(c);
-
-    setSelectedCells(cellsToSelect,emitSignal);
+    discardSelectedCells_(KeyTypes, emitSignal);
 }
 
 void VAC::deselectInbetweenCells(bool emitSignal)
 {
-    CellSet cellsToSelect;
-    foreach(Cell * c, selectedCells())
-        if(!c->toInbetweenCell())
-            cellsToSelect.insert(c);
-
-    setSelectedCells(cellsToSelect,emitSignal);
+    discardSelectedCells_(InbetweenTypes, emitSignal);
 }
 
 void VAC::selectKeyVertices(bool emitSignal)
 {
-    CellSet cellsToSelect;
-    foreach(Cell * c, selectedCells())
-        if(c->toKeyVertex())
-            cellsToSelect.insert(c);
-
-    setSelectedCells(cellsToSelect,emitSignal);
+    keepSelectedCells_(KeyVertexType, emitSignal);
 }
 
 void VAC::selectKeyEdges(bool emitSignal)
 {
-    CellSet cellsToSelect;
-    foreach(Cell * c, selectedCells())
-        if(c->toKeyEdge())
-            cellsToSelect.insert(c);
-
-    setSelectedCells(cellsToSelect,emitSignal);
+    keepSelectedCells_(KeyEdgeType, emitSignal);
 }
 
 void VAC::selectKeyFaces(bool emitSignal)
 {
-    CellSet cellsToSelect;
-    foreach(Cell * c, selectedCells())
-        if(c->toKeyFace())
-            cellsToSelect.insert(c);
-
-    setSelectedCells(cellsToSelect,emitSignal);
+    keepSelectedCells_(KeyFaceType, emitSignal);
 }
 
 void VAC::deselectKeyVertices(bool emitSignal)
 {
-    CellSet cellsToSelect;
-    foreach(Cell * c, selectedCells())
-        if(!c->toKeyVertex())
-            cellsToSelect.insert(c);
-
-    setSelectedCells(cellsToSelect,emitSignal);
+    discardSelectedCells_(KeyVertexType, emitSignal);
 }
 
 void VAC::deselectKeyEdges(bool emitSignal)
 {
-    CellSet cellsToSelect;
-    foreach(Cell * c, selectedCells())
-        if(!c->toKeyEdge())
-            cellsToSelect.insert(c);
-
-    setSelectedCells(cellsToSelect,emitSignal);
+    discardSelectedCells_(KeyEdgeType, emitSignal);
 }
 
 void VAC::deselectKeyFaces(bool emitSignal)
 {
-    CellSet cellsToSelect;
-    foreach(Cell * c, selectedCells())
-        if(!c->toKeyFace())
-            cellsToSelect.insert(c);
-
-    setSelectedCells(cellsToSelect,emitSignal);
+    discardSelectedCells_(KeyFaceType, emitSignal);
 }
 
 void VAC::selectInbetweenVertices(bool emitSignal)
 {
-    CellSet cellsToSelect;
-    foreach(Cell * c, selectedCells())
-        if(c->toInbetweenVertex())
-            cellsToSelect.insert(c);
-
-    setSelectedCells(cellsToSelect,emitSignal);
+    keepSelectedCells_(InbetweenVertexType, emitSignal);
 }
 
 void VAC::selectInbetweenEdges(bool emitSignal)
 {
-    CellSet cellsToSelect;
-    foreach(Cell * c, selectedCells())
-        if(c->toInbetweenEdge())
-            cellsToSelect.insert(c);
-
-    setSelectedCells(cellsToSelect,emitSignal);
+    keepSelectedCells_(InbetweenEdgeType, emitSignal);
 }
 
 void VAC::selectInbetweenFaces(bool emitSignal)
 {
-    CellSet cellsToSelect;
-    foreach(Cell * c, selectedCells())
-        if(c->toInbetweenFace())
-            cellsToSelect.insert(c);
-
-    setSelectedCells(cellsToSelect,emitSignal);
+    keepSelectedCells_(InbetweenFaceType, emitSignal);
 }
 
 void VAC::deselectInbetweenVertices(bool emitSignal)
 {
-    CellSet cellsToSelect;
-    foreach(Cell * c, selectedCells())
-        if(!c->toInbetweenVertex())
-            cellsToSelect.insert(c);
-
-    setSelectedCells(cellsToSelect,emitSignal);
+    discardSelectedCells_(InbetweenVertexType, emitSignal);
 }
 
 void VAC::deselectInbetweenEdges(bool emitSignal)
 {
-    CellSet cellsToSelect;
-    foreach(Cell * c, selectedCells())
-        if(!c->toInbetweenEdge())
-            cellsToSelect.insert(c);
-
-    setSelectedCells(cellsToSelect,emitSignal);
+    discardSelectedCells_(InbetweenEdgeType, emitSignal);
 }
 
 void VAC::deselectInbetweenFaces(bool emitSignal)
 {
-    CellSet cellsToSelect;
-    foreach(Cell * c, selectedCells())
-        if(!c->toInbetweenFace())
-            cellsToSelect.insert(c);
-
-    setSelectedCells(cellsToSelect,emitSignal);
+    discardSelectedCells_(InbetweenFaceType, emitSignal);
 }
 
 void VAC::prepareDragAndDrop(double x0, double y0, Time time)
@@ -6365,7 +7319,7 @@ void VAC::completeDragAndDrop()
     global()->setDragAndDropping(false);
 
     //emit changed();
-    emit checkpoint();
+    emitCheckpoint_();
 }
 
 void VAC::beginTransformSelection(double x0, double y0, Time time)
@@ -6381,7 +7335,7 @@ void VAC::continueTransformSelection(double x, double y)
 void VAC::endTransformSelection()
 {
     transformTool_.endTransform();
-    emit checkpoint();
+    emitCheckpoint_();
 }
 
 void VAC::prepareTemporalDragAndDrop(Time t0)
@@ -6419,12 +7373,12 @@ void VAC::performTemporalDragAndDrop(Time t)
     foreach(KeyCell * keyCell, draggedKeyCells_)
         keyCell->setTime(draggedKeyCellTime_[keyCell] + deltaTime);
 
-    emit changed();
+    emitChanged_();
 }
 
 void VAC::completeTemporalDragAndDrop()
 {
-    emit checkpoint();
+    emitCheckpoint_();
 }
 
 
@@ -6551,9 +7505,9 @@ KeyVertex * VAC::split(double x, double y, Time time, bool interactive)
 
     if(interactive)
     {
-        emit needUpdatePicking();
-        emit changed();
-        emit checkpoint();
+        emitNeedUpdatePicking_();
+        emitChanged_();
+        emitCheckpoint_();
     }
 
     return res;
@@ -6567,10 +7521,33 @@ bool VAC::check() const
     return true;
 }
 
+bool VAC::checkModified()
+{
+    // Collect cells whose invariants may have been broken. Note: deleted
+    // cells are skipped, but the cells they were incident to are modified.
+    CellSet toCheck;
+    modifiedCellIds_.forEach([&](int id)
+    {
+        Cell * c = cells_.value(id);
+        if(c)
+        {
+            toCheck << c;
+            toCheck.unite(c->boundary());
+            toCheck.unite(c->star());
+        }
+    });
+    modifiedCellIds_.clear();
+
+    foreach(Cell * c, toCheck)
+        if(!(c->check()))
+            return false;
+    return true;
+}
+
 bool VAC::checkContains(const Cell * c) const
 {
     int id = c->id();
-    return (cells_.contains(id)) && (cells_[id] == c);
+    return cells_.value(id) == c;
 }
 
 void VAC::updateToBePaintedFace(double x, double y, Time time)
@@ -6798,9 +7775,9 @@ Cell * VAC::paint(double /*x*/, double /*y*/, Time /*time*/)
 
     if (res)
     {
-        emit needUpdatePicking();
-        emit changed();
-        emit checkpoint();
+        emitNeedUpdatePicking_();
+        emitChanged_();
+        emitCheckpoint_();
     }
 
     // Return
@@ -6814,9 +7791,9 @@ void VAC::test()
     // Note: for this to work, you also have to uncomment in MainWindow.cpp the line:
     //             menuEdit->addAction(actionTest);
 
-    emit needUpdatePicking();
-    emit changed();
-    emit checkpoint();
+    emitNeedUpdatePicking_();
+    emitChanged_();
+    emitCheckpoint_();
 }
 
 }
@@ -19,14 +19,19 @@
 
 #include <QSet>
 #include <QMap>
+#include <QPair>
 #include <QColor>
 
 #include "../SceneObject.h"
 
 #include "ForwardDeclaration.h"
 #include "CellList.h"
+#include "CellTable.h"
+#include "CellBitSet.h"
 #include "Cell.h"
 #include "ZOrderedCells.h"
+#include "SpatialIndex.h"
+#include "PointIndex.h"
 #include "Eigen.h"
 #include "TransformTool.h"
 #include "EdgeSample.h"
@@ -74,6 +79,18 @@ public:
     void initNonCopyable();
     void initCopyable();
 
+    // Transactions, for performing many edits at once. Between
+    // beginTransaction() and endTransaction(), the VAC signals are emitted
+    // at most once each, when the outermost transaction ends. The cached
+    // geometry (triangulations, bounding boxes) of cells whose geometry
+    // changed is also only invalidated at that time, once per cell, so it
+    // must not be relied on within the transaction.
+    //
+    // Transactions can be nested.
+    void beginTransaction();
+    void endTransaction();
+    bool isInTransaction() const;
+
     // VAC extraction and insertion
     QMap<int, int> import(VAC * other, bool selectImportedCells = false); // insert a copy of other inside this
     VAC * subcomplex(const CellSet & subcomplexCells); // Create a new VAC whose cells are cells
@@ -95,8 +112,29 @@ public:
     // Get higlighted and selected state
     Cell * hoveredCell() const;
     const CellSet & selectedCells() const;
+    const CellBitSet & selectedIds() const;
     int numSelectedCells() const;
 
+    // Cell types, as flags that can be combined
+    enum CellType {
+        KeyVertexType = 0x01,
+        KeyEdgeType = 0x02,
+        KeyFaceType = 0x04,
+        InbetweenVertexType = 0x08,
+        InbetweenEdgeType = 0x10,
+        InbetweenFaceType = 0x20,
+        VertexTypes = KeyVertexType | InbetweenVertexType,
+        EdgeTypes = KeyEdgeType | InbetweenEdgeType,
+        FaceTypes = KeyFaceType | InbetweenFaceType,
+        KeyTypes = KeyVertexType | KeyEdgeType | KeyFaceType,
+        InbetweenTypes = InbetweenVertexType | InbetweenEdgeType | InbetweenFaceType,
+        AllTypes = KeyTypes | InbetweenTypes
+    };
+    static const int NumCellTypes = 6;
+
+    // Number of selected cells of the given types. This is constant-time.
+    int numSelectedCells(int types) const;
+
     // Get hovered transform widget id
     int hoveredTransformWidgetId() const;
 
@@ -261,6 +299,7 @@ public slots:
     void glue();
     void unglue();
     void uncut();
+    void simplifyAll(); // uncut at all vertices between two edges, when possible
     void cut(VAC* & clipboard);
     void copy(VAC* & clipboard);
     void paste(VAC* & clipboard);
@@ -316,8 +355,23 @@ public:
     bool atomicSimplifyAtCell(Cell * cell);
     bool simplifyAtCell(Cell * cell);
 
-    // Check the invariants of the VAC
+    // Splits the given key edges at all their intersections, with each other
+    // and with themselves, and glues the resulting vertices, so that they form
+    // a planar map. Intersections closer than `tolerance` are merged, and
+    // endpoints closer than `tolerance` from an edge are considered to
+    // intersect it. All intersections are computed in one sweep, which is
+    // much faster than inserting the edges one by one. The edges must share
+    // the same time. Edges whose geometry is not a LinearSpline are ignored.
+    void makePlanarMap(const KeyEdgeList & edges, double tolerance = 1e-2);
+
+    // Check the invariants of the VAC. check() checks all cells, while
+    // checkModified() only checks the cells modified since the last call to
+    // checkModified(), together with their boundary and star. The latter is
+    // what is done at the end of each transaction in debug builds, or in all
+    // builds if VPAINT_CHECK_INVARIANTS is defined. If
+    // VPAINT_CHECK_ALL_INVARIANTS is defined, check() is used instead.
     bool check() const;
+    bool checkModified();
     bool checkContains(const Cell * c) const;
 
 
@@ -334,12 +388,66 @@ private:
     // Trusting operators
     friend class Operator;
 
-    // All cells in vac, accessible by ID
-    QMap<int, Cell*> cells_;
+    // All cells in vac, accessible by ID, and their IDs by type (the i-th
+    // set stores the IDs of cells of type 1 << i)
+    CellTable cells_;
+    CellBitSet cellIdsByType_[NumCellTypes];
+    void addToCellTable_(Cell * cell);
+    void removeFromCellTable_(Cell * cell);
+    static int cellTypeIndex_(Cell * cell);
+    CellBitSet cellIds_(int types) const;
     void removeCell_(Cell * cell);
     void insertCell_(Cell * cell);
     void insertCellLast_(Cell * cell);
 
+    // Key vertices at each key time, used for snapping. The index of a given
+    // time is built on first use, then kept up to date when key vertices are
+    // inserted, removed, moved, or dragged in time.
+    QMap<Time, PointIndex> keyVertexIndices_;
+    PointIndex & keyVertexIndex_(Time time);
+    void indexKeyVertex_(KeyVertex * keyVertex);
+    void unindexKeyVertex_(KeyVertex * keyVertex);
+    friend class KeyCell;
+    friend class KeyVertex;
+
+    // Key edges at a given time, used to find the edges within the sculpt
+    // radius. Edges inserted or modified since the index was built are
+    // tested separately, until there are enough of them to rebuild it.
+    SpatialIndex sculptIndex_;
+    Time sculptIndexTime_;
+    bool hasSculptIndex_;
+    QSet<int> sculptIndexChangedEdges_;
+    void updateSculptIndex_(Time time);
+
+    // Called by cells whose geometry changed, with all the cells affected
+    void processGeometryChanged_(const CellSet & cells);
+    friend class Cell;
+
+    // Transactions. Within a transaction, deferGeometryChanged_() records the
+    // given cell and returns true, and signals are only recorded.
+    int transactionDepth_;
+    CellSet transactionGeometryChangedCells_;
+    bool transactionNeedUpdatePicking_;
+    bool transactionChanged_;
+    bool transactionCheckpoint_;
+    bool deferGeometryChanged_(Cell * cell);
+    void emitNeedUpdatePicking_();
+    void emitChanged_();
+    void emitCheckpoint_();
+
+    // Key vertices whose star lost cells since beginTrackingStarChanges_().
+    // These are the only vertices that a deletion can leave isolated.
+    bool trackStarChanges_;
+    KeyVertexSet starChangedVertices_;
+    void beginTrackingStarChanges_();
+    KeyVertexSet endTrackingStarChanges_();
+    void processStarChanged_(Cell * cell); // called by cells whose star lost cells
+
+    // IDs of cells created or modified since the last checkModified(),
+    // possibly including cells deleted since then
+    CellBitSet modifiedCellIds_;
+    void setModified_(Cell * cell);
+
     // Managing IDs
     int getAvailableID();
     void deleteAllCells();
@@ -357,6 +465,13 @@ private:
     bool drawRectangleOfSelection_;
     CellSet rectangleOfSelectionSelectedBefore_;
     CellSet cellsInRectangleOfSelection_;
+    SpatialIndex rectangleOfSelectionIndex_;        // Pickable cells when the rectangle started
+    BoundingBox rectangleOfSelectionBoundingBox_;   // Rectangle when cellsInRectangleOfSelection_ was last updated
+    bool hasRectangleOfSelectionModifiers_;
+    Qt::KeyboardModifiers rectangleOfSelectionModifiers_; // Modifiers when the selection was last set
+    void updateSelectedCellsFromRectangleOfSelection_(
+            const CellSet & enteringCells, const CellSet & leavingCells,
+            Qt::KeyboardModifiers modifiers);
 
     // Drawing a new stroke
     void insertSketchedEdgeInVAC();
@@ -386,7 +501,7 @@ private:
     SplitInfo cutEdgeAtVertices_(KeyEdge * edgeToSplit, const std::vector<double> & splitValues);
 
     // Gluing
-    void glue_(KeyVertex * v1, KeyVertex * v2);
+    KeyVertex * glue_(KeyVertex * v1, KeyVertex * v2);
     void glue_(KeyEdge * e1, KeyEdge * e2);
     void glue_(const KeyHalfedge & h1, const KeyHalfedge & h2);
 
@@ -397,7 +512,7 @@ private:
     void unglue_(KeyEdge * e);
 
     // Uncutting
-    bool uncut_(KeyVertex * v);
+    bool uncut_(KeyVertex * v, LinearSpline * geometry = 0); // takes ownership of geometry, see simplifyAll()
     bool uncut_(KeyEdge * e);
 
     // Smart deleting
@@ -443,14 +558,40 @@ private:
     // Cut-Copy-Paste
     Time timeCopy_;
 
-    // Selecting and highlighting
+    // Selecting and highlighting. The selection is stored as a set of IDs,
+    // so that selecting all cells or all cells of a given type is a matter
+    // of combining bit sets. The CellSet returned by selectedCells() is
+    // only rebuilt when requested after such bulk changes.
     int hoveredTransformWidgetId_;
     Cell * hoveredCell_;
-    CellSet selectedCells_;
+    CellBitSet selectedIds_;
+    int numSelectedCells_[NumCellTypes];
+    mutable CellSet selectedCells_;
+    mutable bool selectedCellsDirty_;
+    void setSelectedIds_(const CellBitSet & ids, bool emitSignal, const CellSet * cells = 0);
+    void updateNumSelectedCells_();
+    void keepSelectedCells_(int types, bool emitSignal);    // deselect cells not of the given types
+    void discardSelectedCells_(int types, bool emitSignal); // deselect cells of the given types
+    void addToSelection_(const CellList & cells, bool emitSignal);         // cells must be in the VAC
 
     // Z-layering
     ZOrderedCells zOrdering_;
 
+    // Batches of triangles used by draw(), kept across frames so that
+    // unchanged cells are not uploaded again. There is one pair of batches
+    // (one per drawing pass) for each view and time drawn recently, so that
+    // onion skins and other views don't overwrite each other's batches.
+    struct DrawBatches
+    {
+        TriangleBatch fill;
+        TriangleBatch topology;
+        quint64 lastUsed;
+    };
+    typedef QPair<quintptr, double> DrawBatchesKey; // (view settings, time)
+    QMap<DrawBatchesKey, DrawBatches *> drawBatches_;
+    quint64 numDraws_;
+    DrawBatches & findDrawBatches_(ViewSettings & viewSettings, Time time);
+
     // Smart aggregation of signals
     void emitSelectionChanged_();
     void beginAggregateSignals_();
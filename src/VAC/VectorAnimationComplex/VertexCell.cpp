@@ -21,6 +21,7 @@
 #include "KeyEdge.h"
 #include "../OpenGL.h"
 #include "../DevSettings.h"
+#include "../GLUtils.h"
 #include <QTextStream>
 #include <QStringList>
 #include "../SaveAndLoad.h"
@@ -85,18 +86,7 @@ void VertexCell::drawPickCustom(Time time, ViewSettings & /*viewSettings*/)
     if(!exists(time))
         return;
 
-    int n = 50;
-    Eigen::Vector2d p = pos(time);
-    glBegin(GL_POLYGON);
-    {
-        double r = 0.5 * size(time);
-        for(int i=0; i<n; ++i)
-        {
-            double theta = 2 * (double) i * 3.14159 / (double) n ;
-            glVertex2d(p.x() + r*std::cos(theta),p.y()+ r*std::sin(theta));
-            }
-    }
-    glEnd();
+    GLUtils::drawDisk(pos(time), 0.5 * size(time));
 }
 
 void VertexCell::drawRaw(Time time, ViewSettings & viewSettings)
@@ -107,45 +97,48 @@ void VertexCell::drawRaw(Time time, ViewSettings & viewSettings)
     }
 }
 
-void VertexCell::drawRawTopology(Time time, ViewSettings & viewSettings)
+void VertexCell::drawRawBatched(Time time, ViewSettings & viewSettings, TriangleBatch & batch)
+{
+    if(isHighlighted() || isSelected())
+    {
+        Cell::drawRawBatched(time, viewSettings, batch);
+    }
+}
+
+namespace
+{
+
+double topologyRadius(ViewSettings & viewSettings)
 {
     bool screenRelative = viewSettings.screenRelative();
     if(screenRelative)
     {
-        int n = 50;
-        Eigen::Vector2d p = pos(time);
-        glBegin(GL_POLYGON);
-        {
-            double r = 0.5 * viewSettings.vertexTopologySize() / viewSettings.zoom();
-            //if(r == 0) r = 3;
-            //else if (r<1) r = 1;
-            for(int i=0; i<n; ++i)
-            {
-                double theta = 2 * (double) i * 3.14159 / (double) n ;
-                glVertex2d(p.x() + r*std::cos(theta),p.y()+ r*std::sin(theta));
-            }
-        }
-        glEnd();
+        double r = 0.5 * viewSettings.vertexTopologySize() / viewSettings.zoom();
+        //if(r == 0) r = 3;
+        //else if (r<1) r = 1;
+        return r;
     }
     else
     {
-        int n = 50;
-        Eigen::Vector2d p = pos(time);
-        glBegin(GL_POLYGON);
-        {
-            double r = 0.5 * viewSettings.vertexTopologySize();
-            if(r == 0) r = 3;
-            else if (r<1) r = 1;
-            for(int i=0; i<n; ++i)
-            {
-                double theta = 2 * (double) i * 3.14159 / (double) n ;
-                glVertex2d(p.x() + r*std::cos(theta),p.y()+ r*std::sin(theta));
-            }
-        }
-        glEnd();
+        double r = 0.5 * viewSettings.vertexTopologySize();
+        if(r == 0) r = 3;
+        else if (r<1) r = 1;
+        return r;
     }
 }
 
+}
+
+void VertexCell::drawRawTopology(Time time, ViewSettings & viewSettings)
+{
+    GLUtils::drawDisk(pos(time), topologyRadius(viewSettings));
+}
+
+void VertexCell::drawRawTopologyBatched(Time time, ViewSettings & viewSettings, TriangleBatch & batch)
+{
+    batch.appendDisk(pos(time), topologyRadius(viewSettings));
+}
+
 double VertexCell::size(Time time) const
 {
     double defaultSize = 0;
@@ -260,15 +253,18 @@ void VertexCell::triangulate_(Time time, Triangles & out) const
         const int n = 50;
         const double dTheta = 2 * 3.14159 / (double) n ;
 
+        // Center vertex followed by n vertices on the circle
+        out.reserve(n+1, n);
+        int c = out.addVertex(center);
         double theta = 0;
-        Eigen::Vector2d a = circle_(center, r, theta);
-        Eigen::Vector2d b;
         for(int i=0; i<n; ++i)
         {
+            out.addVertex(circle_(center, r, theta));
             theta += dTheta;
-            b = circle_(center, r, theta);
-            out << Triangle(center, a, b);
-            a = b;
+        }
+        for(int i=0; i<n; ++i)
+        {
+            out.addTriangle(c, c+1+i, c+1+(i+1)%n);
         }
     }
 }
@@ -41,6 +41,8 @@ public:
     //void draw(Time time, ViewSettings & viewSettings);
     void drawRaw(Time time, ViewSettings & viewSettings);
     void drawRawTopology(Time time, ViewSettings & viewSettings);
+    void drawRawBatched(Time time, ViewSettings & viewSettings, TriangleBatch & batch);
+    void drawRawTopologyBatched(Time time, ViewSettings & viewSettings, TriangleBatch & batch);
 
     // Topology
     CellSet spatialBoundary() const;
@@ -19,12 +19,25 @@
 #include "Cell.h"
 #include "Algorithms.h"
 
+#include <algorithm> // min
 #include <iostream>
+#include <limits>
 #include <QDebug>
 
 namespace VectorAnimationComplex
 {
 
+namespace
+{
+
+// Label space, and gap between the labels of consecutive cells when there is
+// enough room. With such a large gap, relabeling cells is only needed after
+// dozens of insertions at the same position.
+const unsigned long long maxLabel = std::numeric_limits<unsigned long long>::max();
+const unsigned long long defaultGap = 1ULL << 32;
+
+}
+
 ZOrderedCells::ZOrderedCells() :
     list_()
 {
@@ -33,6 +46,7 @@ ZOrderedCells::ZOrderedCells() :
 void ZOrderedCells::clear()
 {
     list_.clear();
+    handles_.clear();
 }
 
 ZOrderedCells::Iterator ZOrderedCells::begin()
@@ -77,7 +91,7 @@ ZOrderedCells::ConstReverseIterator ZOrderedCells::crend() const
 
 void ZOrderedCells::insertLast(Cell * cell)
 {
-    list_.append(cell);
+    insert_(end(), cell);
 }
 
 // Insert the new cell just below the lowest boundary cell
@@ -95,45 +109,154 @@ void ZOrderedCells::insertCell(Cell * cell)
     else
     {
         // Insert before boundary
-        Iterator it = begin();
-        while(it!=end() && !boundary.contains(*it))
-            ++it;
-        list_.insert(it,cell);
+        insert_(findFirst(boundary), cell);
     }
 }
 
 void ZOrderedCells::removeCell(Cell * cell)
 {
-    list_.remove(cell);
+    Iterator it = find(cell);
+    if(it != end())
+        erase_(it);
 }
 
 ZOrderedCells::Iterator ZOrderedCells::find(Cell * cell)
 {
-    Iterator it = begin();
-    for(; it != end(); ++it)
-        if(*it == cell)
-            break;
-    return it;
+    auto handle = handles_.constFind(cell);
+    if(handle != handles_.constEnd())
+        return handle->it;
+    else
+        return end();
 }
 
 ZOrderedCells::Iterator ZOrderedCells::findFirst(const CellSet & cells)
 {
-    Iterator it = begin();
-    for(; it != end(); ++it)
-        if(cells.contains(*it))
-            break;
-    return it;
+    Iterator res = end();
+    Label minLabel = maxLabel;
+    foreach(Cell * cell, cells)
+    {
+        auto handle = handles_.constFind(cell);
+        if(handle != handles_.constEnd() && (res == end() || handle->label < minLabel))
+        {
+            res = handle->it;
+            minLabel = handle->label;
+        }
+    }
+    return res;
 }
 
 ZOrderedCells::ReverseIterator ZOrderedCells::findLast(const CellSet & cells)
 {
-    ReverseIterator it = rbegin();
-    for(; it != rend(); ++it)
-        if(cells.contains(*it))
-            break;
+    Iterator res = end();
+    Label maxFoundLabel = 0;
+    foreach(Cell * cell, cells)
+    {
+        auto handle = handles_.constFind(cell);
+        if(handle != handles_.constEnd() && (res == end() || handle->label > maxFoundLabel))
+        {
+            res = handle->it;
+            maxFoundLabel = handle->label;
+        }
+    }
+
+    // Note: ReverseIterator(it) points to the element before it
+    if(res == end())
+        return rend();
+    else
+        return ReverseIterator(++res);
+}
+
+bool ZOrderedCells::contains(Cell * cell) const
+{
+    return handles_.contains(cell);
+}
+
+bool ZOrderedCells::isBelow(Cell * c1, Cell * c2) const
+{
+    return handles_.value(c1).label < handles_.value(c2).label;
+}
+
+ZOrderedCells::Iterator ZOrderedCells::insert_(Iterator pos, Cell * cell)
+{
+    Iterator it = list_.insert(pos, cell);
+    Handle & handle = handles_[cell];
+    handle.it = it;
+    Iterator next = it;
+    updateLabels_(it, ++next);
     return it;
 }
 
+void ZOrderedCells::erase_(Iterator pos)
+{
+    handles_.remove(*pos);
+    list_.erase(pos);
+}
+
+void ZOrderedCells::splice_(Iterator pos, CellLinkedList & cells)
+{
+    // Note: iterators to spliced cells remain valid, so only labels change
+    Iterator first = cells.begin();
+    if(first != cells.end())
+    {
+        list_.splice(pos, cells);
+        updateLabels_(first, pos);
+    }
+}
+
+void ZOrderedCells::splice_(ReverseIterator pos, CellLinkedList & cells)
+{
+    splice_(pos.base(), cells);
+}
+
+ZOrderedCells::Label ZOrderedCells::label_(Iterator it) const
+{
+    return handles_.value(*it).label;
+}
+
+void ZOrderedCells::updateLabels_(Iterator first, Iterator last)
+{
+    // Count cells to label
+    Label n = 0;
+    for(Iterator it = first; it != last; ++it)
+        ++n;
+
+    // Grow the range [first, last) until there is enough room between the
+    // label of the cell before first and the label of last. Growing it by
+    // its own size each time keeps the amortized cost low.
+    while(true)
+    {
+        bool isBottom = (first == begin());
+        bool isTop = (last == end());
+        Iterator before = first;
+        Label low = isBottom ? 0 : label_(--before);
+        Label high = isTop ? maxLabel : label_(last);
+
+        if(high > low && (high - low) / (n+1) >= 2)
+        {
+            // Use the default gap if possible, otherwise spread cells evenly
+            Label gap = std::min(defaultGap, (high - low) / (n+1));
+            Label label = low;
+            if(isBottom && !isTop)
+                label = high - gap * (n+1);
+            else if(!isTop)
+                label = low + ((high - low) - gap * (n+1)) / 2;
+            for(Iterator it = first; it != last; ++it)
+            {
+                label += gap;
+                handles_[*it].label = label;
+            }
+            return;
+        }
+
+        // Not enough room: include more neighbouring cells
+        Label k = n;
+        for(Label i = 0; i < k && first != begin(); ++i, ++n)
+            --first;
+        for(Label i = 0; i < k && last != end(); ++i, ++n)
+            ++last;
+    }
+}
+
 void ZOrderedCells::raise(Cell * cell) { raise(CellSet() << cell); }
 void ZOrderedCells::lower(Cell * cell) { lower(CellSet() << cell); }
 void ZOrderedCells::raiseToTop(Cell * cell) { raiseToTop(CellSet() << cell); }
@@ -201,7 +324,7 @@ void ZOrderedCells::raise(CellSet cellsToRaise)
     }
     if(!c1) // not found, raise to top.
     {
-        list_.splice(it,raisedCells);
+        splice_(it,raisedCells);
         return;
     }
 
@@ -229,7 +352,7 @@ void ZOrderedCells::raise(CellSet cellsToRaise)
 
     // Move raised cells above it2
     ++it2;
-    list_.splice(it2,raisedCells);
+    splice_(it2,raisedCells);
 }
 
 void ZOrderedCells::lower(CellSet cellsToLower)
@@ -276,7 +399,7 @@ void ZOrderedCells::lower(CellSet cellsToLower)
     }
     if(!c1) // not found, raise to top.
     {
-        list_.splice(it,loweredCells);
+        splice_(it,loweredCells);
         return;
     }
 
@@ -304,7 +427,7 @@ void ZOrderedCells::lower(CellSet cellsToLower)
 
     // Move lowered cells below it2
     ++it2;
-    list_.splice(it2,loweredCells);
+    splice_(it2,loweredCells);
 }
 
 void ZOrderedCells::raiseToTop(CellSet cellsToRaise)
@@ -330,7 +453,7 @@ void ZOrderedCells::raiseToTop(CellSet cellsToRaise)
     }
 
     // Move raised cells to top
-    list_.splice(it,raisedCells);
+    splice_(it,raisedCells);
 }
 
 void ZOrderedCells::lowerToBottom(CellSet cellsToLower)
@@ -356,7 +479,7 @@ void ZOrderedCells::lowerToBottom(CellSet cellsToLower)
     }
 
     // Move lowered cells to bottom
-    list_.splice(it,loweredCells);
+    splice_(it,loweredCells);
 }
 
 void ZOrderedCells::altRaise(CellSet cellsToRaise)
@@ -395,13 +518,13 @@ void ZOrderedCells::altRaise(CellSet cellsToRaise)
     }
     if(!c1) // not found, raise to top.
     {
-        list_.splice(it,raisedCells);
+        splice_(it,raisedCells);
         return;
     }
 
     // Move raised cells above it
     ++it;
-    list_.splice(it,raisedCells);
+    splice_(it,raisedCells);
 }
 
 void ZOrderedCells::altLower(CellSet cellsToLower)
@@ -440,13 +563,13 @@ void ZOrderedCells::altLower(CellSet cellsToLower)
     }
     if(!c1) // not found, raise to top.
     {
-        list_.splice(it,loweredCells);
+        splice_(it,loweredCells);
         return;
     }
 
     // Move lowered cells below it
     ++it;
-    list_.splice(it,loweredCells);
+    splice_(it,loweredCells);
 }
 
 void ZOrderedCells::altRaiseToTop(CellSet cellsToRaise)
@@ -469,7 +592,7 @@ void ZOrderedCells::altRaiseToTop(CellSet cellsToRaise)
     }
 
     // Move raised cells to top
-    list_.splice(it,raisedCells);
+    splice_(it,raisedCells);
 }
 
 void ZOrderedCells::altLowerToBottom(CellSet cellsToLower)
@@ -492,16 +615,16 @@ void ZOrderedCells::altLowerToBottom(CellSet cellsToLower)
     }
 
     // Move lowered cells to bottom
-    list_.splice(it,loweredCells);
+    splice_(it,loweredCells);
 }
 
 void ZOrderedCells::moveBelow(Cell * c1, Cell * c2)
 {
     Iterator it1 = find(c1);
-    list_.erase(it1);
+    erase_(it1);
 
     Iterator it2 = find(c2);
-    list_.insert(it2,c1);
+    insert_(it2,c1);
 }
 
 void ZOrderedCells::moveBelowBoundary(Cell * c)
@@ -510,10 +633,10 @@ void ZOrderedCells::moveBelowBoundary(Cell * c)
     if(!boundary.isEmpty())
     {
         Iterator it1 = find(c);
-        list_.erase(it1);
+        erase_(it1);
 
         Iterator it2 = findFirst(boundary);
-        list_.insert(it2,c);
+        insert_(it2,c);
     }
 }
 
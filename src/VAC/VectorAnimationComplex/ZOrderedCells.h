@@ -18,10 +18,17 @@
 #define ZORDEREDCELLS_H
 
 // ZOrderedCells: A doubly linked list of cells with convenient methods
+//
+// Each cell in the list has a handle (its position in the list) and an
+// order label (an integer increasing from bottom to top), which are kept
+// up to date as cells are inserted, removed, or moved. This makes finding,
+// removing, and comparing the depth of cells constant-time operations.
 
 #include "CellList.h"
 #include "CellLinkedList.h"
 
+#include <QHash>
+
 namespace VectorAnimationComplex
 {
 
@@ -50,10 +57,16 @@ public:
     void removeCell(Cell * cell);
     void clear();
 
-    Iterator find(Cell * cell);
+    Iterator find(Cell * cell); // end() if not found
     Iterator findFirst(const CellSet & cells);
     ReverseIterator findLast(const CellSet & cells);
 
+    // Returns whether the cell is in the list
+    bool contains(Cell * cell) const;
+
+    // Returns whether c1 is below c2. Both cells must be in the list.
+    bool isBelow(Cell * c1, Cell * c2) const;
+
     // Raise or lower a single cell
 
     void raise(Cell * cell);
@@ -85,6 +98,26 @@ public:
 private:
     CellLinkedList list_;
 
+    // Handle and order label of each cell in list_
+    typedef unsigned long long Label;
+    struct Handle
+    {
+        Iterator it;
+        Label label;
+    };
+    QHash<Cell*, Handle> handles_;
+
+    // Insert or move cells while keeping handles and labels up to date
+    Iterator insert_(Iterator pos, Cell * cell);
+    void erase_(Iterator pos);
+    void splice_(Iterator pos, CellLinkedList & cells);
+    void splice_(ReverseIterator pos, CellLinkedList & cells);
+
+    // Assigns increasing labels to the cells in [first, last), which must
+    // all have a handle, relabeling neighbouring cells if there isn't enough
+    // room between the labels of the cells before and after
+    void updateLabels_(Iterator first, Iterator last);
+    Label label_(Iterator it) const;
 };
 
 }
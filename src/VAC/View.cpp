@@ -29,7 +29,10 @@
 #include <QtDebug>
 #include <QApplication>
 #include <QPushButton>
+
+#include <algorithm> // min, copy
 #include <cmath>
+#include <vector>
 
 // define mouse actions
 
@@ -60,6 +63,7 @@ View::View(Scene * scene, QWidget * parent) :
     scene_(scene),
     pickingImg_(0),
     pickingIsEnabled_(true),
+    isDrawingToImage_(false),
     currentAction_(0),
     vac_(0)
 {
@@ -986,6 +990,7 @@ BackgroundRenderer * View::createBackgroundRenderer_(Background * background)
 {
     BackgroundRenderer * res = new BackgroundRenderer(background, this);
     connect(res, &BackgroundRenderer::backgroundDestroyed, this, &View::onBackgroundDestroyed_);
+    connect(res, &BackgroundRenderer::imageReady, this, &View::update);
     backgroundRenderers_.insert(background, res);
     return res;
 }
@@ -1009,10 +1014,12 @@ BackgroundRenderer * View::getOrCreateBackgroundRenderer_(Background * backgroun
 void View::drawBackground_(Background * background, int frame)
 {
     BackgroundRenderer * br = getOrCreateBackgroundRenderer_(background);
+    br->setBlocking(isDrawingToImage_);
     br->draw(frame,
              global()->showCanvas(),
              scene_->left(), scene_->top(), scene_->width(), scene_->height(),
-             xSceneMin(), xSceneMax(), ySceneMin(), ySceneMax());
+             xSceneMin(), xSceneMax(), ySceneMin(), ySceneMax(),
+             viewSettings_.zoom());
 }
 
 void View::drawScene()
@@ -1053,8 +1060,21 @@ void View::drawScene()
     // XXX Should be replaced by drawCanvas_(scene_->canvas());
     scene_->drawCanvas(viewSettings_);
 
-    // Draw scene
+    // Draw scene, skipping cells outside of the view. The visible rect is
+    // reset afterwards so that it can't cull other renders using these
+    // view settings (e.g., exports).
+    viewSettings_.setVisibleRect(xSceneMin(), xSceneMax(), ySceneMin(), ySceneMax());
     drawSceneDelegate_(activeTime());
+    viewSettings_.resetVisibleRect();
+}
+
+void View::translateOnionSkin_(double dx, double dy)
+{
+    glTranslated(dx, dy, 0);
+
+    // Cells are now drawn translated by (dx, dy), so the part of the scene
+    // visible in the view is translated by (-dx, -dy) in their coordinates
+    viewSettings_.translateVisibleRect(-dx, -dy);
 }
 
 void View::drawSceneDelegate_(Time t)
@@ -1092,26 +1112,26 @@ void View::drawSceneDelegate_(Time t)
             for(int i=0; i<viewSettings_.numOnionSkinsBefore(); ++i)
             {
                 tOnion = tOnion - viewSettings_.onionSkinsTimeOffset();
-                glTranslated(-viewSettings_.onionSkinsXOffset(),-viewSettings_.onionSkinsYOffset(),0);
+                translateOnionSkin_(-viewSettings_.onionSkinsXOffset(),-viewSettings_.onionSkinsYOffset());
             }
             for(int i=0; i<viewSettings_.numOnionSkinsBefore(); ++i)
             {
                 vac->draw(tOnion, viewSettings_);
                 tOnion = tOnion + viewSettings_.onionSkinsTimeOffset();
-                glTranslated(viewSettings_.onionSkinsXOffset(),viewSettings_.onionSkinsYOffset(),0);
+                translateOnionSkin_(viewSettings_.onionSkinsXOffset(),viewSettings_.onionSkinsYOffset());
             }
 
             // Draw onion skins after
             tOnion = t;
             for(int i=0; i<viewSettings_.numOnionSkinsAfter(); ++i)
             {
-                glTranslated(viewSettings_.onionSkinsXOffset(),viewSettings_.onionSkinsYOffset(),0);
+                translateOnionSkin_(viewSettings_.onionSkinsXOffset(),viewSettings_.onionSkinsYOffset());
                 tOnion = tOnion + viewSettings_.onionSkinsTimeOffset();
                 vac->draw(tOnion, viewSettings_);
             }
             for(int i=0; i<viewSettings_.numOnionSkinsAfter(); ++i)
             {
-                glTranslated(-viewSettings_.onionSkinsXOffset(),-viewSettings_.onionSkinsYOffset(),0);
+                translateOnionSkin_(-viewSettings_.onionSkinsXOffset(),-viewSettings_.onionSkinsYOffset());
             }
         }
 
@@ -1218,6 +1238,9 @@ ViewSettingsWidget * View::viewSettingsWidget() const
 
 void View::drawPick()
 {
+    // Skip cells outside of the view
+    viewSettings_.setVisibleRect(xSceneMin(), xSceneMax(), ySceneMin(), ySceneMax());
+
     Time t = activeTime();
     {
         if(viewSettings_.onionSkinningIsEnabled() && viewSettings_.areOnionSkinsPickable())
@@ -1226,31 +1249,33 @@ void View::drawPick()
             for(int i=0; i<viewSettings_.numOnionSkinsBefore(); ++i)
             {
                 tOnion = tOnion - viewSettings_.onionSkinsTimeOffset();
-                glTranslated(-viewSettings_.onionSkinsXOffset(),-viewSettings_.onionSkinsYOffset(),0);
+                translateOnionSkin_(-viewSettings_.onionSkinsXOffset(),-viewSettings_.onionSkinsYOffset());
             }
             for(int i=0; i<viewSettings_.numOnionSkinsBefore(); ++i)
             {
                 scene_->drawPick(tOnion, viewSettings_);
                 tOnion = tOnion + viewSettings_.onionSkinsTimeOffset();
-                glTranslated(viewSettings_.onionSkinsXOffset(),viewSettings_.onionSkinsYOffset(),0);
+                translateOnionSkin_(viewSettings_.onionSkinsXOffset(),viewSettings_.onionSkinsYOffset());
             }
 
             tOnion = t;
             for(int i=0; i<viewSettings_.numOnionSkinsAfter(); ++i)
             {
-                glTranslated(viewSettings_.onionSkinsXOffset(),viewSettings_.onionSkinsYOffset(),0);
+                translateOnionSkin_(viewSettings_.onionSkinsXOffset(),viewSettings_.onionSkinsYOffset());
                 tOnion = tOnion + viewSettings_.onionSkinsTimeOffset();
                 scene_->drawPick(tOnion, viewSettings_);
             }
             for(int i=0; i<viewSettings_.numOnionSkinsAfter(); ++i)
             {
-                glTranslated(-viewSettings_.onionSkinsXOffset(),-viewSettings_.onionSkinsYOffset(),0);
+                translateOnionSkin_(-viewSettings_.onionSkinsXOffset(),-viewSettings_.onionSkinsYOffset());
             }
         }
 
         // Draw current frame
         scene_->drawPick(t, viewSettings_);
     }
+
+    viewSettings_.resetVisibleRect();
 }
 
 bool View::updateHoveredObject(int x, int y)
@@ -1457,10 +1482,30 @@ void View::disablePicking()
 namespace
 {
 
-void imageCleanupHandler(void * info)
+// Size of the tiles used by drawToImage(). The multisample framebuffer is
+// allocated at this size (or smaller, see maxTileSize()), which bounds GPU
+// memory usage regardless of the requested export resolution.
+//
+const int exportTileSize = 1024;
+
+// Returns the largest tile size supported by the current OpenGL context.
+//
+int maxTileSize()
 {
-    uchar * img = reinterpret_cast<uchar*>(info);
-    delete[] img;
+    GLint maxRenderbufferSize = 0;
+    GLint maxTextureSize = 0;
+    GLint maxViewportDims[2] = {0, 0};
+    glGetIntegerv(GL_MAX_RENDERBUFFER_SIZE, &maxRenderbufferSize);
+    glGetIntegerv(GL_MAX_TEXTURE_SIZE, &maxTextureSize);
+    glGetIntegerv(GL_MAX_VIEWPORT_DIMS, maxViewportDims);
+    int res = exportTileSize;
+    for (GLint limit : {maxRenderbufferSize, maxTextureSize,
+                        maxViewportDims[0], maxViewportDims[1]}) {
+        if (limit > 0) {
+            res = std::min(res, static_cast<int>(limit));
+        }
+    }
+    return res;
 }
 
 }
@@ -1479,6 +1524,22 @@ QImage View::drawToImage(Time t, double x, double y, double w, double h, const R
     // Make this widget's rendering context the current OpenGL context
     makeCurrent();
 
+    // The image is rendered tile by tile, so that only a TILE_SIZE_X *
+    // TILE_SIZE_Y multisample buffer is ever allocated, even for output sizes
+    // larger than the maximum framebuffer size. Each tile is read back and
+    // copied into its rows of the final image right after being rendered.
+    //
+    int tileSize = maxTileSize();
+    int TILE_SIZE_X = std::min(IMG_SIZE_X, tileSize);
+    int TILE_SIZE_Y = std::min(IMG_SIZE_Y, tileSize);
+
+    // Allocate final image
+    QImage res(IMG_SIZE_X, IMG_SIZE_Y, QImage::Format_RGBA8888);
+    if (res.isNull()) {
+        qDebug() << "Error: cannot allocate image of size" << IMG_SIZE_X << "x" << IMG_SIZE_Y;
+        return QImage();
+    }
+
 
     // ------------ Create multisample FBO --------------------
 
@@ -1495,11 +1556,11 @@ QImage View::drawToImage(Time t, double x, double y, double w, double h, const R
     // Create multisample color buffer
     gl_fbo_->glGenRenderbuffers(1, &ms_ColorBufferId);
     gl_fbo_->glBindRenderbuffer(GL_RENDERBUFFER, ms_ColorBufferId);
-    gl_fbo_->glRenderbufferStorageMultisample(GL_RENDERBUFFER, ms_samples, GL_RGBA8, IMG_SIZE_X, IMG_SIZE_Y);
+    gl_fbo_->glRenderbufferStorageMultisample(GL_RENDERBUFFER, ms_samples, GL_RGBA8, TILE_SIZE_X, TILE_SIZE_Y);
     // Create multisample depth buffer
     gl_fbo_->glGenRenderbuffers(1, &ms_DepthBufferId);
     gl_fbo_->glBindRenderbuffer(GL_RENDERBUFFER, ms_DepthBufferId);
-    gl_fbo_->glRenderbufferStorageMultisample(GL_RENDERBUFFER, ms_samples, GL_DEPTH_COMPONENT24, IMG_SIZE_X, IMG_SIZE_Y);
+    gl_fbo_->glRenderbufferStorageMultisample(GL_RENDERBUFFER, ms_samples, GL_DEPTH_COMPONENT24, TILE_SIZE_X, TILE_SIZE_Y);
     // Attach render buffers to FBO
     gl_fbo_->glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, ms_ColorBufferId);
     gl_fbo_->glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, ms_DepthBufferId);
@@ -1514,30 +1575,24 @@ QImage View::drawToImage(Time t, double x, double y, double w, double h, const R
     // ------------ Create standard FBO --------------------
 
     GLuint fboId;
-    GLuint textureId;
+    GLuint colorBufferId;
     GLuint rboId;
 
     // Create FBO
     gl_fbo_->glGenFramebuffers(1, &fboId);
     gl_fbo_->glBindFramebuffer(GL_FRAMEBUFFER, fboId);
-    // Create color texture
-    glGenTextures(1, &textureId);
-    glBindTexture(GL_TEXTURE_2D, textureId);
-    glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-    glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
-    glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-    glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-    glTexParameteri(GL_TEXTURE_2D, GL_GENERATE_MIPMAP, GL_TRUE);
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, IMG_SIZE_X, IMG_SIZE_Y, 0,
-                 GL_RGBA, GL_UNSIGNED_BYTE, 0);
-    glBindTexture(GL_TEXTURE_2D, 0);
+    // Create color buffer. Note: we read it back with glReadPixels(), so
+    // unlike a texture, there is no need to generate mipmaps for each tile
+    gl_fbo_->glGenRenderbuffers(1, &colorBufferId);
+    gl_fbo_->glBindRenderbuffer(GL_RENDERBUFFER, colorBufferId);
+    gl_fbo_->glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, TILE_SIZE_X, TILE_SIZE_Y);
     // Create depth buffer
     gl_fbo_->glGenRenderbuffers(1, &rboId);
     gl_fbo_->glBindRenderbuffer(GL_RENDERBUFFER, rboId);
-    gl_fbo_->glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT, IMG_SIZE_X, IMG_SIZE_Y);
+    gl_fbo_->glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT, TILE_SIZE_X, TILE_SIZE_Y);
     gl_fbo_->glBindRenderbuffer(GL_RENDERBUFFER, 0);
-    // Attach render buffers / textures to FBO
-    gl_fbo_->glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, textureId, 0);
+    // Attach render buffers to FBO
+    gl_fbo_->glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, colorBufferId);
     gl_fbo_->glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, rboId);
     // Check FBO status
     GLenum status = gl_fbo_->glCheckFramebufferStatus(GL_FRAMEBUFFER);
@@ -1546,137 +1601,174 @@ QImage View::drawToImage(Time t, double x, double y, double w, double h, const R
         return QImage();
     }
 
-
-    // ------------ Render scene to multisample FBO --------------------
-
-    // Bind FBO
-    gl_fbo_->glBindFramebuffer(GL_FRAMEBUFFER, ms_fboId);
-
-    // Set viewport
+    // Save viewport
     GLint oldViewport[4];
     glGetIntegerv(GL_VIEWPORT, oldViewport);
-    glViewport(0, 0, IMG_SIZE_X, IMG_SIZE_Y);
 
-    // Clear FBO to fully transparent
-    glClearColor(0.0, 0.0, 0.0, 0.0);
-    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+    // Save pack alignment. Rows of RGBA8 pixels are always 4-byte aligned,
+    // but let's be explicit about it.
+    GLint oldPackAlignment;
+    glGetIntegerv(GL_PACK_ALIGNMENT, &oldPackAlignment);
+    glPixelStorei(GL_PACK_ALIGNMENT, 4);
 
-    // Set projection matrix
-    // Note: (0,h) and not (h,0) since y-axis is down in VPaint, up in QImage
-    glMatrixMode(GL_PROJECTION);
-    glLoadIdentity();
-    glOrtho(0, w, 0, h, 0, 1);
+    // Wait for background images to be decoded rather than skipping them
+    isDrawingToImage_ = true;
 
-    // Set view matrix
-    glMatrixMode (GL_MODELVIEW);
-    GLWidget_Camera2D camera2d;
-    camera2d.setX(-x);
-    camera2d.setY(-y);
-    camera2d.setZoom(1);
-    glLoadMatrixd(camera2d.viewMatrixData());
+    // Save visible rect, which we change for each tile
+    double oldVisibleXMin = viewSettings_.visibleXMin();
+    double oldVisibleXMax = viewSettings_.visibleXMax();
+    double oldVisibleYMin = viewSettings_.visibleYMin();
+    double oldVisibleYMax = viewSettings_.visibleYMax();
 
-    // Draw scene
-    if (useViewSettings)
-    {
-        drawSceneDelegate_(t);
-    }
-    else
+    // Size of one output pixel, in scene coordinates
+    double pixelSizeX = w / IMG_SIZE_X;
+    double pixelSizeY = h / IMG_SIZE_Y;
+
+    // Read-back buffer, reused for all tiles
+    std::vector<uchar> tile(4 * static_cast<size_t>(TILE_SIZE_X) * TILE_SIZE_Y);
+
+    // Iterate over all tiles
+    for (int ty = 0; ty < IMG_SIZE_Y; ty += TILE_SIZE_Y)
     {
-        ViewSettings::DisplayMode oldDM = viewSettings_.displayMode();
-        viewSettings_.setDisplayMode(ViewSettings::ILLUSTRATION);
-        viewSettings_.setMainDrawing(false);
-        viewSettings_.setDrawCursor(false);
+        int th = std::min(TILE_SIZE_Y, IMG_SIZE_Y - ty);
 
-        for (int j = 0; j < scene()->numLayers(); ++j)
+        for (int tx = 0; tx < IMG_SIZE_X; tx += TILE_SIZE_X)
         {
-            Layer * layer = scene()->layer(j);
-            if (layer->isVisible()) {
-                drawBackground_(layer->background(), t.frame());
-                layer->vac()->draw(t, viewSettings_);
+            int tw = std::min(TILE_SIZE_X, IMG_SIZE_X - tx);
+
+            // ------------ Render tile to multisample FBO --------------------
+
+            // Bind FBO
+            gl_fbo_->glBindFramebuffer(GL_FRAMEBUFFER, ms_fboId);
+
+            // Set viewport
+            glViewport(0, 0, tw, th);
+
+            // Clear FBO to fully transparent
+            glClearColor(0.0, 0.0, 0.0, 0.0);
+            glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+            // Set projection matrix, restricted to the part of the scene
+            // covered by this tile.
+            // Note: (0,h) and not (h,0) since y-axis is down in VPaint, up in QImage
+            glMatrixMode(GL_PROJECTION);
+            glLoadIdentity();
+            glOrtho(0, tw * pixelSizeX, 0, th * pixelSizeY, 0, 1);
+
+            // Set view matrix
+            glMatrixMode (GL_MODELVIEW);
+            GLWidget_Camera2D camera2d;
+            camera2d.setX(-(x + tx * pixelSizeX));
+            camera2d.setY(-(y + ty * pixelSizeY));
+            camera2d.setZoom(1);
+            glLoadMatrixd(camera2d.viewMatrixData());
+
+            // Skip cells outside of this tile
+            viewSettings_.setVisibleRect(
+                x + tx * pixelSizeX, x + (tx + tw) * pixelSizeX,
+                y + ty * pixelSizeY, y + (ty + th) * pixelSizeY);
+
+            // Draw scene
+            if (useViewSettings)
+            {
+                drawSceneDelegate_(t);
             }
-        }
-
-        viewSettings_.setDrawCursor(true);
-        viewSettings_.setDisplayMode(oldDM);
-    }
-
-    // Restore viewport
-    glViewport(oldViewport[0], oldViewport[1], oldViewport[2], oldViewport[3]);
-
-    // Unbind FBO
-    gl_fbo_->glBindFramebuffer(GL_FRAMEBUFFER, defaultFramebufferObject());
-
+            else
+            {
+                ViewSettings::DisplayMode oldDM = viewSettings_.displayMode();
+                viewSettings_.setDisplayMode(ViewSettings::ILLUSTRATION);
+                viewSettings_.setMainDrawing(false);
+                viewSettings_.setDrawCursor(false);
 
-    // ------ Blit multisample FBO to standard FBO ---------
+                for (int j = 0; j < scene()->numLayers(); ++j)
+                {
+                    Layer * layer = scene()->layer(j);
+                    if (layer->isVisible()) {
+                        drawBackground_(layer->background(), t.frame());
+                        layer->vac()->draw(t, viewSettings_);
+                    }
+                }
 
-    // Bind multisample FBO for reading
-    gl_fbo_->glBindFramebuffer(GL_READ_FRAMEBUFFER, ms_fboId);
-    // Bind standard FBO for drawing
-    gl_fbo_->glBindFramebuffer(GL_DRAW_FRAMEBUFFER, fboId);
-    // Blit
-    gl_fbo_->glBlitFramebuffer(0, 0, IMG_SIZE_X, IMG_SIZE_Y, 0, 0, IMG_SIZE_X, IMG_SIZE_Y, GL_COLOR_BUFFER_BIT, GL_NEAREST);
-    // Unbind FBO
-    gl_fbo_->glBindFramebuffer(GL_FRAMEBUFFER, defaultFramebufferObject());
+                viewSettings_.setDrawCursor(true);
+                viewSettings_.setDisplayMode(oldDM);
+            }
 
 
-    // ------ Read standard FBO to RAM data ---------
+            // ------ Blit multisample FBO to standard FBO ---------
 
-    // Bind standard FBO for reading
-    glBindTexture(GL_TEXTURE_2D, textureId);
-    // Read
-    uchar * img = new uchar[4 * IMG_SIZE_X * IMG_SIZE_Y];
-    glGetTexImage(GL_TEXTURE_2D, 0, GL_RGBA, GL_UNSIGNED_BYTE,  img);
-    // Unbind FBO
-    glBindTexture(GL_TEXTURE_2D, 0);
+            // Bind multisample FBO for reading
+            gl_fbo_->glBindFramebuffer(GL_READ_FRAMEBUFFER, ms_fboId);
+            // Bind standard FBO for drawing
+            gl_fbo_->glBindFramebuffer(GL_DRAW_FRAMEBUFFER, fboId);
+            // Blit
+            gl_fbo_->glBlitFramebuffer(0, 0, tw, th, 0, 0, tw, th, GL_COLOR_BUFFER_BIT, GL_NEAREST);
 
 
-    // ------ Release allocated GPU memory  ---------
+            // ------ Read standard FBO to RAM data ---------
 
-    gl_fbo_->glDeleteFramebuffers(1, &ms_fboId);
-    gl_fbo_->glDeleteRenderbuffers(1, &ms_ColorBufferId);
-    gl_fbo_->glDeleteRenderbuffers(1, &ms_DepthBufferId);
-    gl_fbo_->glDeleteFramebuffers(1, &fboId);
-    gl_fbo_->glDeleteRenderbuffers(1, &rboId);
-    glDeleteTextures(1, &textureId);
+            // Bind standard FBO for reading
+            gl_fbo_->glBindFramebuffer(GL_READ_FRAMEBUFFER, fboId);
+            // Read
+            glReadPixels(0, 0, tw, th, GL_RGBA, GL_UNSIGNED_BYTE, tile.data());
+            // Unbind FBO
+            gl_fbo_->glBindFramebuffer(GL_FRAMEBUFFER, defaultFramebufferObject());
 
 
-    // ------ un-premultiply alpha ---------
+            // ------ Un-premultiply alpha and copy to final image ---------
 
-    // Once can notice that glBlendFuncSeparate(alpha, 1-alpha, 1, 1-alpha)
-    // performs the correct blending function with input:
-    //    Frame buffer color as pre-multiplied alpha
-    //    Input fragment color as post-multiplied alpha
-    // and output:
-    //    New frame buffer color as pre-multiplied alpha
-    //
-    // So by starting with glClearColor(0.0, 0.0, 0.0, 0.0), which is the
-    // correct pre-multiplied representation for fully transparent, then
-    // by specifying glColor() in post-multiplied alpha, we get the correct
-    // blending behaviour and simply have to un-premultiply the value obtained
-    // in the frame buffer at the very end
+            // Once can notice that glBlendFuncSeparate(alpha, 1-alpha, 1, 1-alpha)
+            // performs the correct blending function with input:
+            //    Frame buffer color as pre-multiplied alpha
+            //    Input fragment color as post-multiplied alpha
+            // and output:
+            //    New frame buffer color as pre-multiplied alpha
+            //
+            // So by starting with glClearColor(0.0, 0.0, 0.0, 0.0), which is the
+            // correct pre-multiplied representation for fully transparent, then
+            // by specifying glColor() in post-multiplied alpha, we get the correct
+            // blending behaviour and simply have to un-premultiply the value obtained
+            // in the frame buffer at the very end
+            //
+            // Note: the first row of the tile is the top of the tile in
+            // VPaint coordinates, that is, the same orientation as QImage.
 
-    for(int k=0; k<IMG_SIZE_X*IMG_SIZE_Y; ++k)
-    {
-        uchar * pixel = &(img[4*k]);
-        double a = pixel[3];
-        if( 0 < a && a < 255 )
-        {
-            double s = 255.0 / a;
-            pixel[0] = (uchar) (std::min(255.0,std::floor(0.5+s*pixel[0])));
-            pixel[1] = (uchar) (std::min(255.0,std::floor(0.5+s*pixel[1])));
-            pixel[2] = (uchar) (std::min(255.0,std::floor(0.5+s*pixel[2])));
+            for (int i = 0; i < th; ++i)
+            {
+                uchar * src = &tile[4 * static_cast<size_t>(i) * tw];
+                uchar * dst = res.scanLine(ty + i) + 4 * tx;
+                for (int k = 0; k < tw; ++k)
+                {
+                    uchar * pixel = &(src[4*k]);
+                    double a = pixel[3];
+                    if( 0 < a && a < 255 )
+                    {
+                        double s = 255.0 / a;
+                        pixel[0] = (uchar) (std::min(255.0,std::floor(0.5+s*pixel[0])));
+                        pixel[1] = (uchar) (std::min(255.0,std::floor(0.5+s*pixel[1])));
+                        pixel[2] = (uchar) (std::min(255.0,std::floor(0.5+s*pixel[2])));
+                    }
+                }
+                std::copy(src, src + 4 * tw, dst);
+            }
         }
     }
 
+    isDrawingToImage_ = false;
+    viewSettings_.setVisibleRect(oldVisibleXMin, oldVisibleXMax, oldVisibleYMin, oldVisibleYMax);
 
-    // ------ Convert to Qimage ---------
+    // Restore viewport and pack alignment
+    glViewport(oldViewport[0], oldViewport[1], oldViewport[2], oldViewport[3]);
+    glPixelStorei(GL_PACK_ALIGNMENT, oldPackAlignment);
 
-    // Create cleanup info to delete[] img when appropriate
-    QImageCleanupFunction cleanupFunction = &imageCleanupHandler;
-    void * cleanupInfo = reinterpret_cast<void*>(img);
 
-    // Create QImage
-    QImage res(img, IMG_SIZE_X, IMG_SIZE_Y, QImage::Format_RGBA8888, cleanupFunction, cleanupInfo);
+    // ------ Release allocated GPU memory  ---------
+
+    gl_fbo_->glDeleteFramebuffers(1, &ms_fboId);
+    gl_fbo_->glDeleteRenderbuffers(1, &ms_ColorBufferId);
+    gl_fbo_->glDeleteRenderbuffers(1, &ms_DepthBufferId);
+    gl_fbo_->glDeleteFramebuffers(1, &fboId);
+    gl_fbo_->glDeleteRenderbuffers(1, &colorBufferId);
+    gl_fbo_->glDeleteRenderbuffers(1, &rboId);
 
     // Return QImage
     return res;
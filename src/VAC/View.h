@@ -155,6 +155,10 @@ private:
     // Note: which frame to render is specified in viewSettings
     Scene *scene_;
 
+    // Translates the modelview matrix and the visible rect for drawing
+    // onion skins
+    void translateOnionSkin_(double dx, double dy);
+
     // Different times might be drawn concurently, either because there are several
     // timeline or a timeline has several time. The method below gives the time to
     // be use for interactivity with the user
@@ -177,6 +181,9 @@ private:
     Picking::Object hoveredObject_;
     bool pickingIsEnabled_;
 
+    // Whether we are rendering for export, see drawToImage()
+    bool isDrawingToImage_;
+
     // PMR mouse event temp variables
     int currentAction_;
     double sculptStartRadius_;
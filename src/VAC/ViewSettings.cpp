@@ -16,6 +16,8 @@
 
 #include "ViewSettings.h"
 
+#include <limits>
+
 ViewSettings::ViewSettings() :
     // Display
     zoom_(1.0),
@@ -24,6 +26,10 @@ ViewSettings::ViewSettings() :
     drawBackground_(true),
     drawCursor_(true),
     isMainDrawing_(true),
+    visibleXMin_(-std::numeric_limits<double>::infinity()),
+    visibleXMax_(std::numeric_limits<double>::infinity()),
+    visibleYMin_(-std::numeric_limits<double>::infinity()),
+    visibleYMax_(std::numeric_limits<double>::infinity()),
     vertexTopologySize_(5),
     edgeTopologyWidth_(3),
     drawTopologyFaces_(false),
@@ -129,6 +135,42 @@ void ViewSettings::setMainDrawing(bool newValue)
     }
 }
 
+double ViewSettings::visibleXMin() const
+{
+    return visibleXMin_;
+}
+double ViewSettings::visibleXMax() const
+{
+    return visibleXMax_;
+}
+double ViewSettings::visibleYMin() const
+{
+    return visibleYMin_;
+}
+double ViewSettings::visibleYMax() const
+{
+    return visibleYMax_;
+}
+void ViewSettings::setVisibleRect(double xMin, double xMax, double yMin, double yMax)
+{
+    visibleXMin_ = xMin;
+    visibleXMax_ = xMax;
+    visibleYMin_ = yMin;
+    visibleYMax_ = yMax;
+}
+void ViewSettings::translateVisibleRect(double dx, double dy)
+{
+    visibleXMin_ += dx;
+    visibleXMax_ += dx;
+    visibleYMin_ += dy;
+    visibleYMax_ += dy;
+}
+void ViewSettings::resetVisibleRect()
+{
+    const double inf = std::numeric_limits<double>::infinity();
+    setVisibleRect(-inf, inf, -inf, inf);
+}
+
 int ViewSettings::vertexTopologySize() const
 {
     return vertexTopologySize_;
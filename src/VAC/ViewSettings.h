@@ -52,6 +52,19 @@ public:
     bool isMainDrawing() const;
     void setMainDrawing(bool newValue);
 
+    // Scene rectangle visible in the view, used by VAC::draw() and
+    // VAC::drawPick() to skip cells that are entirely off-screen. It is
+    // expressed in the coordinate system in which cells are drawn, so it
+    // must be translated whenever the modelview matrix is, e.g., when
+    // drawing onion skins. By default, it is infinite (no culling).
+    double visibleXMin() const;
+    double visibleXMax() const;
+    double visibleYMin() const;
+    double visibleYMax() const;
+    void setVisibleRect(double xMin, double xMax, double yMin, double yMax);
+    void translateVisibleRect(double dx, double dy);
+    void resetVisibleRect();
+
 
     int vertexTopologySize() const;
     void setVertexTopologySize(int newValue);
@@ -104,6 +117,10 @@ private:
     bool drawBackground_;
     bool drawCursor_;
     bool isMainDrawing_;
+    double visibleXMin_;
+    double visibleXMax_;
+    double visibleYMin_;
+    double visibleYMax_;
     int vertexTopologySize_;
     int edgeTopologyWidth_;
     bool drawTopologyFaces_;